@@ -22,15 +22,45 @@
 #include "grbl.h" // Tương thích Arduino IDE
 
 // Cấu hình mặc định - dùng khi reset EEPROM (đổi tên trong defaults.h)
-#define DEFAULTS_GENERIC
+#define DEFAULTS_SCANNER
+// #define DEFAULTS_GENERIC
 
 // Tốc độ baud serial
+// Profile tốc độ cao cho ATmega2560: 250000/500000/1000000 chia chẵn từ F_CPU
+// 16MHz (lỗi baud 0% qua đường U2X0 trong serial_init). Telemetry burst khi
+// scan liên tục ($B=1) bão hòa TX buffer ở 115200 và làm serial_write()
+// busy-wait, kéo chậm cả main loop - dùng kèm buffer lớn trong
+// cpu_map_atmega2560.h. Adapter USB-serial CH340/FT232 đều theo được 1M baud.
 #define BAUD_RATE 115200
+// #define BAUD_RATE 250000
+// #define BAUD_RATE 500000
+// #define BAUD_RATE 1000000
 
 // Cấu hình CPU map - GRBL hỗ trợ chính thức Arduino Uno
 // Có thể thêm các bộ xử lý khác trong cpu_map.h
 #define CPU_MAP_ATMEGA328P // CPU Arduino Uno
 
+// Profile build chuyên cho máy scan: máy không có bơm làm mát, spindle hay
+// đầu dò nên M7/M8/M9, M3/M4/M5 và G38.x chỉ chiếm chỗ - SCANNER_BUILD biến
+// chúng thành no-op (stub macro trong header) và loại coolant_control.c,
+// spindle_control.c, probe.c khỏi build, dồn chỗ trống cho buffer chuyển động
+// sâu hơn để chuỗi micro-segment quay không bị đói block ở mật độ điểm cao.
+// Comment out để build lại Grbl mill đầy đủ.
+#define SCANNER_BUILD
+#ifdef SCANNER_BUILD
+  #ifdef __AVR_ATmega2560__
+    // Mega2560 (8KB SRAM): serial ring 1KB đã bật trong cpu_map_atmega2560.h,
+    // thêm planner 32 block (~1.3KB) cho look-ahead gần gấp đôi mặc định
+    #define BLOCK_BUFFER_SIZE 32
+    #define SEGMENT_BUFFER_SIZE 10
+  #else
+    // 328p (2KB SRAM): phần gỡ module tiết kiệm chủ yếu flash, SRAM chỉ dư
+    // cho thêm 2 block + 2 segment - serial ring giữ mặc định trong serial.h
+    #define BLOCK_BUFFER_SIZE 20
+    #define SEGMENT_BUFFER_SIZE 8
+  #endif
+#endif
+
 // Định nghĩa ký tự đặc biệt cho lệnh real-time
 // Các ký tự này được lấy trực tiếp từ serial stream và không được truyền vào parser g-code
 // Chọn ký tự không có trong chương trình g-code
@@ -41,11 +71,50 @@
 #define CMD_RESET 0x18 // ctrl-x.
 #define CMD_SAFETY_DOOR '@'
 
+// Sử dụng chân GPIO1 (data-ready) của VL53L0X làm pin-change interrupt thay vì poll
+// RESULT_INTERRUPT_STATUS qua I2C mỗi 1ms. Khi bật, driver chỉ chờ flag do ISR set,
+// không tốn bus I2C và không delay chết trong lúc sensor đang đo. GPIO1 nối vào chân
+// định nghĩa trong cpu_map.h (mặc định A3 - dùng chung PCINT vector với control pins).
+// LƯU Ý: A3 trùng với chân coolant flood (M8) - scanner không dùng coolant.
+#define VL53L0X_GPIO1_INTERRUPT // Default enabled. Comment to disable.
+
+// Chế độ hai sensor: VL53L0X và VL53L1 gắn hai phía đối diện bàn quay, đo song song
+// (interleaved) - mỗi nửa vòng quay thu được profile 360 độ đầy đủ. Cả hai sensor có
+// địa chỉ mặc định 0x29, nên cần nối XSHUT của VL53L1 vào chân định nghĩa trong
+// cpu_map.h: lúc boot giữ VL53L1 trong reset, init VL53L0X xong mới nhả XSHUT và
+// chuyển VL53L1 sang địa chỉ 0x30 qua register I2C_SLAVE_DEVICE_ADDRESS.
+// Lệnh READ_DUAL trả về cặp (distance_A,distance_B) trong một round trip.
+// #define DUAL_TOF_SENSORS // Default disabled. Uncomment to enable.
+
+// Bảng hiệu chuẩn khoảng cách piecewise-linear lưu trong PROGMEM (vl53l0x.c).
+// Bias phụ thuộc khoảng cách của VL53L0X được nội suy và cộng vào kết quả ngay
+// trong readRangeContinuousMillimeters() - host nhận dữ liệu đã hiệu chuẩn nên
+// không còn sửa bias per-point trong calculate_point_from_scan() của GUI nữa.
+// Xem bảng qua lệnh $T. Bảng mặc định offset 0 (identity) - đo thực tế với
+// target ở các khoảng cách breakpoint rồi điền offset (mm) vào vl53l0x.c.
+#define VL53L0X_CAL_LUT // Default enabled. Comment to disable.
+
 // If homing is enabled, homing init lock sets Grbl into an alarm state upon power up. This forces
 // the user to perform the homing cycle (or override the locks) before doing anything else. This is
 // mainly a safety feature to remind the user to home, since position is unknown to Grbl.
 #define HOMING_INIT_LOCK // Comment to disable
 
+// Checkpoint vị trí máy xuống EEPROM (ring 8 slot chống mòn cell, ghi nhỏ
+// giọt khi máy IDLE) và nạp lại lúc boot: soft limit hoạt động ngay và phiên
+// mới bỏ qua ~30 giây homing - operator bật tắt máy scanner hàng chục lần
+// mỗi ngày. Checkpoint bị vô hiệu khi reset/limit giữa chuyển động (vị trí
+// có thể đã mất bước) - lúc đó boot kế tiếp lại vào alarm homing như cũ.
+#define POSITION_CHECKPOINT // Default enabled. Comment to disable.
+
+// Giám sát watchdog cho phiên scan: firmware treo (đã gặp trong wait loop
+// I2C) là mất trắng một lượt quét nhiều giờ. Watchdog 2 giây được pet trong
+// protocol_execute_realtime; lần timeout ĐẦU chạy ISR stash sys.position và
+// tiến độ scan cycle vào RAM .noinit (sống qua watchdog reset), lần thứ hai
+// reset MCU. Boot sau phát "[WDT_RESUME:...]" để host tiếp tục từ điểm đã
+// xong thay vì quét lại từ đầu. Không dùng chung được với watchdog debounce
+// của limit (ENABLE_SOFTWARE_DEBOUNCE) - cùng tranh vector WDT.
+#define WATCHDOG_SUPERVISION // Default enabled. Comment to disable.
+
 // Define the homing cycle patterns with bitmasks. The homing cycle first performs a search mode
 // to quickly engage the limit switches, followed by a slower locate mode, and finished by a short
 // pull-off motion to disengage the limit switches. The following HOMING_CYCLE_x defines are executed 
@@ -200,6 +269,13 @@
 // step smoothing. See stepper.c for more details on the AMASS system works.
 #define ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING  // Default enabled. Comment to disable.
 
+// Đo thời gian ISR stepper (Timer1) bằng chính TCNT1: max và trung bình tính
+// theo chu kỳ CPU, dump qua lệnh $P cùng mực nước thấp nhất của segment buffer
+// và planner buffer trong lúc cycle. Số liệu thật để tune feed rate và buffer
+// size thay vì đoán tại sao scan bị khựng. Tốn ~20 chu kỳ mỗi tick ISR -
+// comment dòng này nếu cần vắt kiệt step rate tối đa.
+#define STEPPER_ISR_PROFILE // Default enabled. Comment to disable.
+
 // Sets the maximum step rate allowed to be written as a Grbl setting. This option enables an error 
 // check in the settings module to prevent settings values that will exceed this limitation. The maximum
 // step rate is strictly limited by the CPU speed and will change if something other than an AVR running
@@ -347,7 +423,8 @@
 // increase the receive buffer if a deeper receive buffer is needed for streaming and avaiable
 // memory allows. The send buffer primarily handles messages in Grbl. Only increase if large
 // messages are sent and Grbl begins to stall, waiting to send the rest of the message.
-// NOTE: Buffer size values must be greater than zero and less than 256.
+// NOTE: Values above 256 switch the ring buffer indices to 16-bit (see serial.h) and are
+// only sensible on processors with extra SRAM, e.g. the ATmega2560 (cpu_map_atmega2560.h).
 // #define RX_BUFFER_SIZE 128 // Uncomment to override defaults in serial.h
 // #define TX_BUFFER_SIZE 64
   
@@ -369,6 +446,9 @@
 // use shielded signal cables with their shielding connected to ground (old USB/computer cables 
 // work well and are cheap to find) and wire in a low-pass circuit into each limit pin.
 // #define ENABLE_SOFTWARE_DEBOUNCE // Default disabled. Uncomment to enable.
+#if defined(WATCHDOG_SUPERVISION) && defined(ENABLE_SOFTWARE_DEBOUNCE)
+  #error "WATCHDOG_SUPERVISION va ENABLE_SOFTWARE_DEBOUNCE dung chung vector WDT - chi bat mot"
+#endif
 
 // Force Grbl to check the state of the hard limit switches when the processor detects a pin
 // change inside the hard limit ISR routine. By default, Grbl will trigger the hard limits
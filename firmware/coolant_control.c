@@ -12,6 +12,8 @@
 
 #include "grbl.h"
 
+#ifndef SCANNER_BUILD // Máy scan không có coolant - header cung cấp stub no-op
+
 // Khởi tạo điều khiển coolant
 void coolant_init()
 {
@@ -51,6 +53,8 @@ void coolant_set_state(uint8_t mode)
 void coolant_run(uint8_t mode)
 {
   if (sys.state == STATE_CHECK_MODE) { return; }
-  protocol_buffer_synchronize(); // Ensure coolant turns on when specified in program.  
+  protocol_buffer_synchronize(); // Ensure coolant turns on when specified in program.
   coolant_set_state(mode);
 }
+
+#endif // SCANNER_BUILD
@@ -11,7 +11,18 @@
 */
 
 #ifndef coolant_control_h
-#define coolant_control_h 
+#define coolant_control_h
+
+#ifdef SCANNER_BUILD
+
+// Máy scan không có bơm làm mát - M7/M8/M9 thành no-op, coolant_control.c
+// bị loại khỏi build (xem SCANNER_BUILD trong config.h)
+#define coolant_init()
+#define coolant_stop()
+#define coolant_set_state(mode)
+#define coolant_run(mode)
+
+#else
 
 // Khởi tạo điều khiển coolant
 void coolant_init();
@@ -25,4 +36,6 @@ void coolant_set_state(uint8_t mode);
 // Chạy coolant với mode cụ thể
 void coolant_run(uint8_t mode);
 
+#endif // SCANNER_BUILD
+
 #endif
\ No newline at end of file
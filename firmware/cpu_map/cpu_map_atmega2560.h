@@ -32,12 +32,20 @@
 #define SERIAL_RX USART0_RX_vect
 #define SERIAL_UDRE USART0_UDRE_vect
 
-// Increase Buffers to make use of extra SRAM
-//#define RX_BUFFER_SIZE		256
-//#define TX_BUFFER_SIZE		128
+// Increase Buffers to make use of extra SRAM (8KB vs 2KB on the 328p).
+// 1KB each way rides out telemetry bursts from continuous scanning without
+// serial_write() busy-waiting, and absorbs host g-code streaming at the high
+// baud profiles in config.h. Indices switch to 16-bit automatically (serial.h).
+#define RX_BUFFER_SIZE		1024
+#define TX_BUFFER_SIZE		1024
 //#define BLOCK_BUFFER_SIZE	36
 //#define LINE_BUFFER_SIZE	100
 
+// AMASS Level 4: overdrive ISR x16 (tối đa 32kHz) cho vùng step < 2kHz -
+// quay siêu chậm của bàn xoay mượt gấp đôi, đo được trong lúc chuyển động
+// không cần settle. 2560 dư headroom CPU cho ISR 32kHz; 328p thì không.
+#define AMASS_32KHZ_OVERDRIVE
+
 // Define step pulse output pins. NOTE: All step bit pins must be on the same port.
 #define STEP_DDR      DDRA
 #define STEP_PORT     PORTA
@@ -110,6 +118,35 @@
 #define CONTROL_MASK ((1<<RESET_BIT)|(1<<FEED_HOLD_BIT)|(1<<CYCLE_START_BIT)|(1<<SAFETY_DOOR_BIT))
 #define CONTROL_INVERT_MASK CONTROL_MASK // May be re-defined to only invert certain control pins.
 
+// Định nghĩa chân SDA/SCL cho bus I2C - chỉ dùng khi bit-bang recovery bus bị kẹt
+#define I2C_SDA_DDR   DDRD
+#define I2C_SDA_PIN   PIND
+#define I2C_SDA_PORT  PORTD
+#define I2C_SDA_BIT   1  // MEGA2560 Digital Pin 20
+#define I2C_SCL_DDR   DDRD
+#define I2C_SCL_PIN   PIND
+#define I2C_SCL_PORT  PORTD
+#define I2C_SCL_BIT   0  // MEGA2560 Digital Pin 21
+
+// Định nghĩa chân data-ready GPIO1 của VL53L0X (xem VL53L0X_GPIO1_INTERRUPT trong config.h)
+// Dùng chung Pin Change Interrupt vector (PCINT2) với control pins
+#ifdef VL53L0X_GPIO1_INTERRUPT
+  #define VL53L0X_GPIO1_DDR   DDRK
+  #define VL53L0X_GPIO1_PIN   PINK
+  #define VL53L0X_GPIO1_PORT  PORTK
+  #define VL53L0X_GPIO1_BIT   4  // MEGA2560 Analog Pin 12
+  #define VL53L0X_GPIO1_MASK  (1<<VL53L0X_GPIO1_BIT)
+  #define VL53L0X_GPIO1_PCMSK CONTROL_PCMSK // Chia sẻ PCMSK2 với control pins
+#endif
+
+// Định nghĩa chân XSHUT của VL53L1 cho chế độ hai sensor (xem DUAL_TOF_SENSORS trong config.h)
+#ifdef DUAL_TOF_SENSORS
+  #define VL53L1_XSHUT_DDR   DDRK
+  #define VL53L1_XSHUT_PORT  PORTK
+  #define VL53L1_XSHUT_BIT   5  // MEGA2560 Analog Pin 13
+  #define VL53L1_XSHUT_MASK  (1<<VL53L1_XSHUT_BIT)
+#endif
+
 // Define probe switch input pin.
 #define PROBE_DDR       DDRK
 #define PROBE_PIN       PINK
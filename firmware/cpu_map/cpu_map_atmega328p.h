@@ -116,6 +116,38 @@
 #define CONTROL_MASK ((1<<RESET_BIT)|(1<<FEED_HOLD_BIT)|(1<<CYCLE_START_BIT)|(1<<SAFETY_DOOR_BIT))
 #define CONTROL_INVERT_MASK CONTROL_MASK // May be re-defined to only invert certain control pins.
   
+// Định nghĩa chân SDA/SCL cho bus I2C - chỉ dùng khi bit-bang recovery bus bị kẹt
+// (hoạt động bình thường do TWI hardware điều khiển)
+#define I2C_SDA_DDR   DDRC
+#define I2C_SDA_PIN   PINC
+#define I2C_SDA_PORT  PORTC
+#define I2C_SDA_BIT   4  // Uno Analog Pin 4
+#define I2C_SCL_DDR   DDRC
+#define I2C_SCL_PIN   PINC
+#define I2C_SCL_PORT  PORTC
+#define I2C_SCL_BIT   5  // Uno Analog Pin 5
+
+// Định nghĩa chân data-ready GPIO1 của VL53L0X (xem VL53L0X_GPIO1_INTERRUPT trong config.h)
+// Dùng chung Pin Change Interrupt vector (PCINT1) với control pins
+// LƯU Ý: A3 trùng với chân coolant flood - không dùng M8 khi bật sensor interrupt
+#ifdef VL53L0X_GPIO1_INTERRUPT
+  #define VL53L0X_GPIO1_DDR   DDRC
+  #define VL53L0X_GPIO1_PIN   PINC
+  #define VL53L0X_GPIO1_PORT  PORTC
+  #define VL53L0X_GPIO1_BIT   3  // Uno Analog Pin 3
+  #define VL53L0X_GPIO1_MASK  (1<<VL53L0X_GPIO1_BIT)
+  #define VL53L0X_GPIO1_PCMSK CONTROL_PCMSK // Chia sẻ PCMSK1 với control pins
+#endif
+
+// Định nghĩa chân XSHUT của VL53L1 cho chế độ hai sensor (xem DUAL_TOF_SENSORS trong config.h)
+// LƯU Ý: D13 trùng với spindle direction - scanner không dùng spindle
+#ifdef DUAL_TOF_SENSORS
+  #define VL53L1_XSHUT_DDR   DDRB
+  #define VL53L1_XSHUT_PORT  PORTB
+  #define VL53L1_XSHUT_BIT   5  // Uno Digital Pin 13
+  #define VL53L1_XSHUT_MASK  (1<<VL53L1_XSHUT_BIT)
+#endif
+
 // Define probe switch input pin.
 #define PROBE_DDR       DDRC
 #define PROBE_PIN       PINC
@@ -22,6 +22,12 @@
   #include "defaults/defaults_generic.h"
 #endif
 
+#ifdef DEFAULTS_SCANNER
+  // Máy scan laser 3D: bàn quay trên trục X + trục nâng đầu đo ToF trên Y.
+  // Dùng kèm SCANNER_BUILD trong config.h (gỡ coolant/spindle/probe).
+  #include "defaults/defaults_scanner.h"
+#endif
+
 #ifdef DEFAULTS_SHERLINE_5400
   // Description: Sherline 5400 mill with three NEMA 23 Keling  KL23H256-21-8B 185 oz-in stepper motors,
   // driven by three Pololu A4988 stepper drivers with a 30V, 6A power supply at 1.5A per winding.
@@ -58,5 +58,8 @@
   #define DEFAULT_HOMING_SEEK_RATE 500.0 // mm/min
   #define DEFAULT_HOMING_DEBOUNCE_DELAY 250 // msec (0-65k)
   #define DEFAULT_HOMING_PULLOFF 1.0 // mm
+  #define DEFAULT_I2C_FAST_MODE 0 // false (100kHz standard mode)
+  #define DEFAULT_TOF_PROFILE 0 // balanced (xem VL53L0X_PROFILE_xxx trong vl53l0x.h)
+  #define DEFAULT_TOF_FILTER_WINDOW 5 // median của 5 sample cho filtered read ($32)
 
 #endif
@@ -111,7 +111,16 @@ void eeprom_put_char( unsigned int addr, unsigned char new_value )
 	sei(); // Restore interrupt flag state.
 }
 
-// Extensions added as part of Grbl 
+// Extensions added as part of Grbl
+
+
+// Trả về khác 0 nếu EEPROM sẵn sàng nhận byte mới (EEPE đã hạ). Dùng cho flush
+// nền trong settings.c: kiểm tra trước khi gọi eeprom_put_char() để vòng
+// spin-wait bên trong không bao giờ phải chờ thật (~3.4ms mỗi byte)
+unsigned char eeprom_ready( void )
+{
+	return !(EECR & (1<<EEPE));
+}
 
 
 void memcpy_to_eeprom_with_checksum(unsigned int destination, char *source, unsigned int size) {
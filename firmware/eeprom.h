@@ -19,6 +19,9 @@ unsigned char eeprom_get_char(unsigned int addr);
 // Ghi 1 byte vào EEPROM tại địa chỉ
 void eeprom_put_char(unsigned int addr, unsigned char new_value);
 
+// Trả về khác 0 nếu EEPROM sẵn sàng nhận byte mới (write trước đã xong)
+unsigned char eeprom_ready(void);
+
 // Copy dữ liệu vào EEPROM với checksum
 void memcpy_to_eeprom_with_checksum(unsigned int destination, char *source, unsigned int size);
 
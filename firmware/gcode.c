@@ -59,13 +59,80 @@ static uint8_t gc_check_same_position(float *pos_a, float *pos_b)
   return(true);
 }
          
+// Giá trị trả về đánh dấu "dòng không đủ điều kiện fast path" - caller rơi
+// về pipeline parse/validate đầy đủ. Không trùng mã STATUS_xxx nào.
+#define GC_FAST_PATH_PASS 0xFF
+
+// Fast path modal cho dòng chuyển động lặp lại của scan: hàng nghìn dòng
+// "G1 X0.002 F1" liên tiếp chỉ khác nhau giá trị trục, nhưng dòng nào cũng đi
+// qua đủ 3 bước validate modal group + tính offset hệ tọa độ của
+// gc_execute_line. Khi modal state hiện hành đã là G1 + G94 + G21 (đã được
+// validate ở dòng trước) và dòng mới chỉ gồm word trục/feed (G1 lặp lại cũng
+// cho qua), ta parse thẳng giá trị, áp offset đã có sẵn trong gc_state rồi
+// gọi mc_line - khỏi memset parser block, khỏi kiểm tra modal group, khỏi
+// tính lại coordinate_data.
+static uint8_t gc_motion_only_fast_path(char *line)
+{
+  float target[N_AXIS];
+  float value;
+  float feed = gc_state.feed_rate;
+  uint8_t char_counter = 0;
+  uint8_t axis_words = 0;
+  uint8_t letter, idx;
+
+  if (sys.state == STATE_CHECK_MODE) { return(GC_FAST_PATH_PASS); } // Check mode cần pipeline đủ
+  if ((gc_state.modal.motion != MOTION_MODE_LINEAR) ||
+      (gc_state.modal.feed_rate != FEED_RATE_MODE_UNITS_PER_MIN) ||
+      (gc_state.modal.units != UNITS_MODE_MM)) { return(GC_FAST_PATH_PASS); }
+
+  memcpy(target, gc_state.position, sizeof(target));
+
+  while (line[char_counter]) {
+    letter = line[char_counter++];
+    if (!read_float(line, &char_counter, &value)) { return(GC_FAST_PATH_PASS); }
+    switch (letter) {
+      case 'G':
+        // Chỉ chấp nhận "G1" lặp lại modal hiện hành - G khác về parser đủ
+        if (value != 1.0) { return(GC_FAST_PATH_PASS); }
+        break;
+      case 'F': feed = value; break;
+      case 'X': case 'Y': case 'Z':
+        idx = letter - 'X'; // 'X'/'Y'/'Z' liên tiếp trong ASCII -> 0/1/2
+        if (gc_state.modal.distance == DISTANCE_MODE_ABSOLUTE) {
+          target[idx] = value + gc_state.coord_system[idx] + gc_state.coord_offset[idx];
+          if (idx == TOOL_LENGTH_OFFSET_AXIS) { target[idx] += gc_state.tool_length_offset; }
+        } else {
+          target[idx] += value; // G91: cộng dồn từ vị trí hiện hành
+        }
+        axis_words++;
+        break;
+      default: return(GC_FAST_PATH_PASS); // Word ngoài trục/feed - về parser đủ
+    }
+  }
+  if (!axis_words) { return(GC_FAST_PATH_PASS); } // Dòng chỉ chỉnh modal/feed
+  if (feed <= 0.0) { return(GC_FAST_PATH_PASS); } // Để parser đủ báo lỗi chuẩn
+
+  #ifdef USE_LINE_NUMBERS
+    mc_line(target, feed, false, gc_state.line_number);
+  #else
+    mc_line(target, feed, false);
+  #endif
+  gc_state.feed_rate = feed;
+  memcpy(gc_state.position, target, sizeof(target));
+  return(STATUS_OK);
+}
+
 // Executes one line of 0-terminated G-Code. The line is assumed to contain only uppercase
 // characters and signed floating point values (no whitespace). Comments and block delete
-// characters have been removed. In this function, all units and positions are converted and 
-// exported to grbl's internal functions in terms of (mm, mm/min) and absolute machine 
+// characters have been removed. In this function, all units and positions are converted and
+// exported to grbl's internal functions in terms of (mm, mm/min) and absolute machine
 // coordinates, respectively.
-uint8_t gc_execute_line(char *line) 
+uint8_t gc_execute_line(char *line)
 {
+  // Dòng chỉ gồm word trục/feed trên modal state đã validate - đi tắt
+  uint8_t fast_status = gc_motion_only_fast_path(line);
+  if (fast_status != GC_FAST_PATH_PASS) { return(fast_status); }
+
   /* -------------------------------------------------------------------------------------
      STEP 1: Initialize parser block struct and copy current g-code state modes. The parser
      updates these modes and commands as the block line is parser and will only be used and
@@ -305,6 +372,13 @@ uint8_t gc_execute_line(char *line)
               case 9: gc_block.modal.coolant = COOLANT_DISABLE; break;
             }
             break;
+          case 100:
+            // M100 P<points> Q<revs> [R<z_pitch>]: scan cycle canned - một dòng
+            // 20 byte thay cho ~10KB g-code stream từng điểm mỗi vòng quay.
+            // Expand firmware-side trong STEP 4 qua protocol_scan_cycle().
+            word_bit = MODAL_GROUP_M100;
+            gc_block.user_mcode = 100;
+            break;
           default: FAIL(STATUS_GCODE_UNSUPPORTED_COMMAND); // [Unsupported M command]
         }
       
@@ -334,7 +408,7 @@ uint8_t gc_execute_line(char *line)
           case 'N': word_bit = WORD_N; gc_block.values.n = trunc(value); break;
           case 'P': word_bit = WORD_P; gc_block.values.p = value; break;
           // NOTE: For certain commands, P value must be an integer, but none of these commands are supported.
-          // case 'Q': // Not supported
+          case 'Q': word_bit = WORD_Q; gc_block.values.q = value; break; // M100 revolutions
           case 'R': word_bit = WORD_R; gc_block.values.r = value; break;
           case 'S': word_bit = WORD_S; gc_block.values.s = value; break;
           case 'T': word_bit = WORD_T; break; // gc.values.t = int_value;
@@ -458,7 +532,21 @@ uint8_t gc_execute_line(char *line)
     if (bit_isfalse(value_words,bit(WORD_P))) { FAIL(STATUS_GCODE_VALUE_WORD_MISSING); } // [P word missing]
     bit_false(value_words,bit(WORD_P));
   }
-  
+
+  // [10b. Scan cycle ]: M100 P<points/rev> Q<revs> [R<z_pitch/rev>].
+  // P/Q bắt buộc, Q != 0 (dấu của Q là chiều quay), tổng điểm P*|Q| phải nằm
+  // trong SCAN_MAX_POINTS. R tùy chọn - pitch leo trục Y mỗi vòng (xoắn ốc).
+  if (gc_block.user_mcode == 100) {
+    if (bit_isfalse(value_words,bit(WORD_P)) || bit_isfalse(value_words,bit(WORD_Q))) {
+      FAIL(STATUS_GCODE_VALUE_WORD_MISSING); // [P/Q word missing]
+    }
+    if (gc_block.values.q == 0.0) { FAIL(STATUS_INVALID_STATEMENT); } // [Q zero]
+    if ((gc_block.values.p * fabs(gc_block.values.q)) > (float)SCAN_MAX_POINTS) {
+      FAIL(STATUS_INVALID_STATEMENT); // [Too many points]
+    }
+    bit_false(value_words,(bit(WORD_P)|bit(WORD_Q)|bit(WORD_R)));
+  }
+
   // [11. Set active plane ]: N/A
   switch (gc_block.modal.plane_select) {
     case PLANE_SELECT_XY:
@@ -869,7 +957,24 @@ uint8_t gc_execute_line(char *line)
 
   // [10. Dwell ]:
   if (gc_block.non_modal_command == NON_MODAL_DWELL) { mc_dwell(gc_block.values.p); }
-  
+
+  // [10b. Scan cycle ]: M100 expand firmware-side - sync buffer rồi giao cho
+  // protocol_scan_cycle() dùng planner trực tiếp (cùng đường với lệnh "SCAN").
+  // Q đổi sang góc qua SCAN_MM_PER_REV, P là điểm/vòng, R là pitch leo/vòng.
+  if (gc_block.user_mcode == 100) {
+    if (sys.state != STATE_CHECK_MODE) {
+      float scan_feed = gc_state.feed_rate;
+      if (scan_feed <= 0.0) { scan_feed = SCAN_DEFAULT_FEED_RATE; }
+      protocol_buffer_synchronize(); // protocol_scan_cycle yêu cầu IDLE
+      uint8_t scan_status = protocol_scan_cycle(
+          gc_block.values.q*SCAN_MM_PER_REV,
+          (uint16_t)(gc_block.values.p*fabs(gc_block.values.q)),
+          scan_feed,
+          gc_block.values.r*fabs(gc_block.values.q));
+      if (scan_status != STATUS_OK) { FAIL(scan_status); }
+    }
+  }
+
   // [11. Set active plane ]:
   gc_state.modal.plane_select = gc_block.modal.plane_select;  
 
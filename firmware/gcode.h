@@ -34,6 +34,7 @@
 #define MODAL_GROUP_M4 11  // [M0,M1,M2,M30] Stopping
 #define MODAL_GROUP_M7 12 // [M3,M4,M5] Spindle turning
 #define MODAL_GROUP_M8 13 // [M7,M8,M9] Coolant control
+#define MODAL_GROUP_M100 14 // [M100] Scan cycle (custom - xem protocol_scan_cycle)
 
 // #define OTHER_INPUT_F 14
 // #define OTHER_INPUT_S 15
@@ -128,6 +129,7 @@
 #define WORD_X  10
 #define WORD_Y  11
 #define WORD_Z  12
+#define WORD_Q  13
 
 
 // NOTE: When this struct is zeroed, the above defines set the defaults for the system.
@@ -153,7 +155,7 @@ typedef struct {
   uint8_t l;       // G10 or canned cycles parameters
   int32_t n;       // Line number
   float p;         // G10 or dwell parameters
-  // float q;      // G82 peck drilling
+  float q;         // M100 scan cycle revolutions
   float r;         // Arc radius
   float s;         // Spindle speed
   uint8_t t;       // Tool selection
@@ -184,6 +186,7 @@ typedef struct {
 //   uint16_t value_words;
 
   uint8_t non_modal_command;
+  uint8_t user_mcode;      // M-code ngoài chuẩn (M100) - 0 nếu không có
   gc_modal_t modal;
   gc_values_t values;
 
@@ -53,6 +53,7 @@
 #include "serial.h"           // Giao tiếp serial
 #include "spindle_control.h"  // Điều khiển spindle
 #include "stepper.h"          // Điều khiển stepper motor
+#include "micros.h"           // Timebase microsecond (Timer2)
 #include "i2c.h"              // Module giao tiếp I2C (tích hợp)
 #include "vl53l0x.h"          // Driver sensor VL53L0X (tích hợp)
 
@@ -1,12 +1,17 @@
 /*
   i2c.c - Implementation module giao tiếp I2C (TWI)
-  
+
   CHỨC NĂNG:
   - Khởi tạo và quản lý bus I2C ở tốc độ 100kHz
-  - Thực hiện các thao tác start/stop/restart
-  - Đọc/ghi dữ liệu 1 byte và nhiều byte
-  - Đọc/ghi register của thiết bị I2C
-  
+  - Engine giao dịch bất đồng bộ chạy bằng TWI ISR (TWI_vect)
+  - Đọc/ghi register của thiết bị I2C qua descriptor, không chặn main loop
+  - Giữ các hàm polled cấp thấp cho code legacy
+
+  LÝ DO: mỗi lần đọc 12 byte kết quả VL53L0X ở 100kHz mất ~1.2ms. Với API
+  polled cũ, toàn bộ thời gian đó main loop đứng chờ TWINT trong khi
+  st_prep_buffer và serial bị đói. Engine ISR cho phép giao dịch chạy nền,
+  main loop chỉ kiểm tra txn->status.
+
   Part of Grbl
   Copyright (c) 2024
 */
@@ -18,32 +23,170 @@
 #define F_CPU 16000000UL
 #endif
 
-// Khởi tạo bus I2C - Cấu hình tốc độ 100kHz
-void i2c_init(void)
+// Giao dịch đang được ISR thực hiện (NULL nếu engine rảnh)
+static i2c_txn_t *i2c_active_txn = NULL;
+static uint8_t i2c_reg_remaining; // Số byte địa chỉ register còn phải gửi
+static uint8_t i2c_data_index;    // Index byte dữ liệu hiện tại
+
+// Theo dõi sức khỏe bus: đếm giao dịch lỗi liên tiếp, đủ ngưỡng thì recovery
+static uint8_t i2c_consecutive_errors = 0;
+static uint8_t i2c_recovery_count = 0;           // Tổng số lần recovery từ khi bật nguồn
+static volatile uint8_t i2c_recovery_pending_flag = 0; // Báo main loop cần re-init sensor
+
+// Đặt tốc độ bus theo setting runtime
+// 100kHz: TWBR=72, 400kHz: TWBR=12 (@ 16MHz, prescaler 1)
+void i2c_set_speed(uint8_t fast_mode)
 {
   TWSR = 0; // Prescaler = 1
-  TWBR = ((F_CPU / I2C_SCL_FREQ) - 16) / 2; // Tính TWBR cho 100kHz @ 16MHz
+  if (fast_mode) {
+    TWBR = ((F_CPU / I2C_SCL_FREQ_FAST) - 16) / 2; // 400kHz Fast Mode
+  } else {
+    TWBR = ((F_CPU / I2C_SCL_FREQ) - 16) / 2; // 100kHz Standard Mode
+  }
+}
+
+// Khởi tạo bus I2C - tốc độ lấy từ setting $30 (đã load từ EEPROM trước đó)
+void i2c_init(void)
+{
+  i2c_set_speed(settings.i2c_fast_mode);
   TWCR = (1 << TWEN); // Enable I2C
 }
 
+// Kết thúc giao dịch đang chạy: gửi STOP, tắt TWIE, cập nhật status
+static void i2c_txn_finish(uint8_t status)
+{
+  i2c_txn_t *txn = i2c_active_txn;
+  TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN); // STOP, không bật TWIE nữa
+  i2c_active_txn = NULL;
+  if (txn) {
+    txn->status = status;
+    if (txn->callback) { txn->callback(txn); }
+  }
+}
+
+// Submit một giao dịch cho TWI ISR engine
+// Trả về: 0 nếu đã nhận, 1 nếu bus đang bận
+uint8_t i2c_submit(i2c_txn_t *txn)
+{
+  uint8_t sreg = SREG;
+  cli();
+  if (i2c_active_txn != NULL) { SREG = sreg; return 1; }
+  txn->status = I2C_TXN_BUSY;
+  i2c_active_txn = txn;
+  i2c_reg_remaining = txn->reg_size;
+  i2c_data_index = 0;
+  SREG = sreg;
+  TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE); // Gửi START, bật ISR
+  return 0;
+}
+
+// Kiểm tra engine có đang thực hiện giao dịch không
+uint8_t i2c_busy(void)
+{
+  return (i2c_active_txn != NULL);
+}
+
+// Chờ (blocking) đến khi giao dịch đã submit hoàn thành
+uint8_t i2c_txn_wait(i2c_txn_t *txn)
+{
+  while (txn->status == I2C_TXN_BUSY); // ISR sẽ cập nhật status
+  return (txn->status != I2C_TXN_DONE);
+}
+
+// State machine của engine - mỗi sự kiện TWI (START sent, byte sent/received...)
+// tạo một lần vào ISR, nên main loop không bao giờ chờ bus
+ISR(TWI_vect)
+{
+  i2c_txn_t *txn = i2c_active_txn;
+  if (txn == NULL) { // Sự kiện lạc (không có giao dịch) - nhả bus
+    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+    return;
+  }
+
+  switch (TW_STATUS) {
+
+    case TW_START: // START đã gửi - gửi SLA+W (luôn ghi địa chỉ register trước)
+      TWDR = (txn->address << 1);
+      TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      break;
+
+    case TW_REP_START: // Repeated START - chuyển sang chế độ đọc
+      TWDR = (txn->address << 1) | 1;
+      TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      break;
+
+    case TW_MT_SLA_ACK: // SLA+W được ACK - gửi byte địa chỉ register đầu tiên
+      if (i2c_reg_remaining == 2) { TWDR = (txn->reg >> 8) & 0xFF; }
+      else { TWDR = txn->reg & 0xFF; }
+      i2c_reg_remaining--;
+      TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      break;
+
+    case TW_MT_DATA_ACK: // Byte ghi được ACK
+      if (i2c_reg_remaining) { // Còn byte địa chỉ register (LSB của register 16-bit)
+        TWDR = txn->reg & 0xFF;
+        i2c_reg_remaining--;
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      } else if (txn->rw == I2C_TXN_READ) { // Đã ghi xong register - repeated START để đọc
+        TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+      } else if (i2c_data_index < txn->length) { // Còn dữ liệu cần ghi
+        TWDR = txn->data[i2c_data_index++];
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+      } else { // Ghi xong
+        i2c_txn_finish(I2C_TXN_DONE);
+      }
+      break;
+
+    case TW_MR_SLA_ACK: // SLA+R được ACK - chuẩn bị nhận byte đầu
+      if (txn->length > 1) {
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWEA) | (1 << TWIE); // ACK byte tiếp
+      } else {
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE); // NACK ngay (chỉ 1 byte)
+      }
+      break;
+
+    case TW_MR_DATA_ACK: // Nhận byte, đã gửi ACK
+      txn->data[i2c_data_index++] = TWDR;
+      if (i2c_data_index < (uint8_t)(txn->length - 1)) {
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWEA) | (1 << TWIE); // Tiếp tục ACK
+      } else {
+        TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE); // Byte cuối: NACK
+      }
+      break;
+
+    case TW_MR_DATA_NACK: // Nhận byte cuối, đã gửi NACK
+      txn->data[i2c_data_index++] = TWDR;
+      i2c_txn_finish(I2C_TXN_DONE);
+      break;
+
+    default: // NACK từ slave, arbitration lost, hoặc bus error
+      i2c_txn_finish(I2C_TXN_ERROR);
+      break;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Các hàm polled cấp thấp (legacy) - chỉ dùng khi engine rảnh
+// ---------------------------------------------------------------------------
+
 // Bắt đầu truyền I2C với địa chỉ thiết bị
 uint8_t i2c_start(uint8_t address)
 {
   uint8_t twst;
-  
+
   TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN); // Gửi START
   while (!(TWCR & (1 << TWINT))); // Chờ hoàn thành
-  
+
   twst = TW_STATUS & 0xF8;
   if ((twst != TW_START) && (twst != TW_REP_START)) return 1;
-  
+
   TWDR = address; // Gửi địa chỉ thiết bị (8-bit)
   TWCR = (1 << TWINT) | (1 << TWEN);
   while (!(TWCR & (1 << TWINT))); // Chờ hoàn thành
-  
+
   twst = TW_STATUS & 0xF8; // Kiểm tra ACK
   if ((twst != TW_MT_SLA_ACK) && (twst != TW_MR_SLA_ACK)) return 1;
-  
+
   return 0;
 }
 
@@ -64,14 +207,14 @@ void i2c_stop(void)
 uint8_t i2c_write(uint8_t data)
 {
   uint8_t twst;
-  
+
   TWDR = data;
   TWCR = (1 << TWINT) | (1 << TWEN);
   while (!(TWCR & (1 << TWINT))); // Chờ hoàn thành
-  
+
   twst = TW_STATUS & 0xF8;
   if (twst != TW_MT_DATA_ACK) return 1; // Không có ACK
-  
+
   return 0;
 }
 
@@ -91,75 +234,120 @@ uint8_t i2c_read_nack(void)
   return TWDR;
 }
 
+// ---------------------------------------------------------------------------
+// Bus fault recovery
+// ---------------------------------------------------------------------------
+
+// Recovery bus bị kẹt: slave có thể đang giữ SDA thấp giữa chừng một byte
+// (do glitch hoặc master reset giữa giao dịch). Tắt TWI, bit-bang tối đa 9
+// xung SCL để slave đẩy nốt byte dở dang ra, phát STOP rồi khởi tạo lại TWI.
+// CHỈ gọi từ main context (không gọi trong ISR).
+void i2c_bus_recover(void)
+{
+  uint8_t i;
+
+  TWCR = 0; // Tắt TWI để pin SDA/SCL trở về GPIO thường
+
+  // SCL output (thả cao qua pull-up bên ngoài khi PORT=1), SDA input có pull-up
+  I2C_SCL_DDR |= (1<<I2C_SCL_BIT);
+  I2C_SCL_PORT |= (1<<I2C_SCL_BIT);
+  I2C_SDA_DDR &= ~(1<<I2C_SDA_BIT);
+  I2C_SDA_PORT |= (1<<I2C_SDA_BIT);
+  delay_us(10);
+
+  // Clock tối đa 9 xung cho đến khi slave nhả SDA (I2C spec: 9 clock đủ cho
+  // byte dở dang + bit ACK)
+  for (i = 0; i < 9; i++) {
+    if (I2C_SDA_PIN & (1<<I2C_SDA_BIT)) { break; } // SDA đã cao - bus thông
+    I2C_SCL_PORT &= ~(1<<I2C_SCL_BIT);
+    delay_us(10);
+    I2C_SCL_PORT |= (1<<I2C_SCL_BIT);
+    delay_us(10);
+  }
+
+  // Phát STOP bằng tay: SDA thấp -> cao trong khi SCL cao
+  I2C_SDA_DDR |= (1<<I2C_SDA_BIT);
+  I2C_SDA_PORT &= ~(1<<I2C_SDA_BIT);
+  delay_us(10);
+  I2C_SDA_PORT |= (1<<I2C_SDA_BIT);
+  delay_us(10);
+
+  // Trả pin về cho TWI hardware và khởi tạo lại bus
+  I2C_SCL_DDR &= ~(1<<I2C_SCL_BIT);
+  I2C_SDA_DDR &= ~(1<<I2C_SDA_BIT);
+  i2c_active_txn = NULL;
+  i2c_init();
+
+  i2c_consecutive_errors = 0;
+  if (i2c_recovery_count < 255) { i2c_recovery_count++; }
+  i2c_recovery_pending_flag = 1; // Main loop sẽ re-init sensor
+}
+
+// Đọc tổng số lần recovery (báo cáo qua realtime status)
+uint8_t i2c_get_recovery_count(void)
+{
+  return i2c_recovery_count;
+}
+
+// Kiểm tra và xóa cờ recovery - main loop gọi để biết khi nào cần re-init sensor
+uint8_t i2c_recovery_pending(void)
+{
+  if (i2c_recovery_pending_flag) {
+    i2c_recovery_pending_flag = 0;
+    return 1;
+  }
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Các hàm register blocking - wrapper submit + wait trên engine
+// ---------------------------------------------------------------------------
+
+// Thực hiện một giao dịch register blocking qua engine
+// Theo dõi lỗi liên tiếp: đủ I2C_MAX_CONSECUTIVE_ERRORS lần thì chạy recovery
+static uint8_t i2c_txn_run(uint8_t address, uint8_t reg, uint8_t rw, uint8_t *data, uint8_t length)
+{
+  i2c_txn_t txn;
+  txn.address = address;
+  txn.reg = reg;
+  txn.reg_size = 1;
+  txn.rw = rw;
+  txn.data = data;
+  txn.length = length;
+  txn.callback = NULL;
+  while (i2c_submit(&txn)); // Chờ engine rảnh rồi submit
+  if (i2c_txn_wait(&txn)) {
+    if (++i2c_consecutive_errors >= I2C_MAX_CONSECUTIVE_ERRORS) {
+      i2c_bus_recover(); // Chạy từ main context - an toàn
+    }
+    return 1;
+  }
+  i2c_consecutive_errors = 0;
+  return 0;
+}
+
 // Ghi dữ liệu vào register của thiết bị I2C (1 byte)
 uint8_t i2c_write_register(uint8_t address, uint8_t reg, uint8_t data)
 {
-  uint8_t ret;
-  
-  ret = i2c_start(address << 1); // Chuyển 7-bit address sang 8-bit
-  if (ret) { i2c_stop(); return ret; }
-  
-  ret = i2c_write(reg); // Ghi địa chỉ register
-  if (ret) { i2c_stop(); return ret; }
-  
-  ret = i2c_write(data); // Ghi dữ liệu
-  
-  i2c_stop();
-  return ret;
+  return i2c_txn_run(address, reg, I2C_TXN_WRITE, &data, 1);
 }
 
 // Ghi nhiều byte dữ liệu vào register của thiết bị I2C
 uint8_t i2c_write_register_multi(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length)
 {
-  uint8_t i, ret;
-  
-  ret = i2c_start(address << 1);
-  if (ret) { i2c_stop(); return ret; }
-  
-  ret = i2c_write(reg); // Ghi địa chỉ register
-  if (ret) { i2c_stop(); return ret; }
-  
-  for (i = 0; i < length; i++) { // Ghi từng byte
-    ret = i2c_write(data[i]);
-    if (ret) { i2c_stop(); return ret; }
-  }
-  
-  i2c_stop();
-  return 0;
+  return i2c_txn_run(address, reg, I2C_TXN_WRITE, data, length);
 }
 
 // Đọc dữ liệu từ register của thiết bị I2C (1 byte)
 uint8_t i2c_read_register(uint8_t address, uint8_t reg)
 {
   uint8_t data;
-  
-  if (i2c_start(address << 1)) { i2c_stop(); return 0; } // Chế độ ghi
-  if (i2c_write(reg)) { i2c_stop(); return 0; } // Ghi địa chỉ register
-  if (i2c_restart((address << 1) | 1)) { i2c_stop(); return 0; } // Chuyển sang đọc
-  
-  data = i2c_read_nack(); // Đọc 1 byte (NACK)
-  i2c_stop();
-  
+  if (i2c_txn_run(address, reg, I2C_TXN_READ, &data, 1)) { return 0; }
   return data;
 }
 
 // Đọc nhiều byte dữ liệu từ register của thiết bị I2C
 uint8_t i2c_read_register_multi(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length)
 {
-  uint8_t i;
-  
-  if (i2c_start(address << 1)) { i2c_stop(); return 1; } // Chế độ ghi
-  if (i2c_write(reg)) { i2c_stop(); return 1; } // Ghi địa chỉ register
-  if (i2c_restart((address << 1) | 1)) { i2c_stop(); return 1; } // Chuyển sang đọc
-  
-  for (i = 0; i < length; i++) {
-    if (i == (length - 1)) {
-      data[i] = i2c_read_nack(); // Byte cuối: NACK
-    } else {
-      data[i] = i2c_read_ack(); // Các byte đầu: ACK
-    }
-  }
-  
-  i2c_stop();
-  return 0;
+  return i2c_txn_run(address, reg, I2C_TXN_READ, data, length);
 }
@@ -1,16 +1,18 @@
 /*
   i2c.h - Header file cho module giao tiếp I2C (TWI)
-  
+
   CHỨC NĂNG:
   - Cung cấp các hàm giao tiếp I2C cơ bản cho Arduino Uno
   - Hỗ trợ đọc/ghi register của thiết bị I2C (như VL53L0X)
   - Sử dụng TWI hardware trên ATmega328P
+  - Engine giao dịch bất đồng bộ chạy bằng TWI ISR: submit descriptor,
+    main loop tiếp tục chạy (st_prep_buffer, serial) trong khi bus bận
   - Tốc độ I2C: 100kHz (Standard Mode)
-  
+
   PHẦN CỨNG:
   - SDA: Pin A4 (PC4)
   - SCL: Pin A5 (PC5)
-  
+
   Part of Grbl
   Copyright (c) 2024
 */
@@ -20,14 +22,74 @@
 
 #include "grbl.h"
 
-// Tốc độ bus I2C - 100kHz ở chế độ chuẩn
-#define I2C_SCL_FREQ 100000L
+// Tốc độ bus I2C - chọn runtime qua setting $30 (i2c fast mode)
+#define I2C_SCL_FREQ      100000L // Standard Mode - 100kHz
+#define I2C_SCL_FREQ_FAST 400000L // Fast Mode - 400kHz (VL53L0X và VL53L1 đều hỗ trợ)
+
+// Trạng thái của một giao dịch I2C bất đồng bộ
+#define I2C_TXN_IDLE  0  // Descriptor chưa được submit
+#define I2C_TXN_BUSY  1  // Đang chạy trong TWI ISR
+#define I2C_TXN_DONE  2  // Hoàn thành, dữ liệu hợp lệ
+#define I2C_TXN_ERROR 3  // Lỗi bus (NACK hoặc arbitration lost)
+
+// Hướng giao dịch
+#define I2C_TXN_WRITE 0
+#define I2C_TXN_READ  1
+
+// Số giao dịch lỗi liên tiếp trước khi chạy bus recovery
+#define I2C_MAX_CONSECUTIVE_ERRORS 3
+
+// Descriptor một giao dịch register read/write hoàn chỉnh.
+// ISR tự thực hiện: START -> SLA+W -> reg -> (data/STOP hoặc REP_START -> SLA+R -> data -> STOP)
+typedef struct i2c_txn {
+  uint8_t address;               // Địa chỉ I2C của thiết bị (7-bit)
+  uint16_t reg;                  // Địa chỉ register (VL53L0X: 8-bit, VL53L1: 16-bit)
+  uint8_t reg_size;              // Số byte địa chỉ register: 1 hoặc 2
+  uint8_t rw;                    // I2C_TXN_WRITE hoặc I2C_TXN_READ
+  uint8_t *data;                 // Buffer dữ liệu ghi/đọc
+  uint8_t length;                // Số byte dữ liệu
+  volatile uint8_t status;       // I2C_TXN_IDLE/BUSY/DONE/ERROR - ISR cập nhật
+  void (*callback)(struct i2c_txn *txn); // Gọi trong ISR khi xong (NULL nếu không dùng)
+} i2c_txn_t;
 
 // Khởi tạo bus I2C (TWI - Two Wire Interface)
 void i2c_init(void);
 
+// Đặt tốc độ bus: fast_mode=0 -> 100kHz, fast_mode=1 -> 400kHz
+// Gọi từ i2c_init() và khi setting $30 thay đổi
+void i2c_set_speed(uint8_t fast_mode);
+
+// Submit một giao dịch cho TWI ISR engine
+// Trả về: 0 nếu đã nhận, 1 nếu bus đang bận (thử lại sau)
+uint8_t i2c_submit(i2c_txn_t *txn);
+
+// Kiểm tra engine có đang thực hiện giao dịch không
+// Trả về: 1 nếu bận, 0 nếu rảnh
+uint8_t i2c_busy(void);
+
+// Chờ (blocking) đến khi giao dịch đã submit hoàn thành
+// Trả về: 0 nếu thành công, 1 nếu lỗi bus
+uint8_t i2c_txn_wait(i2c_txn_t *txn);
+
+// Recovery bus bị kẹt: bit-bang 9 xung SCL để slave nhả SDA, phát STOP,
+// khởi tạo lại TWI. Tự động gọi sau I2C_MAX_CONSECUTIVE_ERRORS lỗi liên tiếp.
+// CHỈ gọi từ main context.
+void i2c_bus_recover(void);
+
+// Đọc tổng số lần bus recovery từ khi bật nguồn (báo trong realtime status)
+uint8_t i2c_get_recovery_count(void);
+
+// Kiểm tra và xóa cờ recovery pending
+// Trả về: 1 nếu vừa có recovery (main loop cần re-init sensor), 0 nếu không
+uint8_t i2c_recovery_pending(void);
+
+// ---------------------------------------------------------------------------
+// Các hàm polled cấp thấp (legacy). CHỈ dùng khi engine rảnh (i2c_busy() == 0),
+// vì chúng điều khiển TWCR trực tiếp không qua ISR.
+// ---------------------------------------------------------------------------
+
 // Bắt đầu truyền I2C với địa chỉ thiết bị
-// address: địa chỉ I2C của thiết bị (7-bit)
+// address: địa chỉ I2C của thiết bị (8-bit, đã dịch trái)
 // Trả về: 0 nếu thành công, 1 nếu lỗi
 uint8_t i2c_start(uint8_t address);
 
@@ -52,6 +114,11 @@ uint8_t i2c_read_ack(void);
 // Trả về: byte đọc được
 uint8_t i2c_read_nack(void);
 
+// ---------------------------------------------------------------------------
+// Các hàm register blocking - wrapper trên engine bất đồng bộ (submit + wait).
+// Giữ nguyên API cũ cho driver sensor.
+// ---------------------------------------------------------------------------
+
 // Ghi dữ liệu vào register của thiết bị I2C
 // address: địa chỉ I2C của thiết bị (7-bit)
 // reg: địa chỉ register cần ghi
@@ -20,6 +20,7 @@
 */
 
 #include "grbl.h"
+#include "vl53l1.h"  // Driver sensor VL53L1
 
 // Biến toàn cục hệ thống
 system_t sys; 
@@ -27,20 +28,55 @@ system_t sys;
 
 int main(void)
 {
+  // Chốt lý do reset và tắt watchdog NGAY đầu main: sau watchdog reset WDRF
+  // giữ WDE bật với timeout ngắn nhất - không tắt sớm thì MCU reset lặp vô hạn
+  uint8_t mcusr_copy = MCUSR;
+  MCUSR = 0;
+  wdt_disable();
+
   // Khởi tạo hệ thống khi bật nguồn.
   serial_init();   // Thiết lập tốc độ baud serial và ngắt
   settings_init(); // Tải cài đặt Grbl từ EEPROM
   i2c_init();      // Khởi tạo bus I2C cho sensor VL53L0X
   stepper_init();  // Cấu hình chân stepper và bộ hẹn giờ ngắt
   system_init();   // Cấu hình chân và ngắt thay đổi chân
+  micros_init();   // Timebase microsecond cho timestamp kết quả đo
   
   memset(&sys, 0, sizeof(system_t));
   sys.abort = true;
+
+  #ifdef POSITION_CHECKPOINT
+    // Fast-restore: nạp vị trí máy từ checkpoint EEPROM của phiên trước -
+    // soft limit có hiệu lực ngay và (kèm HOMING_INIT_LOCK bên dưới) bỏ
+    // qua ~30 giây homing đầu phiên khi checkpoint còn hợp lệ
+    uint8_t position_restored = settings_read_position_checkpoint(sys.position);
+  #endif
+  #ifdef WATCHDOG_SUPERVISION
+    // Reset vừa rồi do watchdog? Stash .noinit tươi hơn checkpoint EEPROM
+    // (chép đúng lúc treo) - nạp đè và lát nữa báo host để resume scan
+    uint8_t wdt_resumed = system_wdt_restore(mcusr_copy, sys.position);
+    #ifdef POSITION_CHECKPOINT
+      if (wdt_resumed) { position_restored = 1; }
+    #endif
+  #endif
   sei(); // Bật ngắt
-  
+
+  #ifdef WATCHDOG_SUPERVISION
+    if (wdt_resumed) {
+      // Báo trạng thái đã cứu được cho host TRƯỚC mọi output khác của phiên:
+      // GUI thấy dòng này thì tiếp tục từ điểm cuối thay vì quét lại từ đầu
+      report_wdt_resume(sys.position, sys_wdt_stash.scan_active, sys_wdt_stash.scan_points_done);
+    }
+    system_wdt_init(); // Bật giám sát - pet nằm trong protocol_execute_realtime
+  #endif
+
   // Thiết lập alarm nếu homing được bật
   #ifdef HOMING_INIT_LOCK
-    if (bit_istrue(settings.flags,BITFLAG_HOMING_ENABLE)) { sys.state = STATE_ALARM; }
+    #ifdef POSITION_CHECKPOINT
+      if (bit_istrue(settings.flags,BITFLAG_HOMING_ENABLE) && (!position_restored)) { sys.state = STATE_ALARM; }
+    #else
+      if (bit_istrue(settings.flags,BITFLAG_HOMING_ENABLE)) { sys.state = STATE_ALARM; }
+    #endif
   #endif
   
   #ifdef FORCE_INITIALIZATION_ALARM
@@ -50,19 +86,23 @@ int main(void)
   // Vòng lặp chính: khởi tạo và xử lý reset
   for(;;) {
     // Reset các hệ thống
+    settings_flush_sync(); // Thay đổi settings chưa xuống EEPROM - ghi nốt
     serial_reset_read_buffer();
     gc_init();
     spindle_init();
     coolant_init();
     limits_init(); 
     probe_init();
-    // Khởi tạo sensor (giống code mẫu: sensor.init())
-    if (vl53l0x_init()) {
-      // Cấu hình sensor (giống code mẫu: sensor.setTimeout(500))
-      vl53l0x_setTimeout(500);
-      // Khởi động continuous mode với period 100ms (giống code mẫu: sensor.startContinuous(100))
-      vl53l0x_startContinuous(100);
-    }
+    #ifdef DUAL_TOF_SENSORS
+      // Giữ VL53L1 trong reset (XSHUT thấp) để VL53L0X - cùng địa chỉ mặc định
+      // 0x29 - được init một mình trên bus trước
+      VL53L1_XSHUT_DDR |= VL53L1_XSHUT_MASK;
+      VL53L1_XSHUT_PORT &= ~(VL53L1_XSHUT_MASK);
+    #endif
+    // Sensor ToF KHÔNG init ở đây nữa - bring-up trễ ở lệnh đo đầu tiên của
+    // phiên (protocol_sensor_lazy_init trong protocol.c). Trước đây hai lần
+    // _delay_ms(100) cộng config sequence chạy ngay tại đây, mỗi reset/GUI
+    // reconnect trả ~200ms chết trước khi protocol_main_loop nhận lệnh.
     plan_reset();
     st_reset();
 
@@ -0,0 +1,57 @@
+/*
+  micros.c - Implementation timebase microsecond trên Timer2
+
+  Timer2 chạy fast PWM 8-bit, prescaler 1/8: tick 0.5us, overflow mỗi 128us.
+  ISR chỉ tăng một bộ đếm overflow 32-bit; micros_now() ghép bộ đếm với TCNT2
+  rồi chia 2 để ra microsecond.
+
+  LƯU Ý XUNG ĐỘT: spindle_set_state() (VARIABLE_SPINDLE, 328p) ghi TCCR2A/
+  TCCR2B với đúng mode và prescaler này - chỉ bật/tắt thêm bit COM2A1 cho
+  output PWM. Timebase vì vậy vẫn đếm đều kể cả khi spindle bật, miễn là
+  không module nào đổi prescaler Timer2.
+
+  Part of Grbl
+  Copyright (c) 2024
+*/
+
+#include "micros.h"
+
+// Số lần Timer2 overflow từ khi bật nguồn - mỗi overflow là 128us (256 tick)
+static volatile uint32_t micros_ovf_count = 0;
+
+ISR(TIMER2_OVF_vect)
+{
+  micros_ovf_count++;
+}
+
+// Khởi tạo Timer2: fast PWM 8-bit, prescaler 1/8, overflow interrupt
+void micros_init(void)
+{
+  #if defined(__AVR_ATmega328P__)
+    TCCR2A = (1<<WGM21) | (1<<WGM20);               // Fast PWM, output tắt
+    TCCR2B = (TCCR2B & 0b11111000) | (1<<CS21);     // Prescaler 1/8 -> 2MHz
+    TIMSK2 |= (1<<TOIE2);                           // Bật overflow interrupt
+  #else
+    // Mega2560: spindle PWM dùng Timer4, Timer2 hoàn toàn rảnh
+    TCCR2A = (1<<WGM21) | (1<<WGM20);
+    TCCR2B = (TCCR2B & 0b11111000) | (1<<CS21);
+    TIMSK2 |= (1<<TOIE2);
+  #endif
+}
+
+// Đọc đồng hồ microsecond hiện tại
+// Xử lý race: nếu overflow xảy ra ngay sau khi đọc TCNT2 (TOV2 pending và
+// TCNT2 nhỏ), cộng thêm một overflow cho kết quả nhất quán
+uint32_t micros_now(void)
+{
+  uint32_t ovf;
+  uint8_t tcnt;
+  uint8_t sreg = SREG;
+  cli();
+  ovf = micros_ovf_count;
+  tcnt = TCNT2;
+  if ((TIFR2 & (1<<TOV2)) && (tcnt < 255)) { ovf++; }
+  SREG = sreg;
+  // (ovf * 256 + tcnt) tick, mỗi tick 0.5us
+  return ((ovf << 8) | tcnt) >> 1;
+}
@@ -0,0 +1,32 @@
+/*
+  micros.h - Header file cho timebase microsecond
+
+  CHỨC NĂNG:
+  - Đồng hồ microsecond 32-bit chạy tự do trên Timer2
+  - Gắn timestamp cho mỗi kết quả đo khoảng cách (lệnh READ_VL53L0X_T)
+  - Cho phép host nội suy góc bàn quay tại thời điểm lấy mẫu khi quét
+    liên tục, không cần dừng motor cho từng điểm
+
+  PHẦN CỨNG:
+  - Timer2, prescaler 1/8 (2MHz @ 16MHz) - cùng mode/prescaler mà
+    spindle PWM (VARIABLE_SPINDLE trên 328p) ghi vào, nên hai bên
+    dùng chung timer không xung đột
+
+  Part of Grbl
+  Copyright (c) 2024
+*/
+
+#ifndef micros_h
+#define micros_h
+
+#include "grbl.h"
+
+// Khởi tạo Timer2 free-running và bật overflow interrupt
+// Gọi một lần trong main() trước sei()
+void micros_init(void);
+
+// Đọc đồng hồ microsecond 32-bit (wrap sau ~71.6 phút)
+// An toàn gọi từ main context - tạm tắt ngắt khi đọc để nhất quán
+uint32_t micros_now(void);
+
+#endif
@@ -331,6 +331,10 @@ void mc_reset()
       if (sys.state == STATE_HOMING) { bit_true_atomic(sys_rt_exec_alarm, EXEC_ALARM_HOMING_FAIL); }
       else { bit_true_atomic(sys_rt_exec_alarm, EXEC_ALARM_ABORT_CYCLE); }
       st_go_idle(); // Force kill steppers. Position has likely been lost.
+      #ifdef POSITION_CHECKPOINT
+        // Checkpoint EEPROM không còn khớp vị trí thật - đóng đường fast-restore
+        settings_checkpoint_invalidate();
+      #endif
     }
   }
 }
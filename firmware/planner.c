@@ -267,6 +267,7 @@ uint8_t plan_check_full_buffer()
   int32_t target_steps[N_AXIS];
   float unit_vec[N_AXIS], delta_mm;
   uint8_t idx;
+  uint8_t moving_axes = 0; // Đếm trục có chuyển động - cho fast path một trục bên dưới
   #ifdef COREXY
     target_steps[A_MOTOR] = lround(target[A_MOTOR]*settings.steps_per_mm[A_MOTOR]);
     target_steps[B_MOTOR] = lround(target[B_MOTOR]*settings.steps_per_mm[B_MOTOR]);
@@ -304,8 +305,16 @@ uint8_t plan_check_full_buffer()
     
     // Incrementally compute total move distance by Euclidean norm. First add square of each term.
     block->millimeters += delta_mm*delta_mm;
+    if (delta_mm != 0.0) { moving_axes++; }
+  }
+  if (moving_axes == 1) {
+    // Fast path một trục: norm Euclid suy biến thành |delta|. Scan độ phân
+    // giải mịn đẩy hàng trăm segment quay 0.002mm chỉ có trục X - mỗi segment
+    // tiết kiệm một sqrt() float (~500 cycle AVR) trên đường append nóng.
+    for (idx=0; idx<N_AXIS; idx++) { if (unit_vec[idx] != 0.0) { block->millimeters = fabs(unit_vec[idx]); break; } }
+  } else {
+    block->millimeters = sqrt(block->millimeters); // Complete millimeters calculation with sqrt()
   }
-  block->millimeters = sqrt(block->millimeters); // Complete millimeters calculation with sqrt()
   
   // Bail if this is a zero-length block. Highly unlikely to occur.
   if (block->step_event_count == 0) { return; } 
@@ -372,8 +381,14 @@ uint8_t plan_check_full_buffer()
     */
     // NOTE: Computed without any expensive trig, sin() or acos(), by trig half angle identity of cos(theta).
     if (junction_cos_theta > 0.999999) {
-      //  For a 0 degree acute junction, just set minimum junction speed. 
+      //  For a 0 degree acute junction, just set minimum junction speed.
       block->max_junction_speed_sqr = MINIMUM_JUNCTION_SPEED*MINIMUM_JUNCTION_SPEED;
+    } else if (junction_cos_theta < -0.999999) {
+      // Junction thẳng hàng (theta ~ 180°) - toàn bộ chuỗi segment cùng hướng
+      // của scan rơi vào đây. Tốc độ junction không bị hình học giới hạn
+      // (max_entry_speed_sqr vẫn cap theo nominal speed bên dưới) - bỏ được
+      // sqrt + phép chia của nhánh tổng quát trên đường append nóng.
+      block->max_junction_speed_sqr = SOME_LARGE_VALUE;
     } else {
       junction_cos_theta = max(junction_cos_theta,-0.999999); // Check for numerical round-off to avoid divide by zero.
       float sin_theta_d2 = sqrt(0.5*(1.0-junction_cos_theta)); // Trig half angle identity. Always positive.
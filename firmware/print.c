@@ -85,23 +85,76 @@ void print_uint8_base10(uint8_t n)
 }
 
 
+// Bảng tra hai chữ số "00".."99" trong PROGMEM - mỗi lần tra thay cho hai
+// lần chia, nửa số vòng lặp khi sinh chữ số
+static const char print_digit_pairs[] PROGMEM =
+  "00010203040506070809101112131415161718192021222324"
+  "25262728293031323334353637383940414243444546474849"
+  "50515253545556575859606162636465666768697071727374"
+  "75767778798081828384858687888990919293949596979899";
+
+// Điền cặp chữ số của r (0-99) vào buf[i-2], buf[i-1] - trả về i-2
+static uint8_t print_pair_to_buf(uint8_t r, char *buf, uint8_t i)
+{
+  const char *pair = &print_digit_pairs[(uint16_t)r << 1];
+  buf[--i] = pgm_read_byte(pair + 1);
+  buf[--i] = pgm_read_byte(pair);
+  return i;
+}
+
+// In uint16 base 10 - đường nóng của báo khoảng cách (mm luôn <= 8190)
+// Chia 100 bằng nhân nghịch đảo (n*5243 >> 19, đúng cho mọi uint16) thay cho
+// __udivmodhi4 của libgcc, cộng bảng tra hai chữ số: nhanh hơn nhiều lần so
+// với vòng %10 / /10 cũ trên AVR không có lệnh chia
+void print_uint16_base10(uint16_t n)
+{
+  char buf[5];
+  uint8_t i = 5;
+  while (n >= 100) {
+    uint16_t q = (uint16_t)(((uint32_t)n * 5243UL) >> 19); // n/100 chính xác với n <= 65535
+    i = print_pair_to_buf((uint8_t)(n - q*100), buf, i);
+    n = q;
+  }
+  if (n >= 10) {
+    i = print_pair_to_buf((uint8_t)n, buf, i);
+  } else {
+    buf[--i] = '0' + (uint8_t)n;
+  }
+  for (; i < 5; i++) { serial_write(buf[i]); }
+}
+
+
 void print_uint32_base10(uint32_t n)
-{ 
-  if (n == 0) {
-    serial_write('0');
+{
+  // Đường nhanh: giá trị 16-bit (đa số counter/khoảng cách) né hẳn chia 32-bit
+  if (n <= 0xFFFFUL) {
+    print_uint16_base10((uint16_t)n);
     return;
-  } 
+  }
 
-  unsigned char buf[10]; 
-  uint8_t i = 0;  
-  
-  while (n > 0) {
-    buf[i++] = n % 10;
-    n /= 10;
+  char buf[10];
+  uint8_t i = 10;
+
+  // Rút mỗi vòng hai chữ số bằng một lần chia 100 32-bit (__udivmodsi4) -
+  // nửa số lần gọi so với chia 10 từng chữ số; phần còn lại <= 65535 đi
+  // đường nhân nghịch đảo 16-bit
+  while (n > 0xFFFFUL) {
+    uint32_t q = n / 100;
+    i = print_pair_to_buf((uint8_t)(n - q*100), buf, i);
+    n = q;
   }
-    
-  for (; i > 0; i--)
-    serial_write('0' + buf[i-1]);
+  uint16_t m = (uint16_t)n;
+  while (m >= 100) {
+    uint16_t q = (uint16_t)(((uint32_t)m * 5243UL) >> 19);
+    i = print_pair_to_buf((uint8_t)(m - q*100), buf, i);
+    m = q;
+  }
+  if (m >= 10) {
+    i = print_pair_to_buf((uint8_t)m, buf, i);
+  } else {
+    buf[--i] = '0' + (uint8_t)m;
+  }
+  for (; i < 10; i++) { serial_write(buf[i]); }
 }
 
 
@@ -24,6 +24,10 @@ void printPgmString(const char *s);
 // In số nguyên
 void printInteger(long n);
 
+// In số nguyên không dấu 16-bit (base 10) - đường nhanh cho báo khoảng cách:
+// chia bằng nhân nghịch đảo + bảng tra hai chữ số, không gọi hàm chia libgcc
+void print_uint16_base10(uint16_t n);
+
 // In số nguyên không dấu 32-bit (base 10)
 void print_uint32_base10(uint32_t n);
 
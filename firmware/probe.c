@@ -13,6 +13,8 @@
   
 #include "grbl.h"
 
+#ifndef SCANNER_BUILD // Máy scan không có đầu dò - header cung cấp stub no-op
+
 // Mask đảo ngược probe pin state tùy theo cài đặt và probing cycle mode
 uint8_t probe_invert_mask;
 
@@ -53,3 +55,5 @@ void probe_state_monitor()
     }
   }
 }
+
+#endif // SCANNER_BUILD
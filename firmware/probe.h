@@ -18,6 +18,19 @@
 #define PROBE_OFF     0 // Probing tắt hoặc không sử dụng (phải là 0)
 #define PROBE_ACTIVE  1 // Đang theo dõi input pin
 
+#ifdef SCANNER_BUILD
+
+// Máy scan không có đầu dò - probe.c bị loại khỏi build (xem SCANNER_BUILD
+// trong config.h). G38.x vẫn parse được nhưng pin luôn đọc "không kích hoạt"
+// nên chu trình kết thúc bằng alarm probe fail. Bỏ probe_state_monitor khỏi
+// stepper ISR cũng bớt được vài cycle mỗi tick
+#define probe_init()
+#define probe_configure_invert_mask(is_probe_away)
+#define probe_get_state() 0
+#define probe_state_monitor()
+
+#else
+
 // Khởi tạo probe pin
 void probe_init();
 
@@ -34,4 +47,6 @@ uint8_t probe_get_state();
 // Được gọi bởi stepper ISR mỗi ISR tick
 void probe_state_monitor();
 
+#endif // SCANNER_BUILD
+
 #endif
@@ -20,8 +20,447 @@
 #define COMMENT_TYPE_PARENTHESES 1    // Comment dạng ( ... )
 #define COMMENT_TYPE_SEMICOLON 2      // Comment dạng ; ...
 
-// Buffer dòng để thực thi (zero-terminated)
-static char line[LINE_BUFFER_SIZE];
+// Buffer dòng kép (zero-terminated): một dòng đưa cho thực thi, một dòng gom
+// trước từ serial. protocol_line_prefetch() được gọi cả từ các checkpoint
+// realtime nên dòng kế được ráp sẵn TRONG LÚC dòng hiện tại còn chạy - xem
+// doc của hàm đó bên dưới.
+static char line_buffer[2][LINE_BUFFER_SIZE];
+static char *line = line_buffer[0];      // Dòng hoàn chỉnh đưa cho thực thi
+static char *line_next = line_buffer[1]; // Dòng đang gom từ serial
+static uint8_t line_ready = 0;    // line_next đã đủ một dòng, chờ main loop
+static uint8_t line_overflow = 0; // Dòng đang gom bị tràn - tiêu thụ sẽ báo lỗi
+
+// State machine lệnh sensor non-blocking: READ_VL53L0X / READ_VL53L1 chỉ ghi
+// nhận yêu cầu rồi trả quyền cho main loop; protocol_sensor_poll() kiểm tra
+// data-ready mỗi vòng và gửi kết quả + "ok" khi sample sẵn sàng. Trước đây
+// lệnh đọc có thể ngồi trong timeout loop 500ms - st_prep_buffer không được
+// gọi và segment buffer trong stepper.c cạn, khựng chuyển động giữa scan.
+#define SENSOR_REQ_NONE        0
+#define SENSOR_REQ_VL53L0X     1
+#define SENSOR_REQ_VL53L1      2
+#define SENSOR_REQ_VL53L0X_EXT 3 // Kèm range status + signal/ambient rate
+static uint8_t sensor_req = SENSOR_REQ_NONE;
+static uint32_t sensor_req_start_us; // micros_now() lúc nhận lệnh - để timeout
+
+// Chế độ timing (lệnh TIMING=1): sau mỗi reply sensor gửi thêm dòng
+// "TIMING:<us nhận lệnh>,<us xong đo>" theo timebase micros_now() - GUI ghép
+// với timestamp host để tách chi phí chuyển động / settle / đo / serial /
+// xử lý Python cho từng điểm
+static uint8_t timing_mode = 0;
+
+// Timeout chờ sample cho yêu cầu sensor đang treo (micro giây)
+#define SENSOR_REQ_TIMEOUT_US 500000UL
+
+// Gửi kết quả đo một sensor theo chế độ telemetry hiện tại
+static void protocol_sensor_reply(uint8_t telem_type, const char *prefix_pgm, uint16_t distance)
+{
+  if (telemetry_binary_mode) {
+    uint8_t payload[2];
+    payload[0] = distance & 0xFF; payload[1] = (distance >> 8) & 0xFF;
+    report_telemetry_frame(telem_type, payload, 2);
+  } else {
+    printPgmString(prefix_pgm);
+    print_uint16_base10(distance);
+    printPgmString(PSTR("\r\n"));
+  }
+  report_status_message(STATUS_OK);
+}
+
+// Gửi kết quả đo mở rộng (lệnh READ_VL53L0X_E): distance kèm các trường chất
+// lượng của cùng result block. distance = 0 vẫn nghĩa là lỗi/timeout như lệnh
+// thường - các trường kèm theo khi đó là của lần harvest trước, host bỏ qua.
+static void protocol_sensor_reply_ext(uint16_t distance)
+{
+  uint8_t status = vl53l0x_lastRangeStatus();
+  uint16_t signal = vl53l0x_lastSignalRate();
+  uint16_t ambient = vl53l0x_lastAmbientRate();
+  if (telemetry_binary_mode) {
+    uint8_t payload[7];
+    payload[0] = distance & 0xFF; payload[1] = (distance >> 8) & 0xFF;
+    payload[2] = status;
+    payload[3] = signal & 0xFF; payload[4] = (signal >> 8) & 0xFF;
+    payload[5] = ambient & 0xFF; payload[6] = (ambient >> 8) & 0xFF;
+    report_telemetry_frame(TELEM_TYPE_EXT, payload, 7);
+  } else {
+    // "VL53L0X_EXT:distance,status,signal,ambient" - rate là MCPS 9.7 thô
+    printPgmString(PSTR("VL53L0X_EXT:"));
+    print_uint16_base10(distance);
+    serial_write(',');
+    print_uint8_base10(status);
+    serial_write(',');
+    print_uint16_base10(signal);
+    serial_write(',');
+    print_uint16_base10(ambient);
+    printPgmString(PSTR("\r\n"));
+  }
+  report_status_message(STATUS_OK);
+}
+
+// Gửi dòng timing cho yêu cầu sensor vừa reply (chỉ chế độ ASCII - khung
+// binary đã có timestamp riêng qua TELEM_TYPE_SAMPLE_T)
+static void protocol_timing_reply(void)
+{
+  if (!timing_mode || telemetry_binary_mode) { return; }
+  printPgmString(PSTR("TIMING:"));
+  print_uint32_base10(sensor_req_start_us);
+  serial_write(',');
+  print_uint32_base10(micros_now());
+  printPgmString(PSTR("\r\n"));
+}
+
+// Stream delta nén cho burst ($B=2): ở độ phân giải góc mịn các sample liền
+// nhau chỉ lệch vài mm - gửi mỗi sample một frame 7 byte (hay một mục ASCII
+// ~5 byte) phí gần hết băng thông cho phần lặp lại. TELEM_TYPE_DELTA gom
+// nhiều sample một frame: 2 byte đầu payload là keyframe tuyệt đối (u16
+// little-endian), các byte sau là delta zigzag-varint so với sample liền
+// trước (LEB128: 7 bit data + 1 bit continue; zigzag xếp số âm nhỏ vào giá
+// trị chẵn lẻ thấp nên delta ±63mm gọn trong MỘT byte). Mỗi frame tự chứa
+// keyframe riêng - mất một frame (CRC hỏng, history hết) chỉ mất các sample
+// trong frame đó, không trôi cả chuỗi delta về sau, và RESEND hoạt động
+// nguyên trạng. Với delta 1 byte: ~15 sample/frame 21 byte = 1.4 byte/sample,
+// gấp ~3 lần sample/giây của ASCII burst ở cùng baud.
+static uint8_t delta_buf[TELEM_MAX_PAYLOAD];
+static uint8_t delta_len = 0;
+static uint16_t delta_prev; // Sample cuối đã mã hóa - cơ sở cho delta kế
+
+// Đẩy frame delta đang gom ra serial (nếu có) - gọi khi kết thúc burst
+static void protocol_delta_flush(void)
+{
+  if (delta_len == 0) { return; }
+  report_telemetry_frame(TELEM_TYPE_DELTA, delta_buf, delta_len);
+  delta_len = 0;
+}
+
+// Thêm một sample vào frame delta đang gom; tự flush và mở frame mới (kèm
+// keyframe) khi payload không còn đủ chỗ cho varint dài nhất (3 byte cho u16)
+static void protocol_delta_push(uint16_t distance)
+{
+  int16_t delta;
+  uint16_t zz;
+  if (delta_len > (TELEM_MAX_PAYLOAD - 3)) { protocol_delta_flush(); }
+  if (delta_len == 0) {
+    // Mở frame: sample đầu là keyframe tuyệt đối
+    delta_buf[0] = distance & 0xFF;
+    delta_buf[1] = (distance >> 8) & 0xFF;
+    delta_len = 2;
+  } else {
+    delta = (int16_t)(distance - delta_prev);
+    zz = ((uint16_t)delta << 1) ^ ((uint16_t)(delta >> 15)); // Zigzag
+    do {
+      uint8_t b = zz & 0x7F;
+      zz >>= 7;
+      if (zz) { b |= 0x80; } // Bit continue - còn byte varint phía sau
+      delta_buf[delta_len++] = b;
+    } while (zz);
+  }
+  delta_prev = distance;
+}
+
+// Kiểm tra yêu cầu sensor đang treo - gọi mỗi vòng main loop
+// Khi data-ready: harvest (trả về ngay vì sample đã sẵn) và reply; khi quá
+// timeout: reply distance 0 như hành vi timeout của lệnh blocking cũ
+static void protocol_sensor_poll(void)
+{
+  uint8_t ready;
+  if (sensor_req == SENSOR_REQ_NONE) { return; }
+
+  if (sensor_req == SENSOR_REQ_VL53L1) { ready = vl53l1_dataReady(); }
+  else { ready = vl53l0x_dataReady(); }
+
+  if (!ready) {
+    if ((micros_now() - sensor_req_start_us) < SENSOR_REQ_TIMEOUT_US) { return; }
+    // Timeout - reply 0, GUI xử lý như lệnh cũ
+    if (sensor_req == SENSOR_REQ_VL53L0X) {
+      protocol_sensor_reply(TELEM_TYPE_VL53L0X, PSTR("VL53L0X_DISTANCE:"), 0);
+    } else if (sensor_req == SENSOR_REQ_VL53L0X_EXT) {
+      protocol_sensor_reply_ext(0);
+    } else {
+      protocol_sensor_reply(TELEM_TYPE_VL53L1, PSTR("VL53L1_DISTANCE:"), 0);
+    }
+    protocol_timing_reply();
+    sensor_req = SENSOR_REQ_NONE;
+    return;
+  }
+
+  if (sensor_req == SENSOR_REQ_VL53L0X) {
+    protocol_sensor_reply(TELEM_TYPE_VL53L0X, PSTR("VL53L0X_DISTANCE:"),
+                          vl53l0x_readRangeContinuousMillimeters());
+  } else if (sensor_req == SENSOR_REQ_VL53L0X_EXT) {
+    // Harvest trước, reply sau - các accessor lastXxx trả trường của ĐÚNG
+    // result block vừa đọc
+    protocol_sensor_reply_ext(vl53l0x_readRangeContinuousMillimeters());
+  } else {
+    protocol_sensor_reply(TELEM_TYPE_VL53L1, PSTR("VL53L1_DISTANCE:"),
+                          vl53l1_readRangeContinuousMillimeters());
+  }
+  protocol_timing_reply();
+  sensor_req = SENSOR_REQ_NONE;
+}
+
+// Chờ VL53L0X data-ready có chặn trên, bơm realtime trong lúc chờ (không bỏ
+// đói stepper). Chờ không chặn thì sensor hỏng hoặc mất một cạnh GPIO1 treo
+// lệnh vĩnh viễn - watchdog vẫn được pet qua protocol_execute_realtime, chỉ
+// gỡ được bằng ctrl-x. Hết SENSOR_REQ_TIMEOUT_US thì hỏi thẳng thanh ghi
+// interrupt status qua I2C (mất cạnh ngắt không có nghĩa sensor không có
+// sample) rồi mới bỏ cuộc. Trả 1 nếu có sample, 0 nếu timeout hoặc abort.
+static uint8_t protocol_sensor_wait_ready(void)
+{
+  uint32_t start_us = micros_now();
+  while (!vl53l0x_dataReady()) {
+    protocol_execute_realtime();
+    if (sys.abort) { return(0); }
+    if ((micros_now() - start_us) >= SENSOR_REQ_TIMEOUT_US) {
+      return(vl53l0x_dataReadyPoll());
+    }
+  }
+  return(1);
+}
+
+// Cờ đã bring-up sensor trong phiên này - reset mỗi lần vào protocol_main_loop
+static uint8_t sensor_init_done = 0;
+
+// Bring-up trễ toàn bộ sensor ToF ở lần ĐẦU có lệnh cần đo trong phiên.
+// Trước đây main.c init ngay trong vòng reset: hai lần _delay_ms(100) cộng
+// config sequence chạy TRƯỚC khi protocol_main_loop nhận lệnh - mỗi soft
+// reset hay GUI reconnect trả ~200ms chết. Giờ reset-to-ready gần bằng 0;
+// lệnh đo đầu tiên trả chi phí init (vài ms nhờ init poll model ID thay vì
+// delay cứng), các lệnh sau đi thẳng. Init lỗi thì các lệnh đọc trả
+// distance 0/timeout như cũ và recovery engine của bus I2C lo phần còn lại.
+static void protocol_sensor_lazy_init(void)
+{
+  if (sensor_init_done) { return; }
+  sensor_init_done = 1; // Một lần mỗi phiên, kể cả khi init lỗi
+  if (vl53l0x_init()) {
+    vl53l0x_setTimeout(500);
+    vl53l0x_setProfile(settings.tof_profile);
+    vl53l0x_startContinuous(0);
+  }
+  #ifdef DUAL_TOF_SENSORS
+    // Nhả XSHUT (main.c giữ thấp từ lúc reset để VL53L0X - cùng địa chỉ mặc
+    // định 0x29 - init một mình trên bus), chuyển VL53L1 sang địa chỉ riêng
+    // rồi khởi động session
+    VL53L1_XSHUT_PORT |= VL53L1_XSHUT_MASK;
+    delay_ms(10); // Chờ sensor boot sau khi nhả reset
+    vl53l1_setAddress(VL53L1_I2C_ADDR);
+    if (vl53l1_init()) {
+      vl53l1_setTimeout(500);
+      vl53l1_startContinuous(0);
+    }
+  #endif
+}
+
+// Chặn (có feed realtime + stepper) đến khi yêu cầu sensor treo hoàn thành
+// Gọi trước khi thực thi dòng lệnh mới để giữ thứ tự reply trên serial
+static void protocol_sensor_drain(void)
+{
+  while (sensor_req != SENSOR_REQ_NONE) {
+    protocol_execute_realtime();
+    if (sys.abort) { sensor_req = SENSOR_REQ_NONE; return; }
+    protocol_sensor_poll();
+  }
+}
+
+// Cờ có motion packet đã plan - gc_state.position chưa theo kịp và phải
+// gc_sync_position() trước khi parser g-code ASCII chạy tiếp hoặc khi idle
+static uint8_t motion_packet_dirty = 0;
+
+// State gom motion packet binary - nằm ở file scope để prefetch chạy được từ
+// cả main loop lẫn checkpoint realtime (packet gom xong chỉ đánh dấu
+// packet_ready, KHÔNG thực thi tại chỗ - xem protocol_line_prefetch)
+static uint8_t packet_buf[MOTION_PACKET_TAIL];
+static uint8_t packet_remaining = 0; // Số byte sau sync còn phải gom
+static uint8_t packet_ready = 0;     // packet_buf đã đủ byte, chờ main loop
+
+// Thực thi một motion packet binary đã gom đủ MOTION_PACKET_TAIL byte sau
+// sync (format trong protocol.h). Target là STEP TUYỆT ĐỐI theo máy - host đã
+// biết steps_per_mm nên stream thẳng số nguyên; firmware khỏi chạy
+// gc_execute_line: không re-tokenize ASCII, không read_float từng word, không
+// kiểm tra modal state cho hàng nghìn segment "G1 X... F..." giống hệt nhau
+// của một lượt scan. Mỗi packet vẫn trả "ok"/"error" để host đếm flow control
+// như stream g-code thường.
+static void protocol_execute_motion_packet(uint8_t *packet)
+{
+  float target[N_AXIS];
+  int32_t steps;
+  uint16_t feed;
+  uint8_t idx;
+  uint8_t crc = 0;
+
+  for (idx = 0; idx < (MOTION_PACKET_TAIL-1); idx++) { crc = telem_crc8(crc, packet[idx]); }
+  if (crc != packet[MOTION_PACKET_TAIL-1]) { report_status_message(STATUS_BAD_NUMBER_FORMAT); return; }
+  if (packet[0] != MOTION_PACKET_OP_LINE) { report_status_message(STATUS_INVALID_STATEMENT); return; }
+  if (sys.state == STATE_ALARM) { report_status_message(STATUS_ALARM_LOCK); return; }
+
+  for (idx = 0; idx < N_AXIS; idx++) {
+    steps = (int32_t)((uint32_t)packet[1 + 4*idx] |
+                      ((uint32_t)packet[2 + 4*idx] << 8) |
+                      ((uint32_t)packet[3 + 4*idx] << 16) |
+                      ((uint32_t)packet[4 + 4*idx] << 24));
+    // Step -> mm: một phép chia float mỗi trục thay cho cả read_float
+    target[idx] = steps/settings.steps_per_mm[idx];
+  }
+  feed = ((uint16_t)packet[13]) | ((uint16_t)packet[14] << 8);
+  if (feed == 0) { report_status_message(STATUS_INVALID_STATEMENT); return; }
+
+  // mc_line tự chờ khi planner buffer đầy (có feed realtime + auto cycle start)
+  #ifdef USE_LINE_NUMBERS
+    mc_line(target, (float)feed, false, 0);
+  #else
+    mc_line(target, (float)feed, false);
+  #endif
+  motion_packet_dirty = 1;
+  report_status_message(STATUS_OK);
+}
+
+// Scan cycle tự trị: firmware tự plan chuyển động trục X (bàn quay), lấy mẫu
+// tại tâm của <points> cung chia đều rồi stream "SCAN:angle,distance" trong
+// lúc quay. Thay cho vòng lặp của GUI: G-code step -> chờ idle -> READ_VL53L0X
+// cho TỪNG điểm (163-633ms/điểm) - cả layer giờ là một round trip duy nhất.
+//
+// climb != 0: chế độ xoắn ốc - trục Y (độ cao, quy ước GUI) leo đều <climb>
+// đơn vị GRBL trong suốt chuyển động quay, tất cả trong MỘT block planner
+// đa trục. Mỗi ranh giới layer của vòng lặp cũ là một chu kỳ giảm tốc/
+// dừng/tăng tốc; vật 100mm pitch 2mm là 50 chu kỳ như vậy - xoắn ốc xóa
+// sạch. Output kèm độ cao: "SCAN:angle,height,distance" (hoặc frame
+// TELEM_TYPE_SCAN_H), độ cao lấy từ vị trí latch lúc đo.
+//
+// Được gọi từ hai cửa: lệnh "SCAN ..." trực tiếp và M100 trong gc_execute_line
+// (gcode.c). Trả status code cho caller tự report - M100 cần FAIL theo kiểu
+// parser thay vì tự in.
+#ifdef WATCHDOG_SUPERVISION
+  // Tiến độ scan cho stash pre-reset của watchdog (đọc từ WDT_vect)
+  volatile uint16_t protocol_scan_points_done = 0;
+  volatile uint8_t protocol_scan_active = 0;
+#endif
+
+uint8_t protocol_scan_cycle(float degrees, uint16_t points, float feed_rate, float climb)
+{
+  if (sys.state != STATE_IDLE) { return(STATUS_IDLE_ERROR); }
+  if ((degrees == 0.0) || (points == 0) || (points > SCAN_MAX_POINTS) ||
+      (feed_rate <= 0.0)) { return(STATUS_INVALID_STATEMENT); }
+
+  protocol_sensor_lazy_init(); // Phiên này chưa đụng sensor thì bring-up trước
+
+  float target[N_AXIS];
+  float start_angle, angle_step, next_trigger, angle, height;
+  uint16_t k = 0;
+  uint8_t idx;
+  uint8_t sensor_timed_out = 0;
+
+  for (idx = 0; idx < N_AXIS; idx++) {
+    target[idx] = system_convert_axis_steps_to_mpos(sys.position, idx);
+  }
+  start_angle = target[X_AXIS];
+  target[X_AXIS] = start_angle + degrees;
+  // Xoắn ốc: quay và leo trong CÙNG một block - planner tự phối hợp hai
+  // trục, chỉ một lần tăng/giảm tốc cho cả đường. climb = 0 thì block
+  // thoái hóa về quay thuần như cũ.
+  target[Y_AXIS] += climb;
+  angle_step = degrees / points;
+  // Trigger tại TÂM mỗi cung thay vì biên - điểm cuối không bị miss do
+  // sai số float khi so với góc đích
+  next_trigger = start_angle + (angle_step / 2);
+
+  #ifdef WATCHDOG_SUPERVISION
+    protocol_scan_points_done = 0;
+    protocol_scan_active = 1;
+  #endif
+
+  #ifdef USE_LINE_NUMBERS
+    mc_line(target, feed_rate, false, 0);
+  #else
+    mc_line(target, feed_rate, false);
+  #endif
+  protocol_auto_cycle_start();
+
+  do {
+    protocol_execute_realtime(); // Giữ segment buffer đầy + xử lý realtime
+    if (sys.abort) { break; }
+    angle = system_convert_axis_steps_to_mpos(sys.position, X_AXIS);
+    if ((k < points) &&
+        (((angle_step > 0.0) && (angle >= next_trigger)) ||
+         ((angle_step < 0.0) && (angle <= next_trigger)))) {
+      // Chờ sample continuous mode sẵn sàng mà không bỏ đói stepper; có
+      // chặn trên - sensor chết giữa vòng quay không được treo SCAN mãi
+      if (!protocol_sensor_wait_ready()) {
+        if (sys.abort) { break; }
+        sensor_timed_out = 1;
+        break;
+      }
+      int32_t steps = sys.position[X_AXIS];
+      int32_t y_steps = sys.position[Y_AXIS];
+      height = system_convert_axis_steps_to_mpos(sys.position, Y_AXIS);
+      #ifdef VL53L0X_GPIO1_INTERRUPT
+        // Vị trí latch trong ISR lúc data-ready chính xác hơn vị trí
+        // hiện tại - sample có thể đã nằm chờ vài ms trước khi harvest.
+        // Đọc latch TRƯỚC khi harvest xóa flag (sample sau sẽ latch đè)
+        int32_t latched[N_AXIS];
+        vl53l0x_getLatchedPosition(latched);
+        steps = latched[X_AXIS];
+        y_steps = latched[Y_AXIS];
+        angle = system_convert_axis_steps_to_mpos(latched, X_AXIS);
+        height = system_convert_axis_steps_to_mpos(latched, Y_AXIS);
+      #endif
+      uint16_t distance = vl53l0x_readRangeContinuousMillimeters();
+      if (telemetry_binary_mode) {
+        if (climb != 0.0) {
+          uint8_t payload[10];
+          payload[0] = steps & 0xFF; payload[1] = (steps >> 8) & 0xFF;
+          payload[2] = (steps >> 16) & 0xFF; payload[3] = (steps >> 24) & 0xFF;
+          payload[4] = y_steps & 0xFF; payload[5] = (y_steps >> 8) & 0xFF;
+          payload[6] = (y_steps >> 16) & 0xFF; payload[7] = (y_steps >> 24) & 0xFF;
+          payload[8] = distance & 0xFF; payload[9] = (distance >> 8) & 0xFF;
+          report_telemetry_frame(TELEM_TYPE_SCAN_H, payload, 10);
+        } else {
+          uint8_t payload[6];
+          payload[0] = steps & 0xFF; payload[1] = (steps >> 8) & 0xFF;
+          payload[2] = (steps >> 16) & 0xFF; payload[3] = (steps >> 24) & 0xFF;
+          payload[4] = distance & 0xFF; payload[5] = (distance >> 8) & 0xFF;
+          report_telemetry_frame(TELEM_TYPE_SCAN, payload, 6);
+        }
+      } else {
+        printPgmString(PSTR("SCAN:"));
+        printFloat_CoordValue(angle);
+        serial_write(',');
+        if (climb != 0.0) {
+          printFloat_CoordValue(height);
+          serial_write(',');
+        }
+        print_uint16_base10(distance);
+        printPgmString(PSTR("\r\n"));
+      }
+      k++;
+      #ifdef WATCHDOG_SUPERVISION
+        protocol_scan_points_done = k; // Điểm này đã phát xong - resume từ đây
+      #endif
+      next_trigger += angle_step;
+    }
+  } while ((sys.state == STATE_CYCLE) || plan_get_current_block());
+
+  #ifdef WATCHDOG_SUPERVISION
+    protocol_scan_active = 0;
+  #endif
+
+  if (sensor_timed_out && !sys.abort) {
+    // Hủy phần quay còn lại theo pattern của probe cycle: motion cancel
+    // giảm tốc có kiểm soát, rồi xả phần block dư khỏi stepper/planner -
+    // vị trí máy không mất, GUI nhận error status và tự quyết retry
+    bit_true_atomic(sys_rt_exec_state, EXEC_MOTION_CANCEL);
+    do {
+      protocol_execute_realtime();
+      if (sys.abort) { break; }
+    } while (sys.state != STATE_IDLE);
+    st_reset();
+    plan_reset();
+    plan_sync_position();
+  }
+
+  if (!sys.abort) {
+    gc_sync_position(); // Chuyển động ngoài parser - đồng bộ lại vị trí g-code
+    if (sensor_timed_out) { return(STATUS_SENSOR_TIMEOUT); }
+  }
+  return(STATUS_OK);
+}
 
 // Hướng dẫn và thực thi một dòng input đã format từ protocol_process
 // Chủ yếu là g-code blocks từ stream, nhưng cũng xử lý lệnh nội bộ GRBL
@@ -35,6 +474,12 @@ static void protocol_execute_line(char *line)
     report_echo_line_received(line);
   #endif
 
+  // Bring-up sensor trễ: chỉ lệnh cần đo mới trả chi phí init, boot và soft
+  // reset không đụng sensor (SCAN/M100 tự gọi trong protocol_scan_cycle)
+  if ((strncmp(line, "READ_", 5) == 0) || (strncmp(line, "VL53L0X_", 8) == 0)) {
+    protocol_sensor_lazy_init();
+  }
+
   if (line[0] == 0) {
     // Empty or comment line. Send status message for syncing purposes.
     report_status_message(STATUS_OK);
@@ -43,53 +488,291 @@ static void protocol_execute_line(char *line)
     // Grbl '$' system command
     report_status_message(system_execute_line(line));
     
+  } else if (strncmp(line, "TIMING=", 7) == 0) {
+    // Bật/tắt dòng timing sau mỗi reply sensor (xem protocol_timing_reply)
+    timing_mode = (line[7] != '0');
+    report_status_message(STATUS_OK);
+
   } else if (strcmp(line, "READ_VL53L0X") == 0) {
     // Custom command: Read VL53L0X distance sensor (continuous mode)
-    // Giống code mẫu: sensor.readRangeContinuousMillimeters()
-    uint16_t distance = vl53l0x_readRangeContinuousMillimeters();
-    
-    // Xử lý kết quả giống code mẫu:
+    // Non-blocking: chỉ ghi nhận yêu cầu - protocol_sensor_poll() trong main
+    // loop sẽ harvest và reply "VL53L0X_DISTANCE:..." + ok khi sample sẵn
+    // sàng, nên chuyển động đang chạy không bao giờ bị đói segment buffer.
+    // Xử lý kết quả phía GUI không đổi:
     // - distance >= 8190: OUT OF RANGE
     // - distance == 0: ERROR hoặc TIMEOUT
     // - 20-2000mm: OK
-    
-    printPgmString(PSTR("VL53L0X_DISTANCE:"));
-    printInteger((long)distance);
-    printPgmString(PSTR("\r\n"));
-    
-    // Kiểm tra timeout (giống code mẫu)
-    if (vl53l0x_timeoutOccurred()) {
-      // Timeout đã được xử lý trong readRangeContinuousMillimeters
-      // distance sẽ là 0
+    sensor_req = SENSOR_REQ_VL53L0X;
+    sensor_req_start_us = micros_now();
+
+
+  } else if (strcmp(line, "READ_VL53L0X_E") == 0) {
+    // Custom command: Đọc mở rộng - distance kèm range status + signal/ambient
+    // rate của CÙNG result block (sensor trả đủ 12 byte mỗi lần harvest, chỉ
+    // là trước đây vứt đi). Sample nghi ngờ GUI loại bằng ngưỡng thống kê
+    // ngay một lượt thay vì re-request điểm - mỗi lần re-read là một round
+    // trip đầy đủ. Non-blocking như READ_VL53L0X.
+    sensor_req = SENSOR_REQ_VL53L0X_EXT;
+    sensor_req_start_us = micros_now();
+
+
+  } else if (strcmp(line, "READ_VL53L0X_T") == 0) {
+    // Custom command: Đọc khoảng cách kèm timestamp microsecond của lần đo
+    // Host nội suy góc bàn quay tại thời điểm lấy mẫu - quét không cần dừng motor
+    uint16_t distance = vl53l0x_readRangeContinuousMillimeters();
+
+    if (telemetry_binary_mode) {
+      uint32_t us = vl53l0x_lastSampleMicros();
+      uint8_t payload[6];
+      payload[0] = distance & 0xFF; payload[1] = (distance >> 8) & 0xFF;
+      payload[2] = us & 0xFF; payload[3] = (us >> 8) & 0xFF;
+      payload[4] = (us >> 16) & 0xFF; payload[5] = (us >> 24) & 0xFF;
+      report_telemetry_frame(TELEM_TYPE_SAMPLE_T, payload, 6);
+    } else {
+      printPgmString(PSTR("VL53L0X_SAMPLE:"));
+      print_uint16_base10(distance);
+      serial_write(',');
+      print_uint32_base10(vl53l0x_lastSampleMicros());
+      printPgmString(PSTR("\r\n"));
     }
-    
-    // Luôn trả về OK để GUI biết command đã được xử lý
-    // GUI sẽ tự xử lý distance = 0 hoặc >= 8190
+
     report_status_message(STATUS_OK);
-    
+
+  #ifdef VL53L0X_GPIO1_INTERRUPT
+  } else if (strcmp(line, "READ_VL53L0X_P") == 0) {
+    // Custom command: Đọc khoảng cách kèm vị trí step latch lúc đo xong
+    // Vị trí snapshot trong ISR khi GPIO1 assert (pattern probe_state_monitor)
+    // - GUI biết chính xác sample thuộc góc/độ cao nào dù motor đang chạy
+    int32_t latched[N_AXIS];
+    uint16_t distance = 0;
+    // Chờ có chặn trên - hết timeout reply distance 0 như đường non-blocking
+    // (vị trí latch khi đó là của sample cũ, host bỏ qua vì distance 0)
+    if (protocol_sensor_wait_ready()) {
+      // Chốt latch trước khi harvest - harvest xóa flag và sample sau latch đè
+      vl53l0x_getLatchedPosition(latched);
+      distance = vl53l0x_readRangeContinuousMillimeters();
+    } else {
+      if (sys.abort) { return; }
+      vl53l0x_getLatchedPosition(latched);
+    }
+
+    if (telemetry_binary_mode) {
+      uint8_t payload[10];
+      payload[0] = distance & 0xFF; payload[1] = (distance >> 8) & 0xFF;
+      payload[2] = latched[X_AXIS] & 0xFF; payload[3] = (latched[X_AXIS] >> 8) & 0xFF;
+      payload[4] = (latched[X_AXIS] >> 16) & 0xFF; payload[5] = (latched[X_AXIS] >> 24) & 0xFF;
+      payload[6] = latched[Y_AXIS] & 0xFF; payload[7] = (latched[Y_AXIS] >> 8) & 0xFF;
+      payload[8] = (latched[Y_AXIS] >> 16) & 0xFF; payload[9] = (latched[Y_AXIS] >> 24) & 0xFF;
+      report_telemetry_frame(TELEM_TYPE_SAMPLE_P, payload, 10);
+    } else {
+      // "VL53L0X_POS:distance,x_steps,y_steps" - X là góc quay, Y là độ cao layer
+      printPgmString(PSTR("VL53L0X_POS:"));
+      print_uint16_base10(distance);
+      serial_write(',');
+      printInteger((long)latched[X_AXIS]);
+      serial_write(',');
+      printInteger((long)latched[Y_AXIS]);
+      printPgmString(PSTR("\r\n"));
+    }
+
+    report_status_message(STATUS_OK);
+  #endif
+
+  } else if (strcmp(line, "READ_VL53L1_T") == 0) {
+    // Custom command: Đọc khoảng cách VL53L1 kèm timestamp microsecond
+    uint16_t distance = vl53l1_readRangeContinuousMillimeters();
+
+    if (telemetry_binary_mode) {
+      uint32_t us = vl53l1_lastSampleMicros();
+      uint8_t payload[6];
+      payload[0] = distance & 0xFF; payload[1] = (distance >> 8) & 0xFF;
+      payload[2] = us & 0xFF; payload[3] = (us >> 8) & 0xFF;
+      payload[4] = (us >> 16) & 0xFF; payload[5] = (us >> 24) & 0xFF;
+      report_telemetry_frame(TELEM_TYPE_SAMPLE_T, payload, 6);
+    } else {
+      printPgmString(PSTR("VL53L1_SAMPLE:"));
+      print_uint16_base10(distance);
+      serial_write(',');
+      print_uint32_base10(vl53l1_lastSampleMicros());
+      printPgmString(PSTR("\r\n"));
+    }
+
+    report_status_message(STATUS_OK);
+
+  } else if (strncmp(line, "READ_VL53L0X_N=", 15) == 0) {
+    // Custom command: Burst read - thu N sample continuous rồi gửi một dòng duy nhất
+    // "VL53L0X_BURST:d1,d2,...,dN" - một round trip cho cả cung quét thay vì
+    // N lần READ_VL53L0X với overhead protocol + parse Python mỗi điểm
+    uint8_t char_idx = 15;
+    uint16_t n = 0;
+    while (line[char_idx]) {
+      if ((line[char_idx] < '0') || (line[char_idx] > '9')) { n = 0; break; }
+      n = n*10 + (line[char_idx] - '0');
+      if (n > PROTOCOL_BURST_MAX_SAMPLES) { n = 0; break; }
+      char_idx++;
+    }
+    if (n == 0) {
+      report_status_message(STATUS_INVALID_STATEMENT);
+    } else {
+      uint16_t i;
+      if (telemetry_binary_mode >= 2) {
+        // Delta mode ($B=2): gom nhiều sample một frame TELEM_TYPE_DELTA -
+        // GUI giải varint và đếm đủ n sample thay vì n frame
+        for (i = 0; i < n; i++) {
+          protocol_delta_push(vl53l0x_readRangeContinuousMillimeters());
+        }
+        protocol_delta_flush();
+      } else if (telemetry_binary_mode) {
+        // Binary mode: mỗi sample một frame TELEM_TYPE_VL53L0X (GUI đếm đủ n frame)
+        for (i = 0; i < n; i++) {
+          uint16_t distance = vl53l0x_readRangeContinuousMillimeters();
+          uint8_t payload[2];
+          payload[0] = distance & 0xFF; payload[1] = (distance >> 8) & 0xFF;
+          report_telemetry_frame(TELEM_TYPE_VL53L0X, payload, 2);
+        }
+      } else {
+        printPgmString(PSTR("VL53L0X_BURST:"));
+        for (i = 0; i < n; i++) {
+          // serial_write tự chặn khi TX buffer đầy - không cần buffer cả burst
+          print_uint16_base10(vl53l0x_readRangeContinuousMillimeters());
+          if (i < (uint16_t)(n-1)) { serial_write(','); }
+        }
+        printPgmString(PSTR("\r\n"));
+      }
+      report_status_message(STATUS_OK);
+    }
+
+  } else if (strcmp(line, "READ_VL53L0X_F") == 0) {
+    // Custom command: Đọc khoảng cách đã lọc - median của $32 sample continuous
+    // Một round trip thay cho 3-5 lần READ_VL53L0X + average host-side
+    uint16_t distance = vl53l0x_readRangeFilteredMillimeters();
+
+    if (telemetry_binary_mode) {
+      uint8_t payload[2];
+      payload[0] = distance & 0xFF; payload[1] = (distance >> 8) & 0xFF;
+      report_telemetry_frame(TELEM_TYPE_FILTERED, payload, 2);
+    } else {
+      printPgmString(PSTR("VL53L0X_FILTERED:"));
+      print_uint16_base10(distance);
+      printPgmString(PSTR("\r\n"));
+    }
+
+    // GUI tự xử lý distance = 0 hoặc >= 8190 như lệnh thường
+    report_status_message(STATUS_OK);
+
+  } else if (strcmp(line, "READ_VL53L1_F") == 0) {
+    // Custom command: Đọc khoảng cách đã lọc từ VL53L1 (median của $32 sample)
+    uint16_t distance = vl53l1_readRangeFilteredMillimeters();
+
+    if (telemetry_binary_mode) {
+      uint8_t payload[2];
+      payload[0] = distance & 0xFF; payload[1] = (distance >> 8) & 0xFF;
+      report_telemetry_frame(TELEM_TYPE_FILTERED, payload, 2);
+    } else {
+      printPgmString(PSTR("VL53L1_FILTERED:"));
+      print_uint16_base10(distance);
+      printPgmString(PSTR("\r\n"));
+    }
+
+    report_status_message(STATUS_OK);
+
+  } else if (strcmp(line, "READ_DUAL") == 0) {
+    // Custom command: Đọc cặp sample từ cả hai sensor trong một round trip
+    // Hai sensor đo song song (continuous mode, địa chỉ I2C riêng) - firmware
+    // chỉ harvest lần lượt, nên thời gian đo không cộng dồn
+    uint16_t distance_a = vl53l0x_readRangeContinuousMillimeters();
+    uint16_t distance_b = vl53l1_readRangeContinuousMillimeters();
+
+    if (telemetry_binary_mode) {
+      uint8_t payload[4];
+      payload[0] = distance_a & 0xFF; payload[1] = (distance_a >> 8) & 0xFF;
+      payload[2] = distance_b & 0xFF; payload[3] = (distance_b >> 8) & 0xFF;
+      report_telemetry_frame(TELEM_TYPE_DUAL, payload, 4);
+    } else {
+      printPgmString(PSTR("DUAL_DISTANCE:"));
+      print_uint16_base10(distance_a);
+      serial_write(',');
+      print_uint16_base10(distance_b);
+      printPgmString(PSTR("\r\n"));
+    }
+
+    // GUI tự xử lý distance = 0 hoặc >= 8190 cho từng kênh
+    report_status_message(STATUS_OK);
+
+  } else if (strncmp(line, "SCAN", 4) == 0) {
+    // Custom command: scan cycle tự trị - SCAN X<degrees> P<points> [F<feed>] [Z<climb>]
+    // Parse word rồi giao cho protocol_scan_cycle() (dùng chung với M100).
+    float degrees = 0.0;
+    float climb = 0.0;
+    float feed_rate = SCAN_DEFAULT_FEED_RATE;
+    float value;
+    uint16_t points = 0;
+    uint8_t char_counter = 4;
+    uint8_t parse_ok = 1;
+    while (line[char_counter] && parse_ok) {
+      uint8_t letter = line[char_counter++];
+      if (!read_float(line, &char_counter, &value)) { parse_ok = 0; break; }
+      switch (letter) {
+        case 'X': degrees = value; break;
+        case 'P': points = (uint16_t)value; break;
+        case 'F': feed_rate = value; break;
+        case 'Z': climb = value; break;
+        default: parse_ok = 0; break;
+      }
+    }
+    if (!parse_ok) {
+      report_status_message(STATUS_INVALID_STATEMENT);
+    } else {
+      uint8_t scan_status = protocol_scan_cycle(degrees, points, feed_rate, climb);
+      if (!sys.abort) { report_status_message(scan_status); }
+    }
+
+  } else if (strncmp(line, "RESEND=", 7) == 0) {
+    // Custom command: NACK từ host cho telemetry binary - phát lại frame có
+    // sequence number đã cho (host thấy CRC sai hoặc seq nhảy). Frame quá cũ
+    // đã rời history thì trả error - host coi như mất mẫu thay vì nhận rác.
+    uint8_t char_idx = 7;
+    uint16_t seq = 0;
+    uint8_t valid = (line[char_idx] != 0);
+    while (line[char_idx]) {
+      if ((line[char_idx] < '0') || (line[char_idx] > '9')) { valid = 0; break; }
+      seq = seq*10 + (line[char_idx] - '0');
+      if (seq > 255) { valid = 0; break; }
+      char_idx++;
+    }
+    if (!valid) {
+      report_status_message(STATUS_INVALID_STATEMENT);
+    } else if (report_telemetry_resend((uint8_t)seq)) {
+      report_status_message(STATUS_OK);
+    } else {
+      report_status_message(STATUS_INVALID_STATEMENT); // Frame đã bị ghi đè
+    }
+
+  } else if (strncmp(line, "VL53L0X_PROFILE=", 16) == 0) {
+    // Custom command: Đổi ranging profile ngay lập tức (0=balanced, 1=high speed, 2=long range)
+    // Dừng continuous, ghi cấu hình profile, rồi khởi động lại back-to-back mode
+    uint8_t profile = line[16] - '0';
+    if ((line[16] == 0) || (line[17] != 0) || (profile > VL53L0X_PROFILE_LONG_RANGE)) {
+      report_status_message(STATUS_INVALID_STATEMENT);
+    } else {
+      vl53l0x_stopContinuous();
+      vl53l0x_setProfile(profile);
+      vl53l0x_startContinuous(0);
+      report_status_message(STATUS_OK);
+    }
+
   } else if (strcmp(line, "READ_VL53L1") == 0) {
     // Custom command: Read VL53L1 distance sensor (continuous mode)
-    uint16_t distance = vl53l1_readRangeContinuousMillimeters();
-    
+    // Non-blocking như READ_VL53L0X - protocol_sensor_poll() reply khi sẵn sàng
     // Xử lý kết quả giống VL53L0X:
     // - distance >= 8190: OUT OF RANGE
     // - distance == 0: ERROR hoặc TIMEOUT
     // - 20-4000mm: OK (VL53L1 có range xa hơn)
-    
-    printPgmString(PSTR("VL53L1_DISTANCE:"));
-    printInteger((long)distance);
-    printPgmString(PSTR("\r\n"));
-    
-    // Kiểm tra timeout
-    if (vl53l1_timeoutOccurred()) {
-      // Timeout đã được xử lý trong readRangeContinuousMillimeters
-      // distance sẽ là 0
-    }
-    
-    // Luôn trả về OK để GUI biết command đã được xử lý
-    // GUI sẽ tự xử lý distance = 0 hoặc >= 8190
-    report_status_message(STATUS_OK);
-    
+    vl53l1_ensureContinuous(); // Giữ hành vi đọc-là-có: tự start session nếu chưa chạy
+    sensor_req = SENSOR_REQ_VL53L1;
+    sensor_req_start_us = micros_now();
+
+
   } else if (sys.state == STATE_ALARM) {
     // Everything else is gcode. Block if in alarm mode.
     report_status_message(STATUS_ALARM_LOCK);
@@ -101,7 +784,84 @@ static void protocol_execute_line(char *line)
 }
 
 
-/* 
+// State lọc comment của dòng đang gom (giữ qua nhiều lần gọi prefetch)
+static uint8_t prefetch_comment = COMMENT_NONE;
+static uint8_t prefetch_counter = 0;
+
+// Rút serial RX thành dòng ASCII (lọc space/comment, upcase - logic pre-parse
+// cũ của main loop) hoặc motion packet binary. Trả 1 khi có dòng/packet hoàn
+// chỉnh chờ tiêu thụ, 0 khi RX cạn mà chưa đủ.
+//
+// Được gọi từ main loop VÀ từ protocol_execute_realtime: trước đây dòng kế
+// chỉ bắt đầu được đọc sau khi protocol_execute_line xong hẳn - trong lúc
+// gc_execute_line nhai một block, byte dồn trong RX ring 128 byte và link
+// đứng im sau "ok". Giờ các wait loop của chuyển động (mc_line chờ planner,
+// buffer_synchronize, scan cycle...) vừa chạy vừa gom sẵn dòng kế vào buffer
+// thứ hai, nên thực thi xong là parse được ngay và RX ring luôn có chỗ trống
+// cho host stream tiếp. Chỉ GOM, không thực thi: main loop là nơi duy nhất
+// tiêu thụ line_ready/packet_ready, nên không bao giờ reentrant vào parser
+// hay planner từ giữa một checkpoint realtime.
+static uint8_t protocol_line_prefetch(void)
+{
+  uint8_t c;
+  // Đã có hàng chờ - ngừng rút RX để giữ độ sâu pipeline đúng một dòng
+  if (line_ready || packet_ready) { return(1); }
+  while ((c = serial_read()) != SERIAL_NO_DATA) {
+    if (packet_remaining) {
+      // Đang gom motion packet binary - byte đi thẳng, không qua filter ASCII
+      packet_buf[MOTION_PACKET_TAIL - packet_remaining] = c;
+      packet_remaining--;
+      if (packet_remaining == 0) { packet_ready = 1; return(1); }
+      continue;
+    }
+    if (c == MOTION_PACKET_SYNC) {
+      // Mở đầu motion packet - ISR serial đã cho các byte kế đi thẳng
+      packet_remaining = MOTION_PACKET_TAIL;
+      continue;
+    }
+    if ((c == '\n') || (c == '\r')) { // End of line reached
+      line_next[prefetch_counter] = 0; // Set string termination character.
+      prefetch_comment = COMMENT_NONE;
+      prefetch_counter = 0;
+      line_ready = 1;
+      return(1);
+    }
+    if (prefetch_comment != COMMENT_NONE) {
+      // Throw away all comment characters
+      if (c == ')') {
+        // End of comment. Resume line. But, not if semicolon type comment.
+        if (prefetch_comment == COMMENT_TYPE_PARENTHESES) { prefetch_comment = COMMENT_NONE; }
+      }
+    } else {
+      if (c <= ' ') {
+        // Throw away whitepace and control characters
+      } else if (c == '/') {
+        // Block delete NOT SUPPORTED. Ignore character.
+      } else if (c == '(') {
+        // Enable comments flag and ignore all characters until ')' or EOL.
+        prefetch_comment = COMMENT_TYPE_PARENTHESES;
+      } else if (c == ';') {
+        // NOTE: ';' comment to EOL is a LinuxCNC definition. Not NIST.
+        prefetch_comment = COMMENT_TYPE_SEMICOLON;
+      } else if (line_overflow) {
+        // Dòng đã tràn - nuốt nốt phần còn lại đến EOL, lỗi báo khi tiêu thụ
+      } else if (prefetch_counter >= (LINE_BUFFER_SIZE-1)) {
+        // Tràn buffer dòng. Đánh dấu thay vì report ngay tại đây: prefetch có
+        // thể đang chạy giữa output của dòng trước, report lỗi xen vào sẽ phá
+        // thứ tự "ok"/"error" mà host đếm flow control
+        line_overflow = 1;
+      } else if (c >= 'a' && c <= 'z') { // Upcase lowercase
+        line_next[prefetch_counter++] = c-'a'+'A';
+      } else {
+        line_next[prefetch_counter++] = c;
+      }
+    }
+  }
+  return(0);
+}
+
+
+/*
   GRBL PRIMARY LOOP:
 */
 void protocol_main_loop()
@@ -131,72 +891,63 @@ void protocol_main_loop()
   // Primary loop! Upon a system abort, this exits back to main() to reset the system. 
   // ---------------------------------------------------------------------------------  
   
-  uint8_t comment = COMMENT_NONE;
-  uint8_t char_counter = 0;
-  uint8_t c;
+  char *line_swap;
+  uint8_t overflow;
+  sensor_req = SENSOR_REQ_NONE; // Bỏ yêu cầu sensor còn treo từ trước reset
+  sensor_init_done = 0; // Phiên mới - sensor bring-up lại ở lệnh đo đầu tiên
+  motion_packet_dirty = 0;
+  // Bỏ dòng/packet gom dở từ trước reset (RX ring cũng vừa bị xóa ở main.c)
+  prefetch_comment = COMMENT_NONE;
+  prefetch_counter = 0;
+  packet_remaining = 0;
+  line_ready = 0; packet_ready = 0; line_overflow = 0;
   for (;;) {
 
     // Process one line of incoming serial data, as the data becomes available. Performs an
     // initial filtering by removing spaces and comments and capitalizing all letters.
-    
-    // NOTE: While comment, spaces, and block delete(if supported) handling should technically 
+
+    // NOTE: While comment, spaces, and block delete(if supported) handling should technically
     // be done in the g-code parser, doing it here helps compress the incoming data into Grbl's
     // line buffer, which is limited in size. The g-code standard actually states a line can't
     // exceed 256 characters, but the Arduino Uno does not have the memory space for this.
-    // With a better processor, it would be very easy to pull this initial parsing out as a 
+    // With a better processor, it would be very easy to pull this initial parsing out as a
     // seperate task to be shared by the g-code parser and Grbl's system commands.
-    
-    while((c = serial_read()) != SERIAL_NO_DATA) {
-      if ((c == '\n') || (c == '\r')) { // End of line reached
-        line[char_counter] = 0; // Set string termination character.
-        protocol_execute_line(line); // Line is complete. Execute it!
-        comment = COMMENT_NONE;
-        char_counter = 0;
-      } else {
-        if (comment != COMMENT_NONE) {
-          // Throw away all comment characters
-          if (c == ')') {
-            // End of comment. Resume line. But, not if semicolon type comment.
-            if (comment == COMMENT_TYPE_PARENTHESES) { comment = COMMENT_NONE; }
-          }
-        } else {
-          if (c <= ' ') { 
-            // Throw away whitepace and control characters  
-          } else if (c == '/') { 
-            // Block delete NOT SUPPORTED. Ignore character.
-            // NOTE: If supported, would simply need to check the system if block delete is enabled.
-          } else if (c == '(') {
-            // Enable comments flag and ignore all characters until ')' or EOL.
-            // NOTE: This doesn't follow the NIST definition exactly, but is good enough for now.
-            // In the future, we could simply remove the items within the comments, but retain the
-            // comment control characters, so that the g-code parser can error-check it.
-            comment = COMMENT_TYPE_PARENTHESES;
-          } else if (c == ';') {
-            // NOTE: ';' comment to EOL is a LinuxCNC definition. Not NIST.
-            comment = COMMENT_TYPE_SEMICOLON;
-            
-          // TODO: Install '%' feature 
-          // } else if (c == '%') {
-            // Program start-end percent sign NOT SUPPORTED.
-            // NOTE: This maybe installed to tell Grbl when a program is running vs manual input,
-            // where, during a program, the system auto-cycle start will continue to execute 
-            // everything until the next '%' sign. This will help fix resuming issues with certain
-            // functions that empty the planner buffer to execute its task on-time.
-
-          } else if (char_counter >= (LINE_BUFFER_SIZE-1)) {
-            // Detect line buffer overflow. Report error and reset line buffer.
-            report_status_message(STATUS_OVERFLOW);
-            comment = COMMENT_NONE;
-            char_counter = 0;
-          } else if (c >= 'a' && c <= 'z') { // Upcase lowercase
-            line[char_counter++] = c-'a'+'A';
-          } else {
-            line[char_counter++] = c;
-          }
-        }
+
+    // Gom và tiêu thụ dòng/packet đến khi RX cạn. Phần gom (protocol_line_
+    // prefetch) cũng được gọi từ các checkpoint realtime trong lúc dòng dưới
+    // đây đang thực thi - thường thì đến lượt vòng này dòng kế đã nằm sẵn.
+    while (protocol_line_prefetch()) {
+      if (packet_ready) {
+        packet_ready = 0;
+        protocol_execute_motion_packet(packet_buf);
+        if (sys.abort) { return; }
+        continue;
+      }
+      // Hoán đổi buffer TRƯỚC khi thực thi: dòng vừa gom thành dòng chạy,
+      // buffer cũ thành chỗ gom - prefetch từ realtime lại có chỗ làm việc
+      line_swap = line; line = line_next; line_next = line_swap;
+      overflow = line_overflow;
+      line_ready = 0; line_overflow = 0;
+      if (overflow) {
+        // Dòng vượt LINE_BUFFER_SIZE - báo lỗi, phần gom được đã bị bỏ
+        report_status_message(STATUS_OVERFLOW);
+        continue;
       }
+      // Chờ yêu cầu sensor đang treo reply xong để giữ thứ tự trên serial
+      protocol_sensor_drain();
+      if (sys.abort) { return; }
+      if (motion_packet_dirty) {
+        // Parser ASCII cần vị trí g-code đúng sau chuỗi packet binary -
+        // chờ buffer chạy hết rồi đồng bộ lại (host không trộn hai chế độ
+        // giữa stream nên nhánh này hiếm khi phải chờ thật)
+        protocol_buffer_synchronize();
+        if (sys.abort) { return; }
+        gc_sync_position();
+        motion_packet_dirty = 0;
+      }
+      protocol_execute_line(line); // Line is complete. Execute it!
     }
-    
+
     // If there are no more characters in the serial read buffer to be processed and executed,
     // this indicates that g-code streaming has either filled the planner buffer or has 
     // completed. In either case, auto-cycle start, if enabled, any queued moves.
@@ -204,7 +955,21 @@ void protocol_main_loop()
 
     protocol_execute_realtime();  // Runtime command check point.
     if (sys.abort) { return; } // Bail to main() program loop to reset system.
-              
+
+    protocol_sensor_poll(); // Hoàn tất yêu cầu sensor đang treo khi có kết quả
+
+    settings_flush_step(); // Nhỏ giọt settings dirty xuống EEPROM (không chờ)
+
+    #ifdef POSITION_CHECKPOINT
+      settings_checkpoint_step(); // Checkpoint vị trí máy khi IDLE (không chờ)
+    #endif
+
+    // Chuỗi motion packet đã chạy xong - đồng bộ lại vị trí parser g-code
+    if (motion_packet_dirty && (sys.state == STATE_IDLE) && (plan_get_current_block() == NULL)) {
+      gc_sync_position();
+      motion_packet_dirty = 0;
+    }
+
   }
   
   return; /* Never reached */
@@ -226,9 +991,31 @@ void protocol_execute_realtime()
 {
   uint8_t rt_exec; // Temp variable to avoid calling volatile multiple times.
 
+  #ifdef WATCHDOG_SUPERVISION
+    // Pet watchdog: hàm này được gọi từ mọi wait loop còn sống của firmware,
+    // nên chỉ treo thật (vd. kẹt wait loop I2C) mới để timeout 2s trôi qua
+    wdt_reset();
+  #endif
+
+  // Parse-ahead: tranh thủ gom dòng lệnh kế từ RX ring trong lúc chương trình
+  // chính còn bận (wait loop planner, buffer sync, scan cycle...). Chỉ gom
+  // vào buffer thứ hai - main loop mới là nơi thực thi.
+  protocol_line_prefetch();
+
   do { // If system is suspended, suspend loop restarts here.
-    
-  // Check and execute alarms. 
+
+  // Re-init sensor sau khi bus I2C vừa được recovery (cờ đặt bởi i2c_bus_recover).
+  // Recovery làm sensor mất continuous mode nên phải chạy lại init sequence đầy đủ.
+  // Nếu init vẫn lỗi, engine sẽ tự recovery lần nữa và cờ được đặt lại.
+  if (i2c_recovery_pending()) {
+    if (vl53l0x_init()) {
+      vl53l0x_setTimeout(500);
+      vl53l0x_setProfile(settings.tof_profile);
+      vl53l0x_startContinuous(0);
+    }
+  }
+
+  // Check and execute alarms.
   rt_exec = sys_rt_exec_alarm; // Copy volatile sys_rt_exec_alarm.
   if (rt_exec) { // Enter only if any bit flag is true
     // System alarm. Everything has shutdown by something that has gone severely wrong. Report
@@ -245,6 +1032,8 @@ void protocol_execute_realtime()
       report_alarm_message(ALARM_PROBE_FAIL);
     } else if (rt_exec & EXEC_ALARM_HOMING_FAIL) {
       report_alarm_message(ALARM_HOMING_FAIL);
+    } else if (rt_exec & EXEC_ALARM_RX_OVERFLOW) {
+      report_alarm_message(ALARM_RX_OVERFLOW);
     }
     // Halt everything upon a critical event flag. Currently hard and soft limits flag this.
     if (rt_exec & EXEC_CRITICAL_EVENT) {
@@ -392,9 +1181,12 @@ void protocol_execute_realtime()
     
   }
 
-  // Overrides flag byte (sys.override) and execution should be installed here, since they 
+  // Overrides flag byte (sys.override) and execution should be installed here, since they
   // are realtime and require a direct and controlled interface to the main stepper program.
 
+  // Auto-push status report theo chu kỳ $S (report.c) - GUI khỏi phải poll '?'
+  report_push_check();
+
   // Reload step segment buffer
   if (sys.state & (STATE_CYCLE | STATE_HOLD | STATE_MOTION_CANCEL | STATE_SAFETY_DOOR | STATE_HOMING)) { st_prep_buffer(); }  
   
@@ -22,6 +22,34 @@
   #define LINE_BUFFER_SIZE 80
 #endif
 
+// Số sample tối đa cho một lệnh burst READ_VL53L0X_N=n
+// Sample in thẳng ra serial khi đọc được nên không tốn RAM theo n, giới hạn
+// chỉ để một lệnh gõ nhầm không chiếm bus hàng chục giây
+#define PROTOCOL_BURST_MAX_SAMPLES 200
+
+// Feed rate mặc định cho lệnh SCAN khi không có word F (degree/phút)
+// 720 deg/min = 12 deg/giây - một vòng bàn quay trong 30 giây
+#define SCAN_DEFAULT_FEED_RATE 720.0
+
+// Số điểm tối đa cho một lệnh SCAN
+#define SCAN_MAX_POINTS 1000
+
+// Quy đổi một vòng bàn quay (360 độ) sang đơn vị trục X của GRBL - theo
+// calibration của GUI (55.555... step/unit, 2000 step/vòng => 3.6 unit/vòng).
+// Dùng cho M100 Q<revs> để đổi số vòng sang quãng đường trục X.
+#define SCAN_MM_PER_REV 3.6
+
+// Motion packet binary: host stream thẳng target dạng số nguyên, bỏ qua toàn
+// bộ parser g-code ASCII (gc_execute_line re-tokenize + read_float + kiểm tra
+// modal state cho TỪNG segment). Format trên dây (little-endian):
+//   [0xA6 sync][opcode][int32 x_steps][int32 y_steps][int32 z_steps]
+//   [uint16 feed mm/min][crc8 của opcode..feed, poly 0x07 init 0]
+// ISR serial cho MOTION_PACKET_TAIL byte sau sync đi thẳng vào buffer để
+// payload trùng mã realtime ('?','~','!',0x18) không bị chặn giữa đường
+#define MOTION_PACKET_SYNC    0xA6 // Không xuất hiện trong stream ASCII 7-bit
+#define MOTION_PACKET_TAIL    16   // Số byte sau sync: opcode + 3*i32 + u16 + crc8
+#define MOTION_PACKET_OP_LINE 0x01 // Chuyển động thẳng tới step tuyệt đối theo máy
+
 // Bắt đầu vòng lặp chính GRBL - xử lý tất cả ký tự từ serial và thực thi
 void protocol_main_loop();
 
@@ -43,4 +71,15 @@ void protocol_auto_cycle_start();
 // Block until all buffered steps are executed
 void protocol_buffer_synchronize();
 
+// Chạy một scan cycle tự trị (quay + lấy mẫu, xoắn ốc nếu climb != 0).
+// Dùng chung cho lệnh "SCAN" và M100. Trả status code cho caller report.
+uint8_t protocol_scan_cycle(float degrees, uint16_t points, float feed_rate, float climb);
+
+#ifdef WATCHDOG_SUPERVISION
+  // Tiến độ scan cycle đang chạy - ISR watchdog stash hai biến này để phiên
+  // sau báo host tiếp tục từ điểm đã phát xong (xem WDT_vect trong system.c)
+  extern volatile uint16_t protocol_scan_points_done;
+  extern volatile uint8_t protocol_scan_active;
+#endif
+
 #endif
@@ -55,9 +55,11 @@ void report_status_message(uint8_t status_code)
         case STATUS_OVERFLOW:
         printPgmString(PSTR("Line overflow")); break;
         #ifdef MAX_STEP_RATE_HZ
-          case STATUS_MAX_STEP_RATE_EXCEEDED: 
+          case STATUS_MAX_STEP_RATE_EXCEEDED:
           printPgmString(PSTR("Step rate > 30kHz")); break;
-        #endif      
+        #endif
+        case STATUS_SENSOR_TIMEOUT:
+        printPgmString(PSTR("Sensor timeout")); break;
         // Common g-code parser errors.
         case STATUS_GCODE_MODAL_GROUP_VIOLATION:
         printPgmString(PSTR("Modal group violation")); break;
@@ -93,6 +95,8 @@ void report_alarm_message(int8_t alarm_code)
       printPgmString(PSTR("Probe fail")); break;
       case ALARM_HOMING_FAIL:
       printPgmString(PSTR("Homing fail")); break;
+      case ALARM_RX_OVERFLOW:
+      printPgmString(PSTR("RX overflow")); break;
     }
   #endif
   printPgmString(PSTR("\r\n"));
@@ -181,8 +185,11 @@ void report_grbl_settings() {
     printPgmString(PSTR("\r\n$25=")); printFloat_SettingValue(settings.homing_seek_rate);
     printPgmString(PSTR("\r\n$26=")); print_uint8_base10(settings.homing_debounce_delay);
     printPgmString(PSTR("\r\n$27=")); printFloat_SettingValue(settings.homing_pulloff);
+    printPgmString(PSTR("\r\n$30=")); print_uint8_base10(settings.i2c_fast_mode);
+    printPgmString(PSTR("\r\n$31=")); print_uint8_base10(settings.tof_profile);
+    printPgmString(PSTR("\r\n$32=")); print_uint8_base10(settings.tof_filter_window);
     printPgmString(PSTR("\r\n"));
-  #else      
+  #else
     printPgmString(PSTR("$0=")); print_uint8_base10(settings.pulse_microseconds);
     printPgmString(PSTR(" (step pulse, usec)\r\n$1=")); print_uint8_base10(settings.stepper_idle_lock_time);
     printPgmString(PSTR(" (step idle delay, msec)\r\n$2=")); print_uint8_base10(settings.step_invert_mask); 
@@ -206,7 +213,10 @@ void report_grbl_settings() {
     printPgmString(PSTR(" (homing feed, mm/min)\r\n$25=")); printFloat_SettingValue(settings.homing_seek_rate);
     printPgmString(PSTR(" (homing seek, mm/min)\r\n$26=")); print_uint8_base10(settings.homing_debounce_delay);
     printPgmString(PSTR(" (homing debounce, msec)\r\n$27=")); printFloat_SettingValue(settings.homing_pulloff);
-    printPgmString(PSTR(" (homing pull-off, mm)\r\n"));
+    printPgmString(PSTR(" (homing pull-off, mm)\r\n$30=")); print_uint8_base10(settings.i2c_fast_mode);
+    printPgmString(PSTR(" (i2c fast mode 400kHz, bool)\r\n$31=")); print_uint8_base10(settings.tof_profile);
+    printPgmString(PSTR(" (tof profile 0=bal 1=speed 2=range)\r\n$32=")); print_uint8_base10(settings.tof_filter_window);
+    printPgmString(PSTR(" (tof filter window, samples)\r\n"));
   #endif
   
   // Print axis settings
@@ -389,6 +399,232 @@ void report_build_info(char *line)
 }
 
 
+// Chế độ telemetry binary - bật/tắt qua lệnh $B, reset về ASCII mỗi lần boot
+uint8_t telemetry_binary_mode = 0;
+
+// History các frame telemetry đã gửi để phát lại khi host NACK (RESEND=<seq>)
+// Ring nhỏ theo seq: ở 500k baud một frame bay trong ~140us, host phát hiện
+// CRC sai/seq nhảy trong vòng vài frame nên 4 slot là đủ
+typedef struct {
+  uint8_t seq;
+  uint8_t type;
+  uint8_t length; // 0 = slot trống (chưa từng gửi)
+  uint8_t payload[TELEM_MAX_PAYLOAD];
+} telem_history_t;
+static telem_history_t telem_history[TELEM_HISTORY_SIZE];
+static uint8_t telem_seq = 0; // Sequence number frame kế tiếp (wrap 255->0)
+
+// CRC8 poly 0x07 (CRC-8/ATM), init 0x00 - bắt được lỗi nhiều bit mà XOR đơn
+// thuần bỏ lọt, vẫn chỉ là dịch bit thuần túy trên AVR. Dùng chung cho frame
+// telemetry chiều TX và motion packet binary chiều RX (protocol.c)
+uint8_t telem_crc8(uint8_t crc, uint8_t data)
+{
+  uint8_t i;
+  crc ^= data;
+  for (i = 0; i < 8; i++) {
+    if (crc & 0x80) { crc = (crc << 1) ^ 0x07; }
+    else { crc <<= 1; }
+  }
+  return crc;
+}
+
+// Số frame telemetry đã drop vì TX buffer đầy (xem telem_emit)
+static uint16_t telem_dropped_count = 0;
+
+// Ghi một frame ra serial: sync + seq + type + length + payload + CRC8
+// (CRC tính trên seq, type, length và payload - không gồm byte sync)
+// KHÔNG CHẶN: nếu TX buffer không đủ chỗ cho trọn frame thì drop và đếm -
+// telemetry là dữ liệu lossy, chuyển động không được khựng vì host rút cổng
+// chậm. Frame bị drop vẫn nằm trong history, host thấy seq nhảy sẽ RESEND
+// được khi buffer vơi. Response "ok"/"error" vẫn đi đường serial_write chặn
+// như cũ - protocol g-code giữ nguyên bảo đảm giao.
+static void telem_emit(uint8_t seq, uint8_t type, uint8_t *payload, uint8_t length)
+{
+  uint8_t i;
+  uint8_t crc = 0;
+  if (serial_get_tx_buffer_free() < (serial_idx_t)(length + 5)) {
+    if (telem_dropped_count < 0xFFFF) { telem_dropped_count++; }
+    return;
+  }
+  crc = telem_crc8(crc, seq);
+  crc = telem_crc8(crc, type);
+  crc = telem_crc8(crc, length);
+  serial_write(TELEM_SYNC_BYTE);
+  serial_write(seq);
+  serial_write(type);
+  serial_write(length);
+  for (i = 0; i < length; i++) {
+    serial_write(payload[i]);
+    crc = telem_crc8(crc, payload[i]);
+  }
+  serial_write(crc);
+}
+
+// Gửi một frame telemetry binary - đánh seq, lưu vào history rồi phát
+// Host verify CRC và theo dõi seq: hỏng hoặc thiếu thì "RESEND=<seq>"
+void report_telemetry_frame(uint8_t type, uint8_t *payload, uint8_t length)
+{
+  uint8_t i;
+  telem_history_t *slot = &telem_history[telem_seq & (TELEM_HISTORY_SIZE-1)];
+  if (length > TELEM_MAX_PAYLOAD) { length = TELEM_MAX_PAYLOAD; } // Không xảy ra với các type hiện có
+  slot->seq = telem_seq;
+  slot->type = type;
+  slot->length = length;
+  for (i = 0; i < length; i++) { slot->payload[i] = payload[i]; }
+  telem_emit(telem_seq, type, payload, length);
+  telem_seq++;
+}
+
+// Phát lại frame seq từ history - frame giữ nguyên seq cũ để host ghép đúng chỗ
+uint8_t report_telemetry_resend(uint8_t seq)
+{
+  telem_history_t *slot = &telem_history[seq & (TELEM_HISTORY_SIZE-1)];
+  if ((slot->length == 0) || (slot->seq != seq)) { return(0); } // Đã bị ghi đè
+  telem_emit(slot->seq, slot->type, slot->payload, slot->length);
+  return(1);
+}
+
+// Số frame telemetry đã drop vì TX buffer đầy - hiện trong status (,TD:n)
+uint16_t report_telemetry_dropped(void)
+{
+  return telem_dropped_count;
+}
+
+
+// Báo cáo chẩn đoán serial (lệnh $D) - số liệu thật để tune buffer size và
+// baud thay vì mò: peak/size hai buffer, số byte RX đã vứt, số frame telemetry
+// đã drop, và số lần chuyển XON/XOFF nếu flow control bật
+void report_serial_diagnostics(void)
+{
+  printPgmString(PSTR("[RXPEAK:"));
+  print_uint32_base10((uint32_t)serial_get_rx_peak());
+  serial_write('/');
+  print_uint32_base10((uint32_t)RX_BUFFER_SIZE);
+  printPgmString(PSTR(",RXDROP:"));
+  print_uint32_base10((uint32_t)serial_get_rx_overflow_count());
+  printPgmString(PSTR(",TXPEAK:"));
+  print_uint32_base10((uint32_t)serial_get_tx_peak());
+  serial_write('/');
+  print_uint32_base10((uint32_t)TX_BUFFER_SIZE);
+  printPgmString(PSTR(",TD:"));
+  print_uint32_base10((uint32_t)telem_dropped_count);
+  #ifdef ENABLE_XONXOFF
+    printPgmString(PSTR(",FLOW:"));
+    print_uint32_base10((uint32_t)serial_get_flow_switch_count());
+  #endif
+  printPgmString(PSTR("]\r\n"));
+}
+
+
+// Báo cáo trạng thái cứu được sau watchdog reset - phát một lần ngay đầu
+// phiên: "[WDT_RESUME:x_steps,y_steps,z_steps,scan_active,points_done]".
+// Host đối chiếu points_done với scan đang dang dở để tiếp tục từ điểm cuối
+// đã phát thay vì quét lại từ đầu; vị trí in theo step thô (cùng quy ước
+// VL53L0X_POS) vì host resume bằng số liệu step của chính nó
+void report_wdt_resume(int32_t *position, uint8_t scan_active, uint16_t points_done)
+{
+  uint8_t idx;
+  printPgmString(PSTR("[WDT_RESUME:"));
+  for (idx = 0; idx < N_AXIS; idx++) {
+    printInteger((long)position[idx]);
+    serial_write(',');
+  }
+  print_uint8_base10(scan_active);
+  serial_write(',');
+  print_uint32_base10((uint32_t)points_done);
+  printPgmString(PSTR("]\r\n"));
+}
+
+
+// Báo cáo hồ sơ tải (lệnh $P) - trả lời scan khựng vì đâu: ISR max/avg theo
+// chu kỳ CPU (so với chu kỳ tick: 16MHz/30kHz = 533 là trần), mực nước thấp
+// nhất của segment buffer và planner buffer trong lúc cycle (chạm 0 = đói).
+// Mực nước in 255/n nghĩa là chưa có cycle nào trong cửa sổ đo. Đọc xong tự
+// xóa - mỗi $P là một cửa sổ đo mới, chạy một scan rồi $P để lấy số của nó.
+void report_profile_diagnostics(void)
+{
+  system_profile_t snapshot;
+  system_get_profile(&snapshot);
+  printPgmString(PSTR("[ISRMAX:"));
+  print_uint32_base10((uint32_t)snapshot.isr_max_cycles);
+  printPgmString(PSTR(",ISRAVG:"));
+  if (snapshot.isr_ticks) { print_uint32_base10(snapshot.isr_total_cycles/snapshot.isr_ticks); }
+  else { print_uint8_base10(0); }
+  printPgmString(PSTR(",ISRN:"));
+  print_uint32_base10(snapshot.isr_ticks);
+  printPgmString(PSTR(",SEGMIN:"));
+  print_uint8_base10(snapshot.segment_min);
+  serial_write('/');
+  print_uint8_base10(SEGMENT_BUFFER_SIZE);
+  printPgmString(PSTR(",PLANMIN:"));
+  print_uint8_base10(snapshot.plan_min);
+  serial_write('/');
+  print_uint8_base10(BLOCK_BUFFER_SIZE);
+  printPgmString(PSTR("]\r\n"));
+}
+
+
+// Auto-push status report - firmware tự phát status theo chu kỳ $S=<ms> thay
+// vì GUI poll '?' vài lần mỗi giây (mỗi '?' là một report_realtime_status đầy
+// đủ với các phép đổi float, chiếm link đang tải dữ liệu scan)
+uint16_t report_push_interval = 0; // ms, 0 = tắt; không lưu EEPROM (giống $B)
+static uint32_t report_push_last_us;
+static int32_t report_push_last_position[N_AXIS];
+static uint8_t report_push_force; // Ép push lần đầu ngay sau khi bật
+
+// Đặt chu kỳ auto-push (lệnh $S trong system.c) - push ngay một report để GUI
+// có trạng thái ban đầu không phải chờ hết chu kỳ đầu tiên
+void report_push_set_interval(uint16_t interval_ms)
+{
+  report_push_interval = interval_ms;
+  report_push_last_us = micros_now();
+  report_push_force = 1;
+}
+
+// Gọi mỗi vòng protocol_execute_realtime - push status khi đến chu kỳ
+// Khi máy đứng yên (IDLE) và vị trí không đổi từ lần push trước thì im lặng
+// để link chỉ mang dữ liệu đo; GUI vẫn gửi '?' thủ công được bất cứ lúc nào
+void report_push_check(void)
+{
+  uint8_t idx;
+  uint8_t changed;
+  if (!report_push_interval) { return; }
+  if (!report_push_force) {
+    if ((micros_now() - report_push_last_us) < ((uint32_t)report_push_interval)*1000UL) { return; }
+  }
+  report_push_last_us = micros_now();
+
+  changed = report_push_force;
+  report_push_force = 0;
+  for (idx = 0; idx < N_AXIS; idx++) {
+    if (sys.position[idx] != report_push_last_position[idx]) { changed = 1; }
+  }
+  if ((sys.state == STATE_IDLE) && !changed) { return; }
+  for (idx = 0; idx < N_AXIS; idx++) { report_push_last_position[idx] = sys.position[idx]; }
+  report_realtime_status();
+}
+
+
+#ifdef VL53L0X_CAL_LUT
+// In bảng hiệu chuẩn khoảng cách PROGMEM (lệnh $T)
+// Mỗi breakpoint một dòng: [CAL:raw_mm,offset_mm]
+void report_tof_cal_table(void)
+{
+  uint8_t idx;
+  uint16_t raw;
+  int16_t offset;
+  for (idx = 0; idx < VL53L0X_CAL_POINTS; idx++) {
+    vl53l0x_cal_entry(idx, &raw, &offset);
+    printPgmString(PSTR("[CAL:"));
+    printInteger((long)raw);
+    printPgmString(PSTR(","));
+    printInteger((long)offset);
+    printPgmString(PSTR("]\r\n"));
+  }
+}
+#endif
+
+
 // Prints the character string line Grbl has received from the user, which has been pre-parsed,
 // and has been sent into protocol_execute_line() routine to be executed by Grbl.
 void report_echo_line_received(char *line)
@@ -426,30 +662,45 @@ void report_realtime_status()
     case STATE_SAFETY_DOOR: printPgmString(PSTR("<Door")); break;
   }
  
-  // If reporting a position, convert the current step count (current_position) to millimeters.
-  if (bit_istrue(settings.status_report_mask,(BITFLAG_RT_STATUS_MACHINE_POSITION | BITFLAG_RT_STATUS_WORK_POSITION))) {
-    system_convert_array_steps_to_mpos(print_position,current_position);
-  }
-  
-  // Report machine position
-  if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_MACHINE_POSITION)) {
-    printPgmString(PSTR(",MPos:")); 
+  // Chế độ compact integer (bit 5 của $10): báo thẳng step count int32, bỏ
+  // MPos/WPos float. Đổi steps->mm + printFloat cho 3 trục tốn hàng nghìn
+  // chu kỳ mỗi report trên AVR không FPU - host chia settings.steps_per_mm
+  // ($100-$102) thì rẻ hơn nhiều. Kết hợp auto-push ($S) thì tần số report
+  // duy trì được khi scan tăng khoảng ba lần.
+  if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_STEP_POSITION)) {
+    printPgmString(PSTR(",SPos:"));
     for (idx=0; idx< N_AXIS; idx++) {
-      printFloat_CoordValue(print_position[idx]);
+      printInteger(current_position[idx]);
       if (idx < (N_AXIS-1)) { printPgmString(PSTR(",")); }
     }
-  }
-  
-  // Report work position
-  if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_WORK_POSITION)) {
-    printPgmString(PSTR(",WPos:")); 
-    for (idx=0; idx< N_AXIS; idx++) {
-      // Apply work coordinate offsets and tool length offset to current position.
-      print_position[idx] -= gc_state.coord_system[idx]+gc_state.coord_offset[idx];
-      if (idx == TOOL_LENGTH_OFFSET_AXIS) { print_position[idx] -= gc_state.tool_length_offset; }    
-      printFloat_CoordValue(print_position[idx]);
-      if (idx < (N_AXIS-1)) { printPgmString(PSTR(",")); }
+  } else {
+
+    // If reporting a position, convert the current step count (current_position) to millimeters.
+    if (bit_istrue(settings.status_report_mask,(BITFLAG_RT_STATUS_MACHINE_POSITION | BITFLAG_RT_STATUS_WORK_POSITION))) {
+      system_convert_array_steps_to_mpos(print_position,current_position);
+    }
+
+    // Report machine position
+    if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_MACHINE_POSITION)) {
+      printPgmString(PSTR(",MPos:"));
+      for (idx=0; idx< N_AXIS; idx++) {
+        printFloat_CoordValue(print_position[idx]);
+        if (idx < (N_AXIS-1)) { printPgmString(PSTR(",")); }
+      }
+    }
+
+    // Report work position
+    if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_WORK_POSITION)) {
+      printPgmString(PSTR(",WPos:"));
+      for (idx=0; idx< N_AXIS; idx++) {
+        // Apply work coordinate offsets and tool length offset to current position.
+        print_position[idx] -= gc_state.coord_system[idx]+gc_state.coord_offset[idx];
+        if (idx == TOOL_LENGTH_OFFSET_AXIS) { print_position[idx] -= gc_state.tool_length_offset; }
+        printFloat_CoordValue(print_position[idx]);
+        if (idx < (N_AXIS-1)) { printPgmString(PSTR(",")); }
+      }
     }
+
   }
         
   // Returns the number of active blocks are in the planner buffer.
@@ -461,7 +712,22 @@ void report_realtime_status()
   // Report serial read buffer status
   if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_SERIAL_RX)) {
     printPgmString(PSTR(",RX:"));
-    print_uint8_base10(serial_get_rx_buffer_count());
+    // serial_idx_t - có thể vượt 255 với buffer lớn trên Mega 2560
+    print_uint32_base10((uint32_t)serial_get_rx_buffer_count());
+  }
+
+  // Báo số lần bus I2C đã phải recovery - bình thường luôn là 0, tăng dần
+  // nghĩa là dây sensor hoặc pull-up có vấn đề (xem i2c_bus_recover trong i2c.c)
+  if (i2c_get_recovery_count()) {
+    printPgmString(PSTR(",I2C:"));
+    print_uint8_base10(i2c_get_recovery_count());
+  }
+
+  // Số frame telemetry đã drop vì TX buffer đầy - tăng dần nghĩa là host rút
+  // cổng quá chậm so với tốc độ đo (cân nhắc tăng baud hoặc giảm sample rate)
+  if (telem_dropped_count) {
+    printPgmString(PSTR(",TD:"));
+    print_uint32_base10((uint32_t)telem_dropped_count);
   }
     
   #ifdef USE_LINE_NUMBERS
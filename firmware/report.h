@@ -28,6 +28,7 @@
 #define STATUS_SOFT_LIMIT_ERROR 10
 #define STATUS_OVERFLOW 11
 #define STATUS_MAX_STEP_RATE_EXCEEDED 12
+#define STATUS_SENSOR_TIMEOUT 13
 
 #define STATUS_GCODE_UNSUPPORTED_COMMAND 20
 #define STATUS_GCODE_MODAL_GROUP_VIOLATION 21
@@ -54,6 +55,7 @@
 #define ALARM_ABORT_CYCLE 3
 #define ALARM_PROBE_FAIL 4
 #define ALARM_HOMING_FAIL 5
+#define ALARM_RX_OVERFLOW 6
 
 // Define Grbl feedback message codes.
 #define MESSAGE_CRITICAL_EVENT 1
@@ -104,4 +106,76 @@ void report_startup_line(uint8_t n, char *line);
 // Prints build info and user info
 void report_build_info(char *line);
 
+#ifdef VL53L0X_CAL_LUT
+// In bảng hiệu chuẩn khoảng cách VL53L0X (lệnh $T)
+void report_tof_cal_table(void);
+#endif
+
+// Binary framed telemetry - thay các dòng ASCII "VL53L0X_DISTANCE:..." (~25
+// byte + printInteger chia lặp) bằng frame ~7 byte khi GUI bật qua lệnh $B=1.
+// Frame: [sync][seq][type][length][payload...][CRC8 của seq+type+length+payload]
+// Payload số nhiều byte theo thứ tự little-endian (AVR native, struct '<' Python)
+// seq tăng 1 mỗi frame (wrap 255->0); CRC8 poly 0x07, init 0x00. Host phát
+// hiện frame hỏng (CRC sai) hoặc thiếu (seq nhảy) thì gửi "RESEND=<seq>" -
+// firmware giữ TELEM_HISTORY_SIZE frame gần nhất để phát lại, nhờ đó chạy
+// được 500k baud thay vì phải đậu ở 115200 cho an toàn
+#define TELEM_SYNC_BYTE      0xA5
+#define TELEM_TYPE_VL53L0X   0x01 // payload: uint16 distance (mm)
+#define TELEM_TYPE_VL53L1    0x02 // payload: uint16 distance (mm)
+#define TELEM_TYPE_SAMPLE_T  0x03 // payload: uint16 distance + uint32 micros
+#define TELEM_TYPE_DUAL      0x04 // payload: uint16 distance_a + uint16 distance_b
+#define TELEM_TYPE_FILTERED  0x05 // payload: uint16 distance (median)
+#define TELEM_TYPE_SCAN      0x06 // payload: int32 x_steps + uint16 distance (lệnh SCAN)
+#define TELEM_TYPE_SAMPLE_P  0x07 // payload: uint16 distance + int32 x_steps + int32 z_steps
+#define TELEM_TYPE_SCAN_H    0x08 // payload: int32 x_steps + int32 y_steps + uint16 distance (SCAN xoắn ốc)
+#define TELEM_TYPE_DELTA     0x09 // payload: uint16 keyframe + zigzag-varint delta cho các sample sau
+#define TELEM_TYPE_EXT       0x0A // payload: uint16 distance + uint8 status + uint16 signal + uint16 ambient
+
+// Chế độ telemetry: 0 = ASCII (mặc định), 1 = binary frame, 2 = binary frame
+// + nén delta cho burst (TELEM_TYPE_DELTA). Không lưu EEPROM - GUI negotiate
+// lại mỗi session qua $B
+extern uint8_t telemetry_binary_mode;
+
+// Số frame telemetry giữ lại để phát lại theo yêu cầu RESEND (lũy thừa của 2)
+#define TELEM_HISTORY_SIZE 4
+// TELEM_TYPE_DELTA gom nhiều sample một frame - payload càng lớn overhead
+// frame (5 byte) chia càng mỏng; 16 byte ~ 15 sample khi delta nhỏ
+#define TELEM_MAX_PAYLOAD 16
+
+// CRC8 poly 0x07 từng byte - dùng cho frame telemetry TX và motion packet RX
+uint8_t telem_crc8(uint8_t crc, uint8_t data);
+
+// Gửi một frame telemetry binary ra serial (kèm seq + CRC8, lưu vào history)
+void report_telemetry_frame(uint8_t type, uint8_t *payload, uint8_t length);
+
+// Phát lại frame có sequence number seq từ history (lệnh RESEND=<seq>)
+// Trả về 1 nếu còn trong history, 0 nếu đã bị ghi đè (host coi như mất mẫu)
+uint8_t report_telemetry_resend(uint8_t seq);
+
+// Số frame telemetry đã drop vì TX buffer đầy (đường ghi không chặn)
+uint16_t report_telemetry_dropped(void);
+
+// In báo cáo chẩn đoán serial (lệnh $D): peak buffer, byte drop, flow control
+void report_serial_diagnostics(void);
+
+// In hồ sơ tải (lệnh $P): ISR stepper max/avg, mực nước thấp nhất hai buffer.
+// Đọc xong tự xóa - mỗi $P là một cửa sổ đo mới.
+void report_profile_diagnostics(void);
+
+#ifdef WATCHDOG_SUPERVISION
+  // Phát trạng thái cứu được sau watchdog reset (một lần, đầu phiên)
+  void report_wdt_resume(int32_t *position, uint8_t scan_active, uint16_t points_done);
+#endif
+
+// Auto-push status report: firmware tự phát status mỗi $S=<ms> để GUI khỏi
+// poll '?'. 0 = tắt (mặc định). Không lưu EEPROM - negotiate mỗi session.
+#define REPORT_PUSH_MIN_INTERVAL_MS 50 // Chu kỳ tối thiểu - chống spam link
+extern uint16_t report_push_interval;
+
+// Đặt chu kỳ auto-push (ms, 0 = tắt) - dùng từ lệnh $S trong system.c
+void report_push_set_interval(uint16_t interval_ms);
+
+// Push status nếu đến chu kỳ - gọi mỗi vòng protocol_execute_realtime
+void report_push_check(void);
+
 #endif
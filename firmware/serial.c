@@ -15,43 +15,94 @@
 #include "grbl.h"
 
 // Buffer RX (circular buffer)
+// Chỉ số là serial_idx_t (serial.h): uint8_t cho buffer <= 256 byte như cũ,
+// uint16_t cho buffer lớn trên Mega 2560 (SERIAL_WIDE_BUFFERS)
 uint8_t serial_rx_buffer[RX_BUFFER_SIZE];
-uint8_t serial_rx_buffer_head = 0;        // Con trỏ ghi
-volatile uint8_t serial_rx_buffer_tail = 0; // Con trỏ đọc (volatile vì thay đổi trong ISR)
+volatile serial_idx_t serial_rx_buffer_head = 0;  // Con trỏ ghi (ISR cập nhật)
+volatile serial_idx_t serial_rx_buffer_tail = 0;  // Con trỏ đọc (main cập nhật)
 
 // Buffer TX (circular buffer)
 uint8_t serial_tx_buffer[TX_BUFFER_SIZE];
-uint8_t serial_tx_buffer_head = 0;        // Con trỏ ghi
-volatile uint8_t serial_tx_buffer_tail = 0; // Con trỏ đọc (volatile vì thay đổi trong ISR)
+serial_idx_t serial_tx_buffer_head = 0;           // Con trỏ ghi (main cập nhật)
+volatile serial_idx_t serial_tx_buffer_tail = 0;  // Con trỏ đọc (ISR cập nhật)
 
 #ifdef ENABLE_XONXOFF
   volatile uint8_t flow_ctrl = XON_SENT; // Biến trạng thái flow control
 #endif
 
+// Thống kê chẩn đoán (lệnh $D) - trước đây tune kích thước buffer và baud mò,
+// giờ có số liệu: mực nước cao nhất hai buffer, số byte RX bị vứt vì đầy
+static uint16_t serial_rx_overflow_count = 0;  // Byte RX đã vứt (buffer đầy)
+static serial_idx_t serial_rx_peak = 0;        // High-water mark buffer RX
+static serial_idx_t serial_tx_peak = 0;        // High-water mark buffer TX
+#ifdef ENABLE_XONXOFF
+  static uint16_t serial_flow_switch_count = 0; // Số lần chuyển XON<->XOFF
+#endif
+
+// Copy một chỉ số buffer mà phía bên kia (ISR hoặc main) đang cập nhật
+// Buffer rộng: load 16-bit là hai lệnh - tắt interrupt lúc copy để không bị xé
+static serial_idx_t serial_idx_read(volatile serial_idx_t *idx)
+{
+  #ifdef SERIAL_WIDE_BUFFERS
+    uint8_t sreg = SREG;
+    cli();
+    serial_idx_t val = *idx;
+    SREG = sreg;
+    return val;
+  #else
+    return *idx;
+  #endif
+}
+
+// Ghi một chỉ số buffer mà ISR đang đọc (đối xứng với serial_idx_read)
+static void serial_idx_write(volatile serial_idx_t *idx, serial_idx_t val)
+{
+  #ifdef SERIAL_WIDE_BUFFERS
+    uint8_t sreg = SREG;
+    cli();
+    *idx = val;
+    SREG = sreg;
+  #else
+    *idx = val;
+  #endif
+}
+
 // Trả về số byte đã dùng trong buffer RX
-uint8_t serial_get_rx_buffer_count()
+serial_idx_t serial_get_rx_buffer_count()
 {
-  uint8_t rtail = serial_rx_buffer_tail; // Copy để tránh gọi nhiều lần volatile
-  if (serial_rx_buffer_head >= rtail) {
-    return(serial_rx_buffer_head-rtail);
+  serial_idx_t rhead = serial_idx_read(&serial_rx_buffer_head); // Copy để tránh gọi nhiều lần volatile
+  serial_idx_t rtail = serial_idx_read(&serial_rx_buffer_tail);
+  if (rhead >= rtail) {
+    return(rhead-rtail);
   }
-  return (RX_BUFFER_SIZE - (rtail-serial_rx_buffer_head));
+  return (RX_BUFFER_SIZE - (rtail-rhead));
 }
 
 // Trả về số byte đã dùng trong buffer TX (chủ yếu dùng để debug)
-uint8_t serial_get_tx_buffer_count()
+serial_idx_t serial_get_tx_buffer_count()
 {
-  uint8_t ttail = serial_tx_buffer_tail; // Copy để tránh gọi nhiều lần volatile
+  serial_idx_t ttail = serial_idx_read(&serial_tx_buffer_tail); // Copy để tránh gọi nhiều lần volatile
   if (serial_tx_buffer_head >= ttail) {
     return(serial_tx_buffer_head-ttail);
   }
   return (TX_BUFFER_SIZE - (ttail-serial_tx_buffer_head));
 }
 
+// Trả về số byte còn trống trong buffer TX - cho đường ghi telemetry không
+// chặn (report.c kiểm tra đủ chỗ cho cả frame trước khi ghi). Giá trị chỉ có
+// thể tăng sau khi trả về (ISR chỉ rút buffer) nên kiểm tra là an toàn.
+serial_idx_t serial_get_tx_buffer_free()
+{
+  return (TX_BUFFER_SIZE - 1 - serial_get_tx_buffer_count());
+}
+
 // Khởi tạo giao tiếp serial
 void serial_init()
 {
   // Thiết lập tốc độ baud
+  // Đường U2X0 phục vụ luôn các profile tốc độ cao (xem config.h): với F_CPU
+  // 16MHz, 250k/500k/1M chia chẵn ra UBRR0 = 7/3/1, lỗi baud 0% - khác 115200
+  // vốn lệch ~2.1%
   #if BAUD_RATE < 57600
     uint16_t UBRR0_value = ((F_CPU / (8L * BAUD_RATE)) - 1)/2 ;
     UCSR0A &= ~(1 << U2X0); // baud doubler off  - Only needed on Uno XXX
@@ -75,26 +126,30 @@ void serial_init()
 
 // Ghi 1 byte vào buffer TX (circular buffer)
 void serial_write(uint8_t data) {
-  uint8_t next_head = serial_tx_buffer_head + 1;
+  serial_idx_t next_head = serial_tx_buffer_head + 1;
   if (next_head == TX_BUFFER_SIZE) { next_head = 0; } // Wrap around
 
   // Chờ đến khi có chỗ trống trong buffer
-  while (next_head == serial_tx_buffer_tail) { 
+  while (next_head == serial_idx_read(&serial_tx_buffer_tail)) {
     if (sys_rt_exec_state & EXEC_RESET) { return; } // Kiểm tra reset để tránh vòng lặp vô hạn
   }
 
   // Lưu dữ liệu và tăng con trỏ head
   serial_tx_buffer[serial_tx_buffer_head] = data;
   serial_tx_buffer_head = next_head;
-  
+
+  // Cập nhật high-water mark TX cho chẩn đoán $D
+  serial_idx_t tx_count = serial_get_tx_buffer_count();
+  if (tx_count > serial_tx_peak) { serial_tx_peak = tx_count; }
+
   // Bật interrupt Data Register Empty để đảm bảo tx-streaming chạy
-  UCSR0B |=  (1 << UDRIE0); 
+  UCSR0B |=  (1 << UDRIE0);
 }
 
 // Interrupt handler khi Data Register Empty (sẵn sàng ghi byte tiếp theo)
 ISR(SERIAL_UDRE)
 {
-  uint8_t tail = serial_tx_buffer_tail; // Temporary serial_tx_buffer_tail (to optimize for volatile)
+  serial_idx_t tail = serial_tx_buffer_tail; // Temporary serial_tx_buffer_tail (to optimize for volatile)
   
   #ifdef ENABLE_XONXOFF
     if (flow_ctrl == SEND_XOFF) { 
@@ -121,20 +176,21 @@ ISR(SERIAL_UDRE)
 // Đọc byte đầu tiên từ buffer RX
 uint8_t serial_read()
 {
-  uint8_t tail = serial_rx_buffer_tail; // Copy để tối ưu volatile
-  if (serial_rx_buffer_head == tail) {
+  serial_idx_t tail = serial_rx_buffer_tail; // Copy để tối ưu volatile (main sở hữu tail)
+  if (serial_idx_read(&serial_rx_buffer_head) == tail) {
     return SERIAL_NO_DATA; // Buffer rỗng
   } else {
     uint8_t data = serial_rx_buffer[tail];
-    
+
     tail++; // Tăng con trỏ tail
     if (tail == RX_BUFFER_SIZE) { tail = 0; } // Wrap around
-    serial_rx_buffer_tail = tail;
+    serial_idx_write(&serial_rx_buffer_tail, tail); // RX ISR đọc tail khi kiểm tra buffer đầy
 
     #ifdef ENABLE_XONXOFF
       // Gửi XON nếu buffer đã giảm xuống ngưỡng thấp
-      if ((serial_get_rx_buffer_count() < RX_BUFFER_LOW) && flow_ctrl == XOFF_SENT) { 
+      if ((serial_get_rx_buffer_count() < RX_BUFFER_LOW) && flow_ctrl == XOFF_SENT) {
         flow_ctrl = SEND_XON;
+        serial_flow_switch_count++;
         UCSR0B |=  (1 << UDRIE0); // Force TX để gửi XON
       }
     #endif
@@ -147,43 +203,102 @@ uint8_t serial_read()
 ISR(SERIAL_RX)
 {
   uint8_t data = UDR0;
-  uint8_t next_head;
-  
-  // Xử lý real-time command characters trực tiếp từ serial stream
-  // Các ký tự này không vào buffer, mà set flag bits cho real-time execution
-  switch (data) {
-    case CMD_STATUS_REPORT: bit_true_atomic(sys_rt_exec_state, EXEC_STATUS_REPORT); break; // Báo cáo trạng thái
-    case CMD_CYCLE_START:   bit_true_atomic(sys_rt_exec_state, EXEC_CYCLE_START); break; // Bắt đầu chu trình
-    case CMD_FEED_HOLD:     bit_true_atomic(sys_rt_exec_state, EXEC_FEED_HOLD); break; // Tạm dừng feed
-    case CMD_SAFETY_DOOR:   bit_true_atomic(sys_rt_exec_state, EXEC_SAFETY_DOOR); break; // Cửa an toàn
-    case CMD_RESET:         mc_reset(); break; // Reset motion control
-    default: // Ghi ký tự vào buffer
-      next_head = serial_rx_buffer_head + 1;
-      if (next_head == RX_BUFFER_SIZE) { next_head = 0; }
-    
-      // Write data to buffer unless it is full.
-      if (next_head != serial_rx_buffer_tail) {
-        serial_rx_buffer[serial_rx_buffer_head] = data;
-        serial_rx_buffer_head = next_head;    
-        
-        #ifdef ENABLE_XONXOFF
-          if ((serial_get_rx_buffer_count() >= RX_BUFFER_FULL) && flow_ctrl == XON_SENT) {
-            flow_ctrl = SEND_XOFF;
-            UCSR0B |=  (1 << UDRIE0); // Force TX
-          } 
-        #endif
-        
+  serial_idx_t next_head;
+  // Đếm lùi passthrough cho motion packet binary: sau byte sync 0xA6,
+  // MOTION_PACKET_TAIL byte payload kế đi thẳng vào buffer - payload có thể
+  // trùng mã realtime ('?','~','!',0x18) và không được phép bị chặn ở đây
+  static uint8_t rx_binary_count = 0;
+
+  if (rx_binary_count) {
+    rx_binary_count--;
+  } else {
+    // Xử lý real-time command characters trực tiếp từ serial stream
+    // Các ký tự này không vào buffer, mà set flag bits cho real-time execution
+    switch (data) {
+      case CMD_STATUS_REPORT: bit_true_atomic(sys_rt_exec_state, EXEC_STATUS_REPORT); return; // Báo cáo trạng thái
+      case CMD_CYCLE_START:   bit_true_atomic(sys_rt_exec_state, EXEC_CYCLE_START); return; // Bắt đầu chu trình
+      case CMD_FEED_HOLD:     bit_true_atomic(sys_rt_exec_state, EXEC_FEED_HOLD); return; // Tạm dừng feed
+      case CMD_SAFETY_DOOR:   bit_true_atomic(sys_rt_exec_state, EXEC_SAFETY_DOOR); return; // Cửa an toàn
+      case CMD_RESET:         mc_reset(); return; // Reset motion control
+      case MOTION_PACKET_SYNC: rx_binary_count = MOTION_PACKET_TAIL; break; // Mở passthrough packet
+      default: break; // Ký tự thường - ghi vào buffer bên dưới
+    }
+  }
+
+  next_head = serial_rx_buffer_head + 1;
+  if (next_head == RX_BUFFER_SIZE) { next_head = 0; }
+
+  // Write data to buffer unless it is full.
+  if (next_head != serial_rx_buffer_tail) {
+    serial_rx_buffer[serial_rx_buffer_head] = data;
+    serial_rx_buffer_head = next_head;
+
+    // Cập nhật high-water mark RX cho chẩn đoán $D
+    serial_idx_t rx_count = serial_get_rx_buffer_count();
+    if (rx_count > serial_rx_peak) { serial_rx_peak = rx_count; }
+
+    #ifdef ENABLE_XONXOFF
+      if ((serial_get_rx_buffer_count() >= RX_BUFFER_FULL) && flow_ctrl == XON_SENT) {
+        flow_ctrl = SEND_XOFF;
+        serial_flow_switch_count++;
+        UCSR0B |=  (1 << UDRIE0); // Force TX
       }
-      //TODO: else alarm on overflow?
+    #endif
+
+  } else {
+    // Buffer đầy - byte g-code bị vứt. Trước đây im lặng và chỉ lộ ra
+    // thành layer hỏng cả giờ sau; giờ đếm lại và phát alarm để dừng ngay
+    if (serial_rx_overflow_count < 0xFFFF) { serial_rx_overflow_count++; }
+    bit_true_atomic(sys_rt_exec_alarm, EXEC_ALARM_RX_OVERFLOW);
   }
 }
 
 
-void serial_reset_read_buffer() 
+void serial_reset_read_buffer()
 {
-  serial_rx_buffer_tail = serial_rx_buffer_head;
+  serial_idx_write(&serial_rx_buffer_tail, serial_idx_read(&serial_rx_buffer_head));
 
   #ifdef ENABLE_XONXOFF
     flow_ctrl = XON_SENT;
   #endif
 }
+
+
+// Các getter thống kê chẩn đoán cho report_serial_diagnostics() (lệnh $D)
+
+// Số byte RX đã bị vứt vì buffer đầy - khác 0 nghĩa là host stream nhanh hơn
+// firmware tiêu thụ (tăng buffer, giảm tốc stream hoặc bật flow control)
+uint16_t serial_get_rx_overflow_count()
+{
+  return serial_rx_overflow_count;
+}
+
+// Mực nước cao nhất buffer RX từ lúc boot - sát RX_BUFFER_SIZE là sắp tràn
+serial_idx_t serial_get_rx_peak()
+{
+  serial_idx_t peak;
+  uint8_t sreg = SREG;
+  cli(); // ISR RX cập nhật peak - copy nguyên vẹn (16-bit với buffer rộng)
+  peak = serial_rx_peak;
+  SREG = sreg;
+  return peak;
+}
+
+// Mực nước cao nhất buffer TX - chạm trần nghĩa là serial_write từng phải chờ
+serial_idx_t serial_get_tx_peak()
+{
+  return serial_tx_peak; // Chỉ main context cập nhật - đọc thẳng được
+}
+
+#ifdef ENABLE_XONXOFF
+// Số lần chuyển trạng thái XON<->XOFF - nhiều nghĩa là RX thường xuyên gần đầy
+uint16_t serial_get_flow_switch_count()
+{
+  uint16_t count;
+  uint8_t sreg = SREG;
+  cli();
+  count = serial_flow_switch_count;
+  SREG = sreg;
+  return count;
+}
+#endif
@@ -23,12 +23,24 @@
   #define TX_BUFFER_SIZE 64   // Buffer ghi
 #endif
 
+// Buffer > 256 byte (override trong cpu_map_atmega2560.h) cần chỉ số 16-bit.
+// Load/store 16-bit không atomic trên AVR, nên khi một phía là ISR serial.c
+// phải copy chỉ số trong critical section - SERIAL_WIDE_BUFFERS đánh dấu đó.
+#if (RX_BUFFER_SIZE > 256) || (TX_BUFFER_SIZE > 256)
+  #define SERIAL_WIDE_BUFFERS
+  typedef uint16_t serial_idx_t;
+#else
+  typedef uint8_t serial_idx_t;
+#endif
+
 #define SERIAL_NO_DATA 0xff  // Không có dữ liệu
 
 // Cấu hình XON/XOFF flow control (nếu bật)
+// Ngưỡng theo tỷ lệ buffer để vẫn đúng khi RX_BUFFER_SIZE được phóng to
+// (128 byte -> giữ nguyên 96/64 như trước)
 #ifdef ENABLE_XONXOFF
-  #define RX_BUFFER_FULL 96  // Ngưỡng cao XOFF
-  #define RX_BUFFER_LOW 64   // Ngưỡng thấp XON
+  #define RX_BUFFER_FULL ((RX_BUFFER_SIZE/4)*3) // Ngưỡng cao XOFF
+  #define RX_BUFFER_LOW (RX_BUFFER_SIZE/2)      // Ngưỡng thấp XON
   #define SEND_XOFF 1
   #define SEND_XON 2
   #define XOFF_SENT 3
@@ -50,9 +62,20 @@ uint8_t serial_read();
 void serial_reset_read_buffer();
 
 // Trả về số byte đã dùng trong buffer RX
-uint8_t serial_get_rx_buffer_count();
+serial_idx_t serial_get_rx_buffer_count();
 
 // Trả về số byte đã dùng trong buffer TX (chủ yếu dùng để debug)
-uint8_t serial_get_tx_buffer_count();
+serial_idx_t serial_get_tx_buffer_count();
+
+// Trả về số byte còn trống trong buffer TX (đường telemetry không chặn)
+serial_idx_t serial_get_tx_buffer_free();
+
+// Thống kê chẩn đoán serial - xem report_serial_diagnostics() (lệnh $D)
+uint16_t serial_get_rx_overflow_count(); // Byte RX bị vứt vì buffer đầy
+serial_idx_t serial_get_rx_peak();       // High-water mark buffer RX
+serial_idx_t serial_get_tx_peak();       // High-water mark buffer TX
+#ifdef ENABLE_XONXOFF
+  uint16_t serial_get_flow_switch_count(); // Số lần chuyển XON<->XOFF
+#endif
 
 #endif
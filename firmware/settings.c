@@ -16,6 +16,198 @@
 
 settings_t settings; // Global settings struct
 
+// Fallback cho các file defaults máy khác chưa định nghĩa setting scanner
+#ifndef DEFAULT_I2C_FAST_MODE
+  #define DEFAULT_I2C_FAST_MODE 0
+#endif
+#ifndef DEFAULT_TOF_PROFILE
+  #define DEFAULT_TOF_PROFILE 0
+#endif
+#ifndef DEFAULT_TOF_FILTER_WINDOW
+  #define DEFAULT_TOF_FILTER_WINDOW 5
+#endif
+
+// ===== Flush settings nền =====
+// eeprom_put_char() spin-wait EEPE ~3.4ms MỖI byte - write_global_settings()
+// đồng bộ (~80 byte struct + version + checksum) treo main loop gần 300ms,
+// đủ bỏ đói segment buffer nếu máy đang chạy. settings struct vốn đã sống
+// trong RAM, nên `$x=val` giờ chỉ sửa RAM rồi đánh dấu dirty; journal dưới
+// đây nhỏ giọt từng byte xuống EEPROM từ slot rảnh của protocol_main_loop,
+// mỗi lượt kiểm tra eeprom_ready() trước nên không bao giờ chờ thật.
+static uint8_t settings_flush_pending = 0; // RAM có thay đổi chưa xuống EEPROM
+static uint8_t settings_flush_pos;         // Byte kế: 0 = version, 1.. = data, cuối = checksum
+static uint8_t settings_flush_checksum;    // Checksum tích lũy theo đúng memcpy_to_eeprom_with_checksum
+
+// Đánh dấu settings struct đã thay đổi - flush (lại) từ đầu để checksum nhất quán
+void settings_flush_mark()
+{
+  settings_flush_pos = 0;
+  settings_flush_pending = 1;
+}
+
+// Ghi tối đa MỘT byte xuống EEPROM, và chỉ khi write trước đã xong - gọi từ
+// slot rảnh của protocol_main_loop, mỗi lượt trả về trong vài micro giây
+void settings_flush_step()
+{
+  if (!settings_flush_pending) { return; }
+  if (!eeprom_ready()) { return; } // Write trước chưa xong - lượt sau ghi tiếp
+  if (settings_flush_pos == 0) {
+    eeprom_put_char(0, SETTINGS_VERSION); // Version ở byte đầu tiên
+    settings_flush_checksum = 0;
+    settings_flush_pos++;
+    return;
+  }
+  uint8_t data_idx = settings_flush_pos - 1;
+  if (data_idx < sizeof(settings_t)) {
+    uint8_t data = ((uint8_t *)&settings)[data_idx];
+    // Cùng công thức (kể cả dị tật '||') với memcpy_to_eeprom_with_checksum -
+    // memcpy_from_eeprom_with_checksum lúc boot phải ra đúng giá trị này
+    settings_flush_checksum = (settings_flush_checksum << 1) || (settings_flush_checksum >> 7);
+    settings_flush_checksum += data;
+    eeprom_put_char(EEPROM_ADDR_GLOBAL + data_idx, data);
+    settings_flush_pos++;
+    return;
+  }
+  eeprom_put_char(EEPROM_ADDR_GLOBAL + sizeof(settings_t), settings_flush_checksum);
+  settings_flush_pending = 0;
+}
+
+// Flush đồng bộ cho hết pending - gọi trước khi reset hệ thống để thay đổi
+// chưa xuống EEPROM không bị mất (lúc này không còn motion để bỏ đói)
+void settings_flush_sync()
+{
+  while (settings_flush_pending) { settings_flush_step(); }
+}
+
+
+#ifdef POSITION_CHECKPOINT
+// ===== Checkpoint vị trí máy =====
+// Mỗi lần bật nguồn lại mất ~30 giây homing (hoặc kẹt alarm theo
+// HOMING_INIT_LOCK) dù bàn máy không hề dịch chuyển khi tắt. Ring 8 slot
+// trong EEPROM lưu sys.position kèm seq tăng dần: mỗi checkpoint ghi sang
+// slot kế nên không cell nào mòn nhanh hơn 1/8 số lần ghi. Ghi nhỏ giọt
+// từng byte khi máy IDLE (cùng kiểu với flush settings ở trên), một byte
+// cổng hợp lệ ở cuối ring đóng/mở đường fast-restore: reset hay limit giữa
+// chuyển động (có thể đã mất bước) ghi 0x00 vào cổng - boot kế tiếp lại
+// homing như cũ.
+static uint8_t checkpoint_seq;              // Seq của record đang/đã ghi
+static uint8_t checkpoint_slot;             // Slot của record đang/đã ghi
+static int32_t checkpoint_snapshot[N_AXIS]; // Vị trí chốt lúc mở record
+static int32_t checkpoint_saved[N_AXIS];    // Vị trí của checkpoint hoàn chỉnh gần nhất
+static uint8_t checkpoint_flush_pos = 0xFF; // Byte kế trong record; 0xFF = không ghi dở, 0xFE = chờ ghi cổng
+static uint8_t checkpoint_flush_checksum;
+static uint8_t checkpoint_gate_ok;          // Cổng hợp lệ 0x01 đã nằm trong EEPROM
+static uint8_t checkpoint_invalidate_pending; // Chờ ghi 0x00 vào cổng hợp lệ
+
+// Vị trí không còn tin được (reset/limit giữa chuyển động - mất bước). Chỉ
+// đặt cờ RAM nên gọi được từ mức interrupt (mc_reset); cổng hợp lệ được ghi
+// 0x00 ở lượt settings_checkpoint_step kế tiếp của main loop
+void settings_checkpoint_invalidate()
+{
+  checkpoint_invalidate_pending = 1;
+  checkpoint_flush_pos = 0xFF; // Bỏ record đang ghi dở - nội dung đã vô nghĩa
+}
+
+// Ghi tối đa MỘT byte checkpoint mỗi lượt, chỉ khi EEPROM rảnh - gọi từ slot
+// rảnh của protocol_main_loop, cùng nhịp với settings_flush_step()
+void settings_checkpoint_step()
+{
+  if (!eeprom_ready()) { return; } // Write trước chưa xong - lượt sau ghi tiếp
+  if (checkpoint_invalidate_pending) {
+    eeprom_put_char(EEPROM_ADDR_POSITION_VALID, 0x00);
+    checkpoint_invalidate_pending = 0;
+    checkpoint_gate_ok = 0;
+    return;
+  }
+  if (checkpoint_flush_pos == 0xFE) {
+    // Record vừa xong - mở cổng hợp lệ (eeprom_put_char tự bỏ qua nếu cell
+    // đã là 0x01 nên cell cổng không bị mòn theo từng checkpoint)
+    eeprom_put_char(EEPROM_ADDR_POSITION_VALID, 0x01);
+    checkpoint_gate_ok = 1;
+    checkpoint_flush_pos = 0xFF;
+    return;
+  }
+  if (checkpoint_flush_pos == 0xFF) {
+    // Không có record dở - mở record mới khi máy đứng yên và vị trí đã đổi
+    if (sys.state != STATE_IDLE) { return; }
+    if (checkpoint_gate_ok &&
+        (!memcmp(checkpoint_saved, (void *)sys.position, sizeof(checkpoint_saved)))) { return; }
+    memcpy(checkpoint_snapshot, (void *)sys.position, sizeof(checkpoint_snapshot));
+    checkpoint_seq++;
+    checkpoint_slot++;
+    if (checkpoint_slot == POSITION_CHECKPOINT_SLOTS) { checkpoint_slot = 0; }
+    checkpoint_flush_pos = 0;
+    return;
+  }
+  uint16_t base = EEPROM_ADDR_POSITION + checkpoint_slot*POSITION_CHECKPOINT_SIZE;
+  if (checkpoint_flush_pos == 0) {
+    checkpoint_flush_checksum = 0;
+    checkpoint_flush_checksum = (checkpoint_flush_checksum << 1) || (checkpoint_flush_checksum >> 7);
+    checkpoint_flush_checksum += checkpoint_seq;
+    eeprom_put_char(base, checkpoint_seq);
+    checkpoint_flush_pos++;
+    return;
+  }
+  uint8_t data_idx = checkpoint_flush_pos - 1;
+  if (data_idx < sizeof(checkpoint_snapshot)) {
+    uint8_t data = ((uint8_t *)checkpoint_snapshot)[data_idx];
+    checkpoint_flush_checksum = (checkpoint_flush_checksum << 1) || (checkpoint_flush_checksum >> 7);
+    checkpoint_flush_checksum += data;
+    eeprom_put_char(base + 1 + data_idx, data);
+    checkpoint_flush_pos++;
+    return;
+  }
+  eeprom_put_char(base + 1 + sizeof(checkpoint_snapshot), checkpoint_flush_checksum);
+  memcpy(checkpoint_saved, checkpoint_snapshot, sizeof(checkpoint_saved));
+  checkpoint_flush_pos = 0xFE; // Lượt kế: mở cổng hợp lệ
+}
+
+// Boot: tìm record mới nhất còn checksum hợp lệ trong ring và nạp vào
+// position. Trả 1 nếu nạp được (cổng hợp lệ mở + có record tốt) - caller bỏ
+// qua homing/alarm đầu phiên; trả 0 thì mọi thứ như Grbl nguyên bản
+uint8_t settings_read_position_checkpoint(int32_t *position)
+{
+  uint8_t slot, idx, seq, data, checksum;
+  uint8_t newest_slot = 0xFF;
+  uint8_t newest_seq = 0;
+  uint16_t base;
+
+  if (eeprom_get_char(EEPROM_ADDR_POSITION_VALID) != 0x01) { return(0); }
+  for (slot = 0; slot < POSITION_CHECKPOINT_SLOTS; slot++) {
+    base = EEPROM_ADDR_POSITION + slot*POSITION_CHECKPOINT_SIZE;
+    seq = eeprom_get_char(base);
+    checksum = 0;
+    checksum = (checksum << 1) || (checksum >> 7);
+    checksum += seq;
+    for (idx = 0; idx < sizeof(int32_t)*N_AXIS; idx++) {
+      data = eeprom_get_char(base + 1 + idx);
+      checksum = (checksum << 1) || (checksum >> 7);
+      checksum += data;
+    }
+    if (checksum != eeprom_get_char(base + 1 + sizeof(int32_t)*N_AXIS)) { continue; }
+    // So seq theo số học modulo 256 - ring sống lâu hơn một vòng uint8
+    if ((newest_slot == 0xFF) ||
+        ((uint8_t)(seq - newest_seq) && ((uint8_t)(seq - newest_seq) < 0x80))) {
+      newest_slot = slot;
+      newest_seq = seq;
+    }
+  }
+  if (newest_slot == 0xFF) { return(0); }
+
+  base = EEPROM_ADDR_POSITION + newest_slot*POSITION_CHECKPOINT_SIZE;
+  for (idx = 0; idx < sizeof(int32_t)*N_AXIS; idx++) {
+    ((uint8_t *)position)[idx] = eeprom_get_char(base + 1 + idx);
+  }
+  // Ghi tiếp từ chỗ ring đang đứng - không lãng phí slot, wear đều
+  checkpoint_seq = newest_seq;
+  checkpoint_slot = newest_slot;
+  memcpy(checkpoint_saved, position, sizeof(checkpoint_saved));
+  checkpoint_gate_ok = 1;
+  return(1);
+}
+#endif // POSITION_CHECKPOINT
+
+
 // Lưu startup lines vào EEPROM
 void settings_store_startup_line(uint8_t n, char *line)
 {
@@ -78,7 +270,11 @@ void settings_restore(uint8_t restore_flag) {
 	settings.acceleration[Z_AXIS] = DEFAULT_Z_ACCELERATION;
 	settings.max_travel[X_AXIS] = (-DEFAULT_X_MAX_TRAVEL);
 	settings.max_travel[Y_AXIS] = (-DEFAULT_Y_MAX_TRAVEL);
-	settings.max_travel[Z_AXIS] = (-DEFAULT_Z_MAX_TRAVEL);    
+	settings.max_travel[Z_AXIS] = (-DEFAULT_Z_MAX_TRAVEL);
+
+	settings.i2c_fast_mode = DEFAULT_I2C_FAST_MODE;
+	settings.tof_profile = DEFAULT_TOF_PROFILE;
+	settings.tof_filter_window = DEFAULT_TOF_FILTER_WINDOW;
 
 	write_global_settings();
   }
@@ -253,11 +449,25 @@ uint8_t settings_store_global_setting(uint8_t parameter, float value) {
       case 25: settings.homing_seek_rate = value; break;
       case 26: settings.homing_debounce_delay = int_value; break;
       case 27: settings.homing_pulloff = value; break;
-      default: 
+      case 30: // Tốc độ bus I2C - áp dụng ngay, sensor giữ nguyên cấu hình
+        settings.i2c_fast_mode = (int_value) ? 1 : 0;
+        i2c_set_speed(settings.i2c_fast_mode);
+        break;
+      case 31: // Ranging profile - áp dụng khi reset hoặc qua lệnh VL53L0X_PROFILE=n
+        if (int_value > VL53L0X_PROFILE_LONG_RANGE) { return(STATUS_INVALID_STATEMENT); }
+        settings.tof_profile = int_value;
+        break;
+      case 32: // Filter window cho READ_VL53L0X_F - số sample lấy median
+        if ((int_value < 1) || (int_value > VL53L0X_FILTER_MAX_SAMPLES)) { return(STATUS_INVALID_STATEMENT); }
+        settings.tof_filter_window = int_value;
+        break;
+      default:
         return(STATUS_INVALID_STATEMENT);
     }
   }
-  write_global_settings();
+  // Chỉ đánh dấu dirty - mọi chỗ đọc đều dùng struct RAM nên thay đổi có hiệu
+  // lực ngay; EEPROM được nhỏ giọt từ main loop, `$x=val` trả "ok" tức thì
+  settings_flush_mark();
   return(STATUS_OK);
 }
 
@@ -20,7 +20,7 @@
 // Phiên bản dữ liệu EEPROM - dùng để migrate từ phiên bản cũ
 // Luôn lưu ở byte 0 của EEPROM
 // LƯU Ý: Kiểm tra settings_reset() khi chuyển sang phiên bản mới
-#define SETTINGS_VERSION 9
+#define SETTINGS_VERSION 12
 
 // Định nghĩa bit flag masks cho boolean settings trong settings.flag
 #define BITFLAG_REPORT_INCHES      bit(0) // Báo cáo theo inch
@@ -38,6 +38,7 @@
 #define BITFLAG_RT_STATUS_PLANNER_BUFFER    bit(2)
 #define BITFLAG_RT_STATUS_SERIAL_RX         bit(3)
 #define BITFLAG_RT_STATUS_LIMIT_PINS        bit(4)
+#define BITFLAG_RT_STATUS_STEP_POSITION     bit(5) // Báo step count int32 thô thay cho MPos/WPos float
 
 // Define settings restore bitflags.
 #define SETTINGS_RESTORE_ALL 0xFF // All bitflags
@@ -55,6 +56,14 @@
 #define EEPROM_ADDR_STARTUP_BLOCK  768U
 #define EEPROM_ADDR_BUILD_INFO     942U
 
+// Ring checkpoint vị trí máy (POSITION_CHECKPOINT) - nằm trong khoảng trống
+// giữa coordinate data (hết ~604) và startup block (768): 8 slot x 14 byte
+// (seq + 3 x int32 + checksum) = 112 byte, cộng 1 byte cổng hợp lệ ở cuối
+#define EEPROM_ADDR_POSITION       640U
+#define POSITION_CHECKPOINT_SLOTS  8
+#define POSITION_CHECKPOINT_SIZE   (2 + sizeof(int32_t)*N_AXIS) // seq + pos + checksum
+#define EEPROM_ADDR_POSITION_VALID (EEPROM_ADDR_POSITION + POSITION_CHECKPOINT_SLOTS*POSITION_CHECKPOINT_SIZE)
+
 // Define EEPROM address indexing for coordinate parameters
 #define N_COORDINATE_SYSTEM 6  // Number of supported work coordinate systems (from index 1)
 #define SETTING_INDEX_NCOORD N_COORDINATE_SYSTEM+1 // Total number of system stored (from index 0)
@@ -92,6 +101,11 @@ typedef struct {
   float homing_seek_rate;
   uint16_t homing_debounce_delay;
   float homing_pulloff;
+
+  // Cài đặt scanner
+  uint8_t i2c_fast_mode; // $30: 0 = 100kHz standard, 1 = 400kHz fast mode
+  uint8_t tof_profile;   // $31: ranging profile (0=balanced, 1=high speed, 2=long range)
+  uint8_t tof_filter_window; // $32: số sample cho filtered read (1..VL53L0X_FILTER_MAX_SAMPLES)
 } settings_t;
 extern settings_t settings;
 
@@ -104,6 +118,20 @@ void settings_restore(uint8_t restore_flag);
 // A helper method to set new settings from command line
 uint8_t settings_store_global_setting(uint8_t parameter, float value);
 
+// Flush settings nền: `$x=val` chỉ sửa struct RAM và đánh dấu dirty, journal
+// nhỏ giọt từng byte xuống EEPROM từ slot rảnh của main loop (xem settings.c)
+void settings_flush_mark(); // Đánh dấu struct RAM đã thay đổi
+void settings_flush_step(); // Ghi tối đa một byte, không bao giờ chờ EEPROM
+void settings_flush_sync(); // Flush đồng bộ cho hết - gọi trước khi reset
+
+#ifdef POSITION_CHECKPOINT
+  // Checkpoint vị trí máy: ring EEPROM chống mòn, ghi nhỏ giọt khi IDLE và
+  // nạp lại lúc boot để bỏ qua homing đầu phiên (xem settings.c)
+  void settings_checkpoint_step();       // Gọi từ slot rảnh của main loop
+  void settings_checkpoint_invalidate(); // Vị trí không còn tin được (mất bước)
+  uint8_t settings_read_position_checkpoint(int32_t *position); // Boot: 1 = nạp được
+#endif
+
 // Stores the protocol line variable as a startup line in EEPROM
 void settings_store_startup_line(uint8_t n, char *line);
 
@@ -14,6 +14,8 @@
 
 #include "grbl.h"
 
+#ifndef SCANNER_BUILD // Máy scan không có spindle - header cung cấp stub no-op
+
 // Khởi tạo spindle
 void spindle_init()
 {
@@ -129,6 +131,8 @@ void spindle_set_state(uint8_t state, float rpm)
 void spindle_run(uint8_t state, float rpm)
 {
   if (sys.state == STATE_CHECK_MODE) { return; }
-  protocol_buffer_synchronize(); // Empty planner buffer to ensure spindle is set when programmed.  
+  protocol_buffer_synchronize(); // Empty planner buffer to ensure spindle is set when programmed.
   spindle_set_state(state, rpm);
 }
+
+#endif // SCANNER_BUILD
@@ -13,7 +13,19 @@
 */ 
 
 #ifndef spindle_control_h
-#define spindle_control_h 
+#define spindle_control_h
+
+#ifdef SCANNER_BUILD
+
+// Máy scan không có spindle - M3/M4/M5 thành no-op, spindle_control.c bị
+// loại khỏi build (xem SCANNER_BUILD trong config.h). Bỏ spindle cũng giải
+// phóng Timer2 output compare cho timebase micros (xem micros.c)
+#define spindle_init()
+#define spindle_run(direction, rpm)
+#define spindle_set_state(state, rpm)
+#define spindle_stop()
+
+#else
 
 // Khởi tạo spindle pins và hardware PWM (nếu bật)
 void spindle_init();
@@ -27,4 +39,6 @@ void spindle_set_state(uint8_t state, float rpm);
 // Dừng spindle
 void spindle_stop();
 
+#endif // SCANNER_BUILD
+
 #endif
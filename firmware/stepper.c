@@ -27,10 +27,21 @@
 // Level 0 (không AMASS) bắt đầu từ cutoff frequency của Level 1
 // LƯU Ý: Cutoff frequency * ISR overdrive factor không được vượt quá max step frequency
 // Cài đặt hiện tại: overdrive ISR tối đa 16kHz để cân bằng CPU overhead và độ chính xác timer
-#define MAX_AMASS_LEVEL 3
+//
+// AMASS_32KHZ_OVERDRIVE (bật per cpu_map, xem cpu_map_atmega2560.h): vùng
+// chậm nhất (< 2kHz step) lên Level 4 - overdrive x16, ISR tối đa 32kHz.
+// Bàn quay chạy F1 rơi trọn vào vùng này và với x8 chuyển động bị lượng tử
+// hóa thấy rõ, phải chờ settle trước mỗi lần đo; x16 nhân đôi độ phân giải
+// làm mượt để lấy mẫu được ngay trong lúc quay. ISR 32kHz chỉ gánh nổi trên
+// MCU còn dư headroom - không bật cho 328p.
+#ifdef AMASS_32KHZ_OVERDRIVE
+  #define MAX_AMASS_LEVEL 4
+#else
+  #define MAX_AMASS_LEVEL 3
+#endif
 #define AMASS_LEVEL1 (F_CPU/8000) // Overdrive ISR x2
 #define AMASS_LEVEL2 (F_CPU/4000) // Overdrive ISR x4
-#define AMASS_LEVEL3 (F_CPU/2000) // Overdrive ISR x8
+#define AMASS_LEVEL3 (F_CPU/2000) // Overdrive ISR x8 (x16 khi AMASS_32KHZ_OVERDRIVE)
 
 
 // Stores the planner block Bresenham algorithm execution data for the segments in the segment 
@@ -123,6 +134,21 @@ typedef struct {
   float exit_speed;       // Exit speed of executing block (mm/min)
   float accelerate_until; // Acceleration ramp end measured from end of block (mm)
   float decelerate_after; // Deceleration ramp start measured from end of block (mm)
+
+  // Cache segment cruise: trong pha cruise tốc độ không đổi nên inv_rate,
+  // cycles_per_tick và AMASS level của mọi segment trọn-cruise giống hệt
+  // nhau - tính một lần rồi dùng lại, bỏ được phép chia float + ceil() mỗi
+  // segment (hàng trăm cycle AVR mỗi phép trên 16MHz). Move scan dài cruise
+  // >99% thời gian nên gần như toàn bộ prep chạy qua cache này. Cache bị vô
+  // hiệu mỗi lần nạp/replan block (profile tốc độ đổi).
+  uint8_t cruise_cache_valid;
+  float cruise_inv_rate;          // Nghịch đảo step rate cruise (min/step)
+  uint16_t cruise_cycles_per_tick;
+  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    uint8_t cruise_amass_level;
+  #else
+    uint8_t cruise_prescaler;
+  #endif
 } st_prep_t;
 static st_prep_t prep;
 
@@ -270,7 +296,14 @@ ISR(TIMER1_COMPA_vect)
 {        
 // SPINDLE_ENABLE_PORT ^= 1<<SPINDLE_ENABLE_BIT; // Debug: Used to time ISR
   if (busy) { return; } // The busy-flag is used to avoid reentering this interrupt
-  
+
+  #ifdef STEPPER_ISR_PROFILE
+    // TCNT1 chạy prescaler 1 khi AMASS bật - đọc thẳng ra chu kỳ CPU.
+    // Đo từ đây tới cuối ISR; ngắt lồng (Timer0 reset, serial) tính vào
+    // duration vì chúng cũng là tải thật mà tick stepper phải gánh.
+    uint16_t profile_entry = TCNT1;
+  #endif
+
   // Set the direction pins a couple of nanoseconds before we step the steppers
   DIRECTION_PORT = (DIRECTION_PORT & ~DIRECTION_MASK) | (st.dir_outbits & DIRECTION_MASK);
 
@@ -383,7 +416,20 @@ ISR(TIMER1_COMPA_vect)
     if ( ++segment_buffer_tail == SEGMENT_BUFFER_SIZE) { segment_buffer_tail = 0; }
   }
 
-  st.step_outbits ^= step_port_invert_mask;  // Apply step port invert mask    
+  st.step_outbits ^= step_port_invert_mask;  // Apply step port invert mask
+
+  #ifdef STEPPER_ISR_PROFILE
+    // CTC reset TCNT1 tại OCR1A - nếu đã wrap (ISR dài hơn một tick: chính là
+    // trường hợp overrun cần bắt) cộng lại chu kỳ của tick để ra duration thật
+    uint16_t profile_exit = TCNT1;
+    uint16_t profile_cycles;
+    if (profile_exit >= profile_entry) { profile_cycles = profile_exit - profile_entry; }
+    else { profile_cycles = (OCR1A - profile_entry) + profile_exit + 1; }
+    if (profile_cycles > sys_profile.isr_max_cycles) { sys_profile.isr_max_cycles = profile_cycles; }
+    sys_profile.isr_total_cycles += profile_cycles;
+    sys_profile.isr_ticks++;
+  #endif
+
   busy = false;
 // SPINDLE_ENABLE_PORT ^= 1<<SPINDLE_ENABLE_BIT; // Debug: Used to time ISR
 }
@@ -509,8 +555,17 @@ void st_update_plan_block_parameters()
 */
 void st_prep_buffer()
 {
+  // Latch mực nước hai buffer TRƯỚC khi nạp thêm - mức đo tại đây là mức
+  // drain thật mà ISR nhìn thấy giữa hai lượt nạp của main loop
+  if (sys.state == STATE_CYCLE) {
+    uint8_t segment_count;
+    uint8_t tail = segment_buffer_tail; // volatile - chốt một lần
+    if (segment_buffer_head >= tail) { segment_count = segment_buffer_head - tail; }
+    else { segment_count = SEGMENT_BUFFER_SIZE - (tail - segment_buffer_head); }
+    system_profile_buffers(segment_count, plan_get_block_buffer_count());
+  }
 
-  if (sys.state & (STATE_HOLD|STATE_MOTION_CANCEL|STATE_SAFETY_DOOR)) { 
+  if (sys.state & (STATE_HOLD|STATE_MOTION_CANCEL|STATE_SAFETY_DOOR)) {
     // Check if we still need to generate more segments for a motion suspend.
     if (prep.current_speed == 0.0) { return; } // Nothing to do. Bail.
   }
@@ -572,6 +627,7 @@ void st_prep_buffer()
          hold, override the planner velocities and decelerate to the target exit speed.
       */
       prep.mm_complete = 0.0; // Default velocity profile complete at 0.0mm from end of block.
+      prep.cruise_cache_valid = false; // Profile mới/replan - rate cruise cũ hết giá trị
       float inv_2_accel = 0.5/pl_block->acceleration;
       if (sys.state & (STATE_HOLD|STATE_MOTION_CANCEL|STATE_SAFETY_DOOR)) { // [Forced Deceleration to Zero Velocity]
         // Compute velocity profile parameters for a feed hold in-progress. This profile overrides
@@ -653,6 +709,9 @@ void st_prep_buffer()
     float mm_remaining = pl_block->millimeters; // New segment distance from end of block.
     float minimum_mm = mm_remaining-prep.req_mm_increment; // Guarantee at least one step.
     if (minimum_mm < 0.0) { minimum_mm = 0.0; }
+    // Segment bắt đầu trong pha cruise - nếu kết thúc vẫn cruise và không bị
+    // kéo dài thời gian thì rate giống hệt segment cruise trước (xem cache)
+    uint8_t segment_cruise_only = (prep.ramp_type == RAMP_CRUISE);
 
     do {
       switch (prep.ramp_type) {
@@ -714,7 +773,12 @@ void st_prep_buffer()
       }
     } while (mm_remaining > prep.mm_complete); // **Complete** Exit loop. Profile complete.
 
-   
+    // Xác nhận segment trọn-cruise: vẫn đang cruise sau vòng lặp (không chạm
+    // junction giảm tốc/cuối block) và thời gian không bị kéo dài vì thiếu step
+    segment_cruise_only = segment_cruise_only &&
+                          (prep.ramp_type == RAMP_CRUISE) && (dt_max == DT_SEGMENT);
+
+
     /* -----------------------------------------------------------------------------------
        Compute segment step rate, steps to execute, and apply necessary rate corrections.
        NOTE: Steps are computed by direct scalar conversion of the millimeter distance 
@@ -753,26 +817,41 @@ void st_prep_buffer()
     // typically very small and do not adversely effect performance, but ensures that Grbl
     // outputs the exact acceleration and velocity profiles as computed by the planner.
     dt += prep.dt_remainder; // Apply previous segment partial step execute time
+
+    if (segment_cruise_only && prep.cruise_cache_valid) {
+      // Segment trọn trong pha cruise - rate y hệt segment cruise trước, dùng
+      // lại kết quả cache: chỉ còn một phép nhân cho bù partial step, bỏ phép
+      // chia inv_rate + ceil() + phân nhánh AMASS của đường tính đầy đủ
+      prep.dt_remainder = (n_steps_remaining - steps_remaining)*prep.cruise_inv_rate;
+      prep_segment->cycles_per_tick = prep.cruise_cycles_per_tick;
+      #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+        prep_segment->amass_level = prep.cruise_amass_level;
+        prep_segment->n_step <<= prep.cruise_amass_level;
+      #else
+        prep_segment->prescaler = prep.cruise_prescaler;
+      #endif
+    } else {
+
     float inv_rate = dt/(last_n_steps_remaining - steps_remaining); // Compute adjusted step rate inverse
     prep.dt_remainder = (n_steps_remaining - steps_remaining)*inv_rate; // Update segment partial step time
 
     // Compute CPU cycles per step for the prepped segment.
-    uint32_t cycles = ceil( (TICKS_PER_MICROSECOND*1000000*60)*inv_rate ); // (cycles/step)    
+    uint32_t cycles = ceil( (TICKS_PER_MICROSECOND*1000000*60)*inv_rate ); // (cycles/step)
 
-    #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING        
+    #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
       // Compute step timing and multi-axis smoothing level.
       // NOTE: AMASS overdrives the timer with each level, so only one prescalar is required.
       if (cycles < AMASS_LEVEL1) { prep_segment->amass_level = 0; }
       else {
         if (cycles < AMASS_LEVEL2) { prep_segment->amass_level = 1; }
         else if (cycles < AMASS_LEVEL3) { prep_segment->amass_level = 2; }
-        else { prep_segment->amass_level = 3; }    
-        cycles >>= prep_segment->amass_level; 
+        else { prep_segment->amass_level = MAX_AMASS_LEVEL; } // 3, hoặc 4 khi overdrive 32kHz
+        cycles >>= prep_segment->amass_level;
         prep_segment->n_step <<= prep_segment->amass_level;
       }
       if (cycles < (1UL << 16)) { prep_segment->cycles_per_tick = cycles; } // < 65536 (4.1ms @ 16MHz)
       else { prep_segment->cycles_per_tick = 0xffff; } // Just set the slowest speed possible.
-    #else 
+    #else
       // Compute step timing and timer prescalar for normal step generation.
       if (cycles < (1UL << 16)) { // < 65536  (4.1ms @ 16MHz)
         prep_segment->prescaler = 1; // prescaler: 0
@@ -780,7 +859,7 @@ void st_prep_buffer()
       } else if (cycles < (1UL << 19)) { // < 524288 (32.8ms@16MHz)
         prep_segment->prescaler = 2; // prescaler: 8
         prep_segment->cycles_per_tick = cycles >> 3;
-      } else { 
+      } else {
         prep_segment->prescaler = 3; // prescaler: 64
         if (cycles < (1UL << 22)) { // < 4194304 (262ms@16MHz)
           prep_segment->cycles_per_tick =  cycles >> 6;
@@ -790,6 +869,20 @@ void st_prep_buffer()
       }
     #endif
 
+    if (segment_cruise_only) {
+      // Segment cruise đầu tiên với profile này - ghi cache cho các segment sau
+      prep.cruise_inv_rate = inv_rate;
+      prep.cruise_cycles_per_tick = prep_segment->cycles_per_tick;
+      #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+        prep.cruise_amass_level = prep_segment->amass_level;
+      #else
+        prep.cruise_prescaler = prep_segment->prescaler;
+      #endif
+      prep.cruise_cache_valid = true;
+    }
+
+    } // Hết nhánh tính rate đầy đủ
+
     // Segment complete! Increment segment buffer indices.
     segment_buffer_head = segment_next_head;
     if ( ++segment_next_head == SEGMENT_BUFFER_SIZE ) { segment_next_head = 0; }
@@ -14,9 +14,13 @@
 
 #include "grbl.h"
 
+// Hồ sơ tải hệ thống cho lệnh $P (xem system_profile_t trong system.h)
+volatile system_profile_t sys_profile;
+
 // Khởi tạo hệ thống - cấu hình control pins và interrupts
-void system_init() 
+void system_init()
 {
+  system_clear_profile();
   CONTROL_DDR &= ~(CONTROL_MASK); // Cấu hình làm input pins
   #ifdef DISABLE_CONTROL_PIN_PULL_UP
     CONTROL_PORT &= ~(CONTROL_MASK); // Normal low - cần pull-down ngoài
@@ -30,8 +34,11 @@ void system_init()
 // Interrupt khi control pins thay đổi (cycle start, feed hold, reset)
 // Thiết lập biến realtime command execute để chương trình chính thực thi khi sẵn sàng
 // Hoạt động giống như real-time commands từ serial stream
-ISR(CONTROL_INT_vect) 
+ISR(CONTROL_INT_vect)
 {
+  #ifdef VL53L0X_GPIO1_INTERRUPT
+    vl53l0x_gpio1_isr(); // GPIO1 data-ready của sensor chia sẻ vector này
+  #endif
   uint8_t pin = (CONTROL_PIN & CONTROL_MASK);
   #ifndef INVERT_ALL_CONTROL_PINS
     pin ^= CONTROL_INVERT_MASK; // Đảo ngược nếu cần
@@ -54,6 +61,100 @@ ISR(CONTROL_INT_vect)
 }
 
 
+// Xóa hồ sơ tải: duration về 0, mực nước buffer về trần (0xFF = "chưa thấy
+// cycle nào") để lần latch đầu tiên luôn thắng phép so sánh min
+void system_clear_profile()
+{
+  uint8_t sreg = SREG;
+  cli(); // ISR stepper cập nhật các field duration
+  sys_profile.isr_max_cycles = 0;
+  sys_profile.isr_total_cycles = 0;
+  sys_profile.isr_ticks = 0;
+  sys_profile.segment_min = 0xFF;
+  sys_profile.plan_min = 0xFF;
+  SREG = sreg;
+}
+
+
+// Latch mực nước thấp nhất của hai buffer trong lúc cycle - gọi từ
+// st_prep_buffer (main context) nên không cần che interrupt
+void system_profile_buffers(uint8_t segment_count, uint8_t plan_count)
+{
+  if (segment_count < sys_profile.segment_min) { sys_profile.segment_min = segment_count; }
+  if (plan_count < sys_profile.plan_min) { sys_profile.plan_min = plan_count; }
+}
+
+
+// Copy snapshot nguyên tử (ISR đang ghi các counter 32-bit) rồi mở cửa sổ đo
+// mới - mỗi lần $P đọc là số liệu từ lần $P trước, không tích lũy vô hạn
+// (isr_total_cycles tràn uint32 sau ~12 phút ISR 30kHz nếu không xóa)
+void system_get_profile(system_profile_t *snapshot)
+{
+  uint8_t sreg = SREG;
+  cli();
+  memcpy(snapshot, (void *)&sys_profile, sizeof(system_profile_t));
+  SREG = sreg;
+  system_clear_profile();
+}
+
+
+#ifdef WATCHDOG_SUPERVISION
+// Stash pre-reset - .noinit để C runtime không xóa khi boot lại sau watchdog reset
+system_wdt_stash_t sys_wdt_stash __attribute__ ((section (".noinit")));
+
+// Checksum stash: tổng byte của mọi field trừ chính byte checksum
+static uint8_t system_wdt_checksum()
+{
+  uint8_t sum = 0;
+  uint8_t idx;
+  for (idx = 0; idx < (sizeof(system_wdt_stash_t)-1); idx++) {
+    sum += ((uint8_t *)&sys_wdt_stash)[idx];
+  }
+  return(sum);
+}
+
+// Bật watchdog 2s ở chế độ interrupt + reset: timeout đầu chạy WDT_vect
+// (stash trạng thái), WDIE tự hạ nên timeout thứ hai reset MCU thật
+void system_wdt_init()
+{
+  uint8_t sreg = SREG;
+  cli();
+  wdt_reset();
+  WDTCSR = (1<<WDCE) | (1<<WDE); // Mở cửa sổ thay đổi cấu hình
+  WDTCSR = (1<<WDIE) | (1<<WDE) | (1<<WDP2) | (1<<WDP1) | (1<<WDP0); // 2s
+  SREG = sreg;
+}
+
+// Timeout đầu tiên: main loop đã chết (protocol_execute_realtime không pet
+// trong 2s) - chép trạng thái cho phiên sau rồi để timeout kế reset MCU.
+// Máy treo nghĩa là stepper đã đứng yên nên sys.position đọc ở đây chính xác
+ISR(WDT_vect)
+{
+  uint8_t idx;
+  for (idx = 0; idx < N_AXIS; idx++) { sys_wdt_stash.position[idx] = sys.position[idx]; }
+  sys_wdt_stash.scan_points_done = protocol_scan_points_done;
+  sys_wdt_stash.scan_active = protocol_scan_active;
+  sys_wdt_stash.magic = WDT_STASH_MAGIC;
+  sys_wdt_stash.checksum = system_wdt_checksum();
+}
+
+// Boot: reset vừa rồi do watchdog và stash hợp lệ thì nạp lại vị trí máy.
+// Magic bị xóa sau khi dùng - stash là thông tin một lần; reset thường
+// (power-on, ctrl-x) cũng xóa để rác .noinit cũ không bao giờ được tin
+uint8_t system_wdt_restore(uint8_t mcusr, int32_t *position)
+{
+  uint8_t valid = (mcusr & (1<<WDRF)) &&
+                  (sys_wdt_stash.magic == WDT_STASH_MAGIC) &&
+                  (sys_wdt_stash.checksum == system_wdt_checksum());
+  sys_wdt_stash.magic = 0;
+  if (!valid) { return(0); }
+  uint8_t idx;
+  for (idx = 0; idx < N_AXIS; idx++) { position[idx] = sys_wdt_stash.position[idx]; }
+  return(1);
+}
+#endif // WATCHDOG_SUPERVISION
+
+
 // Returns if safety door is ajar(T) or closed(F), based on pin state.
 uint8_t system_check_safety_door_ajar()
 {
@@ -101,9 +202,23 @@ uint8_t system_execute_line(char *line)
   float parameter, value;
   switch( line[char_counter] ) {
     case 0 : report_grbl_help(); break;
-    case '$': case 'G': case 'C': case 'X':
+    case '$': case 'G': case 'C': case 'X': case 'D': case 'P':
+    #ifdef VL53L0X_CAL_LUT
+    case 'T':
+    #endif
       if ( line[(char_counter+1)] != 0 ) { return(STATUS_INVALID_STATEMENT); }
       switch( line[char_counter] ) {
+        #ifdef VL53L0X_CAL_LUT
+          case 'T' : // In bảng hiệu chuẩn khoảng cách VL53L0X (PROGMEM)
+            report_tof_cal_table();
+            break;
+        #endif
+        case 'D' : // In chẩn đoán serial: peak buffer, byte drop, flow control
+          report_serial_diagnostics();
+          break;
+        case 'P' : // In hồ sơ tải: ISR max/avg, mực nước thấp nhất hai buffer
+          report_profile_diagnostics();
+          break;
         case '$' : // Prints Grbl settings
           if ( sys.state & (STATE_CYCLE | STATE_HOLD) ) { return(STATUS_IDLE_ERROR); } // Block during cycle. Takes too long to print.
           else { report_grbl_settings(); }
@@ -156,6 +271,25 @@ uint8_t system_execute_line(char *line)
       // Block any system command that requires the state as IDLE/ALARM. (i.e. EEPROM, homing)
       if ( !(sys.state == STATE_IDLE || sys.state == STATE_ALARM) ) { return(STATUS_IDLE_ERROR); }
       switch( line[char_counter] ) {
+        case 'B' : // Chế độ telemetry [$B=0/1/2]: ASCII / binary / binary + delta burst
+          // Không lưu EEPROM - GUI negotiate lại mỗi session, boot luôn về ASCII
+          if (line[++char_counter] != '=') { return(STATUS_INVALID_STATEMENT); }
+          if ((line[char_counter+2] != 0) ||
+              ((line[char_counter+1] < '0') || (line[char_counter+1] > '2'))) { return(STATUS_INVALID_STATEMENT); }
+          telemetry_binary_mode = line[char_counter+1] - '0';
+          break;
+        case 'S' : // Chu kỳ auto-push status report [$S=<ms>, 0 = tắt]
+          // Không lưu EEPROM - giống $B, GUI negotiate lại mỗi session và '?'
+          // thủ công vẫn hoạt động song song
+          if (line[++char_counter] != '=') { return(STATUS_INVALID_STATEMENT); }
+          char_counter++;
+          if (!read_float(line, &char_counter, &value)) { return(STATUS_BAD_NUMBER_FORMAT); }
+          if (line[char_counter] != 0) { return(STATUS_INVALID_STATEMENT); }
+          if (value < 0.0) { return(STATUS_NEGATIVE_VALUE); }
+          if (value > 65535.0) { return(STATUS_INVALID_STATEMENT); }
+          if ((value != 0.0) && (value < REPORT_PUSH_MIN_INTERVAL_MS)) { value = REPORT_PUSH_MIN_INTERVAL_MS; }
+          report_push_set_interval((uint16_t)value);
+          break;
         case '#' : // Print Grbl NGC parameters
           if ( line[++char_counter] != 0 ) { return(STATUS_INVALID_STATEMENT); }
           else { report_ngc_parameters(); }
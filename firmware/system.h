@@ -32,6 +32,7 @@
 #define EXEC_ALARM_ABORT_CYCLE  bit(3) // Alarm hủy chu trình (bitmask 00001000)
 #define EXEC_ALARM_PROBE_FAIL   bit(4) // Alarm lỗi đầu dò (bitmask 00010000)
 #define EXEC_ALARM_HOMING_FAIL  bit(5) // Alarm lỗi homing (bitmask 00100000)
+#define EXEC_ALARM_RX_OVERFLOW  bit(6) // Alarm tràn buffer RX - mất byte g-code (bitmask 01000000)
 
 // Bit map trạng thái hệ thống
 #define STATE_IDLE          0      // Trạng thái idle (phải là 0)
@@ -71,6 +72,35 @@ volatile uint8_t sys_probe_state;   // Probing state value.  Used to coordinate
 volatile uint8_t sys_rt_exec_state;  // Global realtime executor bitflag variable for state management. See EXEC bitmasks.
 volatile uint8_t sys_rt_exec_alarm;  // Global realtime executor bitflag variable for setting various alarms.
 
+// Hồ sơ tải hệ thống cho lệnh $P - trả lời "tại sao scan khựng": ISR stepper
+// quá dài, segment buffer cạn, hay planner buffer rỗng? ISR cập nhật phần
+// duration, st_prep_buffer latch mực nước buffer qua system_profile_buffers().
+// Đọc snapshot bằng system_get_profile() - xóa về cửa sổ đo mới sau mỗi $P.
+typedef struct {
+  uint16_t isr_max_cycles;   // ISR Timer1 dài nhất đã thấy (chu kỳ CPU)
+  uint32_t isr_total_cycles; // Tổng chu kỳ trong ISR - chia isr_ticks ra avg
+  uint32_t isr_ticks;        // Số lần ISR chạy trọn (không tính early-return)
+  uint8_t segment_min;       // Mực thấp nhất segment buffer khi đang CYCLE
+  uint8_t plan_min;          // Mực thấp nhất planner buffer khi đang CYCLE
+} system_profile_t;
+extern volatile system_profile_t sys_profile;
+
+#ifdef WATCHDOG_SUPERVISION
+// Stash pre-reset của watchdog: ISR WDT_vect (lần timeout đầu) chép vị trí và
+// tiến độ scan vào đây, nằm trong section .noinit nên sống qua watchdog reset
+// (mất khi rút nguồn - đúng ý: power cycle là phiên mới thật). Boot sau xác
+// thực magic + checksum rồi phát "[WDT_RESUME:...]" cho host.
+#define WDT_STASH_MAGIC 0xC0DEFEEDUL
+typedef struct {
+  uint32_t magic;            // WDT_STASH_MAGIC khi stash hợp lệ
+  int32_t position[N_AXIS];  // sys.position lúc treo (máy đứng yên - chính xác)
+  uint16_t scan_points_done; // Điểm đã phát xong của scan cycle đang chạy
+  uint8_t scan_active;       // 1 nếu treo giữa một scan cycle
+  uint8_t checksum;          // Tổng byte của các field trên
+} system_wdt_stash_t;
+extern system_wdt_stash_t sys_wdt_stash;
+#endif
+
 
 // Initialize the serial protocol
 void system_init();
@@ -81,6 +111,24 @@ uint8_t system_check_safety_door_ajar();
 // Executes an internal system command, defined as a string starting with a '$'
 uint8_t system_execute_line(char *line);
 
+// Xóa hồ sơ tải về trạng thái ban đầu (mở cửa sổ đo mới)
+void system_clear_profile();
+
+// Latch mực nước buffer vào hồ sơ tải - gọi từ st_prep_buffer khi CYCLE
+void system_profile_buffers(uint8_t segment_count, uint8_t plan_count);
+
+// Copy nguyên tử hồ sơ tải (ISR đang cập nhật) rồi xóa về cửa sổ đo mới
+void system_get_profile(system_profile_t *snapshot);
+
+#ifdef WATCHDOG_SUPERVISION
+  // Bật giám sát watchdog 2s (interrupt + reset) - pet trong protocol_execute_realtime
+  void system_wdt_init();
+
+  // Boot: xác thực stash nếu reset vừa rồi do watchdog, nạp vị trí đã lưu vào
+  // position. Trả 1 nếu nạp được - caller báo host và bỏ qua homing đầu phiên
+  uint8_t system_wdt_restore(uint8_t mcusr, int32_t *position);
+#endif
+
 // Execute the startup script lines stored in EEPROM upon initialization
 void system_execute_startup(char *line);
 
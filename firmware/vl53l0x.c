@@ -1,7 +1,7 @@
 /*
   vl53l0x.c - Implementation driver sensor VL53L0X
   Dựa trên code C thuần từ VL53L0X_Basic_C.ino
-  
+
   Part of Grbl
   Copyright (c) 2024
 */
@@ -14,6 +14,105 @@
 static uint8_t vl53l0x_timeout_flag = 0;
 static uint16_t vl53l0x_io_timeout = 500; // Timeout 500ms
 
+// Trạng thái continuous mode
+static uint8_t vl53l0x_continuous_active = 0;
+
+// Timestamp microsecond của lần đo gần nhất (chốt lúc data-ready, trước khi
+// harvest qua I2C) - host dùng để nội suy góc bàn quay tại thời điểm lấy mẫu
+static uint32_t vl53l0x_last_sample_micros = 0;
+
+// Trường chất lượng của result block lần đo gần nhất - sensor trả 12 byte
+// mỗi lần harvest nhưng trước đây chỉ byte 10-11 (distance) được giữ lại.
+// Status + signal/ambient rate cho host lọc sample xấu thống kê một lượt
+// thay vì re-request điểm nghi ngờ (lệnh READ_VL53L0X_E trong protocol.c)
+static uint8_t vl53l0x_last_range_status = 0;
+static uint16_t vl53l0x_last_signal_rate = 0;  // MCPS, fixed point 9.7
+static uint16_t vl53l0x_last_ambient_rate = 0; // MCPS, fixed point 9.7
+
+#ifdef VL53L0X_GPIO1_INTERRUPT
+  // Flag do pin-change ISR set khi GPIO1 báo có kết quả đo mới
+  static volatile uint8_t vl53l0x_data_ready_flag = 0;
+#endif
+// Giá trị register 0x91 đọc được khi init - cần ghi lại trước mỗi lần start đo
+// (theo sequence của thư viện Pololu)
+static uint8_t vl53l0x_stop_variable = 0;
+
+// Ring buffer cho filtered read - mỗi lần đọc continuous thành công push một
+// sample vào đây, READ_VL53L0X_F lấy median của settings.tof_filter_window
+// sample cuối thay vì GUI phải gọi READ_VL53L0X 3-5 lần rồi average host-side
+static uint16_t vl53l0x_filter_ring[VL53L0X_FILTER_MAX_SAMPLES];
+static uint8_t vl53l0x_filter_head = 0;  // Vị trí ghi tiếp theo
+static uint8_t vl53l0x_filter_count = 0; // Số sample hợp lệ trong ring
+
+#ifdef VL53L0X_CAL_LUT
+// Bảng hiệu chuẩn piecewise-linear trong PROGMEM: {raw_mm, offset_mm}.
+// Offset được nội suy tuyến tính giữa hai breakpoint rồi cộng vào kết quả đo.
+// Breakpoint phải tăng dần. Offset mặc định 0 (identity) - đo target chuẩn ở
+// từng khoảng cách rồi điền sai số (đo được - thực tế, đổi dấu) vào đây.
+static const vl53l0x_cal_entry_t vl53l0x_cal_table[VL53L0X_CAL_POINTS] PROGMEM = {
+  {   50, 0 },
+  {  100, 0 },
+  {  200, 0 },
+  {  400, 0 },
+  {  800, 0 },
+  { 1200, 0 },
+  { 1600, 0 },
+  { 2000, 0 },
+};
+
+// Đọc một entry của bảng hiệu chuẩn (cho lệnh $T trong report.c)
+void vl53l0x_cal_entry(uint8_t idx, uint16_t *raw, int16_t *offset)
+{
+  *raw = pgm_read_word(&vl53l0x_cal_table[idx].raw);
+  *offset = (int16_t)pgm_read_word(&vl53l0x_cal_table[idx].offset);
+}
+
+// Áp dụng hiệu chuẩn cho một kết quả đo thô
+// Ngoài khoảng bảng: dùng offset của breakpoint đầu/cuối (không ngoại suy)
+uint16_t vl53l0x_cal_apply(uint16_t raw)
+{
+  uint8_t i;
+  int16_t offset;
+  int32_t corrected;
+
+  uint16_t r0 = pgm_read_word(&vl53l0x_cal_table[0].raw);
+  uint16_t rn = pgm_read_word(&vl53l0x_cal_table[VL53L0X_CAL_POINTS-1].raw);
+
+  if (raw <= r0) {
+    offset = (int16_t)pgm_read_word(&vl53l0x_cal_table[0].offset);
+  } else if (raw >= rn) {
+    offset = (int16_t)pgm_read_word(&vl53l0x_cal_table[VL53L0X_CAL_POINTS-1].offset);
+  } else {
+    // Tìm đoạn chứa raw rồi nội suy tuyến tính offset
+    for (i = 1; i < VL53L0X_CAL_POINTS; i++) {
+      uint16_t r_hi = pgm_read_word(&vl53l0x_cal_table[i].raw);
+      if (raw <= r_hi) {
+        uint16_t r_lo = pgm_read_word(&vl53l0x_cal_table[i-1].raw);
+        int16_t o_lo = (int16_t)pgm_read_word(&vl53l0x_cal_table[i-1].offset);
+        int16_t o_hi = (int16_t)pgm_read_word(&vl53l0x_cal_table[i].offset);
+        offset = o_lo + (int16_t)(((int32_t)(o_hi - o_lo) * (raw - r_lo)) / (r_hi - r_lo));
+        break;
+      }
+    }
+    if (i >= VL53L0X_CAL_POINTS) { offset = 0; } // Không xảy ra với bảng tăng dần
+  }
+
+  corrected = (int32_t)raw + offset;
+  if (corrected < 1) { corrected = 1; }       // Không trả 0 (0 = error)
+  if (corrected > 8189) { corrected = 8189; } // Không lấn vào 8190 (out of range)
+  return (uint16_t)corrected;
+}
+#endif
+
+// Push một sample vào ring buffer filter
+static void vl53l0x_filter_push(uint16_t distance)
+{
+  vl53l0x_filter_ring[vl53l0x_filter_head] = distance;
+  vl53l0x_filter_head++;
+  if (vl53l0x_filter_head >= VL53L0X_FILTER_MAX_SAMPLES) { vl53l0x_filter_head = 0; }
+  if (vl53l0x_filter_count < VL53L0X_FILTER_MAX_SAMPLES) { vl53l0x_filter_count++; }
+}
+
 // Ghi register (sử dụng I2C functions có sẵn)
 static void vl53_write_reg(uint8_t reg, uint8_t value)
 {
@@ -32,6 +131,25 @@ static void vl53_read_multi(uint8_t reg, uint8_t* buffer, uint8_t len)
   i2c_read_register_multi(VL53L0X_I2C_ADDR, reg, buffer, len);
 }
 
+// Đọc register 16-bit (MSB trước)
+static uint16_t vl53_read_reg16(uint8_t reg)
+{
+  uint8_t buffer[2];
+  vl53_read_multi(reg, buffer, 2);
+  return ((uint16_t)buffer[0] << 8) | buffer[1];
+}
+
+// Ghi register 32-bit (MSB trước)
+static void vl53_write_reg32(uint8_t reg, uint32_t value)
+{
+  uint8_t buffer[4];
+  buffer[0] = (value >> 24) & 0xFF;
+  buffer[1] = (value >> 16) & 0xFF;
+  buffer[2] = (value >> 8) & 0xFF;
+  buffer[3] = value & 0xFF;
+  i2c_write_register_multi(VL53L0X_I2C_ADDR, reg, buffer, 4);
+}
+
 // Set timeout (giống sensor.setTimeout(500))
 void vl53l0x_setTimeout(uint16_t timeout)
 {
@@ -42,94 +160,452 @@ void vl53l0x_setTimeout(uint16_t timeout)
 // Trả về: 1 nếu thành công, 0 nếu lỗi
 uint8_t vl53l0x_init(void)
 {
-  _delay_ms(100);
-  
-  uint8_t model_id = vl53_read_reg(VL53L0X_REG_IDENTIFICATION_MODEL_ID);
-  if (model_id != 0xEE) {
-    return 0; // Sensor không tồn tại
+  // Poll model ID thay cho _delay_ms(100) cứng: sensor trả đúng ID ngay khi
+  // boot xong, nên warm reset (sensor vẫn cấp nguồn từ trước) qua bước này
+  // tức thì; cold boot chỉ chờ đúng thời gian sensor thật sự cần
+  uint16_t boot_timeout = 0;
+  while (vl53_read_reg(VL53L0X_REG_IDENTIFICATION_MODEL_ID) != 0xEE) {
+    if (++boot_timeout >= 100) { return 0; } // Sensor không tồn tại
+    _delay_ms(1);
   }
-  
+
   // Basic init sequence (giống code C thuần)
   vl53_write_reg(0x88, 0x00);
   vl53_write_reg(0x80, 0x01);
   vl53_write_reg(0xFF, 0x01);
   vl53_write_reg(0x00, 0x00);
-  vl53_read_reg(0x91);
+  vl53l0x_stop_variable = vl53_read_reg(0x91); // Lưu lại cho start sequence sau này
   vl53_write_reg(0x00, 0x01);
   vl53_write_reg(0xFF, 0x00);
   vl53_write_reg(0x80, 0x00);
-  
+
+  #ifdef VL53L0X_GPIO1_INTERRUPT
+    // Cấu hình GPIO1 của sensor báo "new sample ready", active low
+    vl53_write_reg(VL53L0X_REG_SYSTEM_INTERRUPT_CONFIG_GPIO, 0x04);
+    vl53_write_reg(VL53L0X_REG_GPIO_HV_MUX_ACTIVE_HIGH,
+                   vl53_read_reg(VL53L0X_REG_GPIO_HV_MUX_ACTIVE_HIGH) & ~0x10);
+    vl53_write_reg(VL53L0X_REG_SYSTEM_INTERRUPT_CLEAR, 0x01);
+
+    // Cấu hình chân MCU: input với pull-up, bật pin-change interrupt
+    // (PCICR đã được system_init() bật cho vector dùng chung với control pins)
+    VL53L0X_GPIO1_DDR &= ~(VL53L0X_GPIO1_MASK);
+    VL53L0X_GPIO1_PORT |= VL53L0X_GPIO1_MASK;
+    VL53L0X_GPIO1_PCMSK |= VL53L0X_GPIO1_MASK;
+    vl53l0x_data_ready_flag = 0;
+  #endif
+
   // Reset timeout flag
   vl53l0x_timeout_flag = 0;
-  
+  vl53l0x_continuous_active = 0;
+
   return 1; // Thành công
 }
 
-// Bắt đầu continuous mode (không cần trong single shot mode, nhưng giữ API)
+#ifdef VL53L0X_GPIO1_INTERRUPT
+// Vị trí step latch tại thời điểm data-ready - cùng pattern với
+// probe_state_monitor() trong probe.c: snapshot sys.position ngay trong ISR
+// để mỗi sample ghép được với đúng step count lúc đo, không cần dừng motor
+static volatile int32_t vl53l0x_latched_position[N_AXIS];
+
+// Gọi từ CONTROL_INT_vect: GPIO1 kéo xuống thấp nghĩa là có kết quả đo mới
+// LƯU Ý: chạy trong ISR context - chỉ set flag và copy vị trí, không I2C
+void vl53l0x_gpio1_isr(void)
+{
+  if (!(VL53L0X_GPIO1_PIN & VL53L0X_GPIO1_MASK)) {
+    if (!vl53l0x_data_ready_flag) { // Chỉ latch lần assert đầu của mỗi sample
+      vl53l0x_latched_position[X_AXIS] = sys.position[X_AXIS];
+      vl53l0x_latched_position[Y_AXIS] = sys.position[Y_AXIS];
+      vl53l0x_latched_position[Z_AXIS] = sys.position[Z_AXIS];
+    }
+    vl53l0x_data_ready_flag = 1;
+  }
+}
+
+// Copy vị trí step đã latch của sample gần nhất (atomic - tắt ngắt khi copy)
+void vl53l0x_getLatchedPosition(int32_t *position)
+{
+  uint8_t idx;
+  uint8_t sreg = SREG;
+  cli();
+  for (idx = 0; idx < N_AXIS; idx++) { position[idx] = vl53l0x_latched_position[idx]; }
+  SREG = sreg;
+}
+#endif
+
+// Kiểm tra có kết quả đo sẵn sàng không (non-blocking)
+uint8_t vl53l0x_dataReady(void)
+{
+  #ifdef VL53L0X_GPIO1_INTERRUPT
+    return vl53l0x_data_ready_flag;
+  #else
+    return ((vl53_read_reg(VL53L0X_REG_RESULT_INTERRUPT_STATUS) & 0x07) != 0);
+  #endif
+}
+
+// Poll thẳng thanh ghi interrupt status qua I2C, bỏ qua flag ISR. Ở chế độ
+// GPIO1, dataReady() chỉ tin flag - sensor hỏng hoặc mất một cạnh ngắt thì
+// flag không bao giờ lên dù sample có thể đã nằm sẵn trong sensor; caller
+// dùng hàm này kiểm tra lần cuối trước khi bỏ cuộc vì timeout.
+uint8_t vl53l0x_dataReadyPoll(void)
+{
+  return ((vl53_read_reg(VL53L0X_REG_RESULT_INTERRUPT_STATUS) & 0x07) != 0);
+}
+
+// ---------------------------------------------------------------------------
+// Timing budget - công thức theo thư viện Pololu (xấp xỉ, đủ cho các profile)
+// ---------------------------------------------------------------------------
+
+// Macro period (ns) cho một VCSEL period tính bằng PCLKs
+static uint32_t vl53_calc_macro_period_ns(uint8_t vcsel_pclks)
+{
+  return ((2304UL * vcsel_pclks * 1655UL) + 500) / 1000;
+}
+
+// Đổi timeout từ macro clocks sang micro giây
+static uint32_t vl53_timeout_mclks_to_us(uint16_t mclks, uint8_t vcsel_pclks)
+{
+  uint32_t macro_period_ns = vl53_calc_macro_period_ns(vcsel_pclks);
+  return ((mclks * macro_period_ns) + (macro_period_ns / 2)) / 1000;
+}
+
+// Đổi timeout từ micro giây sang macro clocks
+static uint32_t vl53_timeout_us_to_mclks(uint32_t us, uint8_t vcsel_pclks)
+{
+  uint32_t macro_period_ns = vl53_calc_macro_period_ns(vcsel_pclks);
+  return ((us * 1000UL) + (macro_period_ns / 2)) / macro_period_ns;
+}
+
+// Format timeout register: (LSByte * 2^MSByte) + 1
+static uint16_t vl53_encode_timeout(uint16_t mclks)
+{
+  uint32_t ls_byte = 0;
+  uint16_t ms_byte = 0;
+  if (mclks == 0) { return 0; }
+  ls_byte = mclks - 1;
+  while ((ls_byte & 0xFFFFFF00) > 0) {
+    ls_byte >>= 1;
+    ms_byte++;
+  }
+  return (ms_byte << 8) | (ls_byte & 0xFF);
+}
+
+static uint16_t vl53_decode_timeout(uint16_t reg_val)
+{
+  return ((uint16_t)(reg_val & 0xFF) << (reg_val >> 8)) + 1;
+}
+
+// Đọc VCSEL period (PCLKs) từ register: giá trị register = (pclks/2)-1
+static uint8_t vl53_get_vcsel_pclks(uint8_t reg)
+{
+  return ((vl53_read_reg(reg) + 1) << 1);
+}
+
+// Đặt measurement timing budget - phần budget không dành cho pre-range và các
+// overhead cố định được cấp hết cho final range timeout
+// Overhead constants theo thư viện Pololu (StartOverhead + EndOverhead +
+// PreRangeOverhead + FinalRangeOverhead)
+#define VL53L0X_BUDGET_OVERHEAD_US 3490UL
+#define VL53L0X_MIN_TIMING_BUDGET_US 20000UL
+
+uint8_t vl53l0x_setMeasurementTimingBudget(uint32_t budget_us)
+{
+  if (budget_us < VL53L0X_MIN_TIMING_BUDGET_US) { return 0; }
+
+  uint8_t pre_pclks = vl53_get_vcsel_pclks(VL53L0X_REG_PRE_RANGE_CONFIG_VCSEL_PERIOD);
+  uint8_t final_pclks = vl53_get_vcsel_pclks(VL53L0X_REG_FINAL_RANGE_CONFIG_VCSEL_PERIOD);
+
+  // Thời gian pre-range hiện tại
+  uint16_t pre_mclks = vl53_decode_timeout(
+      vl53_read_reg16(VL53L0X_REG_PRE_RANGE_CONFIG_TIMEOUT_MACROP_HI));
+  uint32_t pre_us = vl53_timeout_mclks_to_us(pre_mclks, pre_pclks);
+
+  uint32_t used_us = VL53L0X_BUDGET_OVERHEAD_US + pre_us;
+  if (budget_us <= used_us) { return 0; }
+
+  // Final range timeout = phần budget còn lại (cộng thêm pre-range mclks theo datasheet)
+  uint32_t final_mclks = vl53_timeout_us_to_mclks(budget_us - used_us, final_pclks);
+  final_mclks += pre_mclks;
+
+  uint16_t encoded = vl53_encode_timeout((uint16_t)final_mclks);
+  uint8_t buffer[2];
+  buffer[0] = (encoded >> 8) & 0xFF;
+  buffer[1] = encoded & 0xFF;
+  i2c_write_register_multi(VL53L0X_I2C_ADDR,
+      VL53L0X_REG_FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI, buffer, 2);
+  return 1;
+}
+
+// Đặt signal-rate limit (format fixed point 9.7, đơn vị MCPS)
+static void vl53l0x_set_signal_rate_limit_q97(uint16_t limit_q97)
+{
+  uint8_t buffer[2];
+  buffer[0] = (limit_q97 >> 8) & 0xFF;
+  buffer[1] = limit_q97 & 0xFF;
+  i2c_write_register_multi(VL53L0X_I2C_ADDR,
+      VL53L0X_REG_FINAL_RANGE_CONFIG_MIN_COUNT_RATE_RTN_LIMIT, buffer, 2);
+}
+
+// Đặt final range VCSEL period kèm các phase/width register đi cùng
+// (bộ giá trị theo thư viện Pololu setVcselPulsePeriod)
+static void vl53l0x_set_final_vcsel_period(uint8_t pclks)
+{
+  if (pclks == 14) {
+    vl53_write_reg(VL53L0X_REG_FINAL_RANGE_CONFIG_VALID_PHASE_HIGH, 0x48);
+    vl53_write_reg(VL53L0X_REG_GLOBAL_CONFIG_VCSEL_WIDTH, 0x03);
+    vl53_write_reg(VL53L0X_REG_ALGO_PHASECAL_CONFIG_TIMEOUT, 0x07);
+    vl53_write_reg(0xFF, 0x01);
+    vl53_write_reg(VL53L0X_REG_ALGO_PHASECAL_LIM, 0x20);
+    vl53_write_reg(0xFF, 0x00);
+  } else { // 10 PCLKs - mặc định
+    vl53_write_reg(VL53L0X_REG_FINAL_RANGE_CONFIG_VALID_PHASE_HIGH, 0x28);
+    vl53_write_reg(VL53L0X_REG_GLOBAL_CONFIG_VCSEL_WIDTH, 0x03);
+    vl53_write_reg(VL53L0X_REG_ALGO_PHASECAL_CONFIG_TIMEOUT, 0x09);
+    vl53_write_reg(0xFF, 0x01);
+    vl53_write_reg(VL53L0X_REG_ALGO_PHASECAL_LIM, 0x30);
+    vl53_write_reg(0xFF, 0x00);
+  }
+  vl53_write_reg(VL53L0X_REG_FINAL_RANGE_CONFIG_VCSEL_PERIOD, (pclks >> 1) - 1);
+}
+
+// Đặt pre-range VCSEL period kèm phase registers
+static void vl53l0x_set_pre_vcsel_period(uint8_t pclks)
+{
+  if (pclks == 18) {
+    vl53_write_reg(VL53L0X_REG_PRE_RANGE_CONFIG_VALID_PHASE_HIGH, 0x50);
+  } else { // 14 PCLKs - mặc định
+    vl53_write_reg(VL53L0X_REG_PRE_RANGE_CONFIG_VALID_PHASE_HIGH, 0x38);
+  }
+  vl53_write_reg(VL53L0X_REG_PRE_RANGE_CONFIG_VALID_PHASE_LOW, 0x08);
+  vl53_write_reg(VL53L0X_REG_PRE_RANGE_CONFIG_VCSEL_PERIOD, (pclks >> 1) - 1);
+}
+
+// Áp dụng ranging profile - gọi khi sensor không đo
+void vl53l0x_setProfile(uint8_t profile)
+{
+  switch (profile) {
+    case VL53L0X_PROFILE_HIGH_SPEED:
+      // Budget 20ms -> ~50 điểm/giây, VCSEL mặc định
+      vl53l0x_set_pre_vcsel_period(14);
+      vl53l0x_set_final_vcsel_period(10);
+      vl53l0x_set_signal_rate_limit_q97(32); // 0.25 MCPS
+      vl53l0x_setMeasurementTimingBudget(20000);
+      break;
+    case VL53L0X_PROFILE_LONG_RANGE:
+      // VCSEL dài + rate limit thấp -> đo được bề mặt tối/xa hơn
+      vl53l0x_set_pre_vcsel_period(18);
+      vl53l0x_set_final_vcsel_period(14);
+      vl53l0x_set_signal_rate_limit_q97(13); // 0.1 MCPS
+      vl53l0x_setMeasurementTimingBudget(33000);
+      break;
+    default: // VL53L0X_PROFILE_BALANCED
+      vl53l0x_set_pre_vcsel_period(14);
+      vl53l0x_set_final_vcsel_period(10);
+      vl53l0x_set_signal_rate_limit_q97(32); // 0.25 MCPS
+      vl53l0x_setMeasurementTimingBudget(33000);
+      break;
+  }
+}
+
+// Ghi lại stop_variable trước khi start đo (sequence của Pololu)
+static void vl53l0x_start_sequence(void)
+{
+  vl53_write_reg(0x80, 0x01);
+  vl53_write_reg(0xFF, 0x01);
+  vl53_write_reg(0x00, 0x00);
+  vl53_write_reg(0x91, vl53l0x_stop_variable);
+  vl53_write_reg(0x00, 0x01);
+  vl53_write_reg(0xFF, 0x00);
+  vl53_write_reg(0x80, 0x00);
+}
+
+// Bắt đầu continuous mode thật trên phần cứng
+// period_ms = 0: back-to-back (SYSRANGE_START=0x02) - sensor đo liên tục hết tốc độ
+// period_ms > 0: timed continuous (SYSRANGE_START=0x04) với chu kỳ period_ms
 void vl53l0x_startContinuous(uint16_t period_ms)
 {
-  // Không cần làm gì trong single shot mode
-  // Mỗi lần gọi readRangeContinuousMillimeters sẽ tự động trigger đo mới
+  vl53l0x_start_sequence();
+
+  if (period_ms != 0) {
+    // Chu kỳ inter-measurement được scale theo oscillator calibration
+    uint16_t osc_calibrate_val = vl53_read_reg16(VL53L0X_REG_OSC_CALIBRATE_VAL);
+    uint32_t period = period_ms;
+    if (osc_calibrate_val != 0) { period *= osc_calibrate_val; }
+    vl53_write_reg32(VL53L0X_REG_SYSTEM_INTERMEASUREMENT_PERIOD, period);
+    vl53_write_reg(VL53L0X_REG_SYSRANGE_START, VL53L0X_SYSRANGE_MODE_TIMED);
+  } else {
+    // Back-to-back: lần đo tiếp theo bắt đầu ngay khi lần trước xong
+    vl53_write_reg(VL53L0X_REG_SYSRANGE_START, VL53L0X_SYSRANGE_MODE_BACKTOBACK);
+  }
+
+  #ifdef VL53L0X_GPIO1_INTERRUPT
+    vl53l0x_data_ready_flag = 0; // Bỏ flag cũ - chỉ nhận kết quả từ chu kỳ mới
+  #endif
+  vl53l0x_continuous_active = 1;
+}
+
+// Dừng continuous mode - quay về single shot
+void vl53l0x_stopContinuous(void)
+{
+  vl53_write_reg(VL53L0X_REG_SYSRANGE_START, VL53L0X_SYSRANGE_MODE_SINGLESHOT);
+
+  vl53_write_reg(0xFF, 0x01);
+  vl53_write_reg(0x00, 0x00);
+  vl53_write_reg(0x91, 0x00);
+  vl53_write_reg(0x00, 0x01);
+  vl53_write_reg(0xFF, 0x00);
+
+  vl53l0x_continuous_active = 0;
 }
 
-// Đọc khoảng cách từ sensor (dựa trên code C thuần)
-// Giống code mẫu: uint16_t distance = sensor.readRangeContinuousMillimeters();
+// Đọc khoảng cách từ sensor
+// Continuous mode: chỉ chờ kết quả sẵn có (sensor tự đo nền, không có start latency)
+// Single shot fallback: trigger đo mới rồi chờ như code cũ
 // Trả về: khoảng cách tính bằng mm (20-2000mm), 0 nếu lỗi, 8190 nếu out of range
 uint16_t vl53l0x_readRangeContinuousMillimeters(void)
 {
   // Reset timeout flag
   vl53l0x_timeout_flag = 0;
-  
-  // Start single shot measurement (giống code C thuần)
-  vl53_write_reg(VL53L0X_REG_SYSRANGE_START, 0x01);
-  
-  // Delay nhỏ để sensor bắt đầu đo (VL53L0X cần một chút thời gian để khởi động)
-  _delay_ms(2);
-  
-  // Chờ đo xong - Tăng timeout để đảm bảo đọc được điểm
-  // VL53L0X cần ~30ms cho mỗi lần đo, nhưng có thể lâu hơn trong một số điều kiện
-  // Sử dụng timeout tối đa 500ms (từ vl53l0x_io_timeout) để đảm bảo không mất điểm
+
+  if (!vl53l0x_continuous_active) {
+    // Fallback single shot: trigger đo mới (giống code C thuần cũ)
+    vl53l0x_start_sequence();
+    vl53_write_reg(VL53L0X_REG_SYSRANGE_START, VL53L0X_SYSRANGE_MODE_SINGLESHOT);
+
+    // Chờ bit start tự xóa (sensor đã nhận lệnh)
+    uint16_t start_timeout = 0;
+    while (vl53_read_reg(VL53L0X_REG_SYSRANGE_START) & 0x01) {
+      if (++start_timeout >= vl53l0x_io_timeout) {
+        vl53l0x_timeout_flag = 1;
+        return 0;
+      }
+      protocol_execute_realtime(); // Giữ st_prep_buffer chạy trong lúc chờ
+      if (sys.abort) { return 0; }
+      _delay_ms(1);
+    }
+  }
+
+  // Chờ kết quả đo sẵn sàng
+  // GPIO1 interrupt: chờ flag do ISR set - không có traffic I2C trong lúc chờ
+  // Poll fallback: đọc RESULT_INTERRUPT_STATUS mỗi 1ms như cũ
+  // Trong continuous mode, thường kết quả đã có sẵn - vòng lặp thoát ngay
   uint16_t timeout = 0;
-  uint16_t timeout_limit = vl53l0x_io_timeout; // Sử dụng toàn bộ timeout được cấu hình
-  
-  while (timeout < timeout_limit) {
-    uint8_t status = vl53_read_reg(VL53L0X_REG_SYSRANGE_START);
-    if ((status & 0x01) == 0) {
-      break; // Đo xong
+  while (!vl53l0x_dataReady()) {
+    if (++timeout >= vl53l0x_io_timeout) {
+      vl53l0x_timeout_flag = 1;
+      return 0; // Timeout
     }
+    // Timeout tối đa 500ms - đủ làm cạn segment buffer của stepper nếu chỉ
+    // đứng chờ. Feed realtime protocol mỗi vòng để motion không khựng.
+    protocol_execute_realtime();
+    if (sys.abort) { return 0; }
     _delay_ms(1);
-    timeout++;
   }
-  
-  // Kiểm tra timeout
-  if (timeout >= timeout_limit) {
-    vl53l0x_timeout_flag = 1;
-    return 0; // Timeout
-  }
-  
+
+  // Chốt timestamp ngay khi kết quả sẵn sàng - trước khi harvest 12 byte qua
+  // I2C (~1.2ms @ 100kHz) để timestamp không lệch theo tốc độ bus
+  vl53l0x_last_sample_micros = micros_now();
+
   // Đọc kết quả (giống code C thuần)
   uint8_t buffer[12];
-  // Đọc 12 bytes từ VL53L0X (I2C không có giới hạn cứng về số byte, 
+  // Đọc 12 bytes từ VL53L0X (I2C không có giới hạn cứng về số byte,
   // nhưng VL53L0X chỉ trả về 12 bytes cho kết quả đo)
   vl53_read_multi(VL53L0X_REG_RESULT_RANGE_STATUS, buffer, 12);
-  
+
   // Distance ở buffer[10] (MSB) và buffer[11] (LSB)
   uint16_t distance = ((uint16_t)buffer[10] << 8) | buffer[11];
-  
+
+  // Giữ lại phần còn lại của result block đã đọc về sẵn: device range status
+  // ở bit 6:3 của byte 0, signal rate byte 6-7, ambient rate byte 8-9 (đều
+  // big-endian) - không tốn thêm giao dịch I2C nào
+  vl53l0x_last_range_status = (buffer[0] >> 3) & 0x0F;
+  vl53l0x_last_signal_rate = ((uint16_t)buffer[6] << 8) | buffer[7];
+  vl53l0x_last_ambient_rate = ((uint16_t)buffer[8] << 8) | buffer[9];
+
+  // Xóa interrupt để sensor báo kết quả tiếp theo
+  #ifdef VL53L0X_GPIO1_INTERRUPT
+    vl53l0x_data_ready_flag = 0; // Xóa trước khi clear sensor - GPIO1 sẽ assert lại khi có mẫu mới
+  #endif
+  vl53_write_reg(VL53L0X_REG_SYSTEM_INTERRUPT_CLEAR, 0x01);
+
   // Xử lý kết quả giống code mẫu:
   // - distance >= 8190: OUT OF RANGE
   // - distance == 0: ERROR
   // - Còn lại: OK (20-2000mm)
-  
+
   if (distance >= 8190) {
+    vl53l0x_filter_push(8190);
     return 8190; // Out of range
   }
-  
+
+  #ifdef VL53L0X_CAL_LUT
+    // Hiệu chuẩn bias phụ thuộc khoảng cách ngay tại nguồn - filter, burst và
+    // host đều nhận dữ liệu đã sửa (xem bảng vl53l0x_cal_table phía trên)
+    if (distance) { distance = vl53l0x_cal_apply(distance); }
+  #endif
+
   // distance = 0 có thể là lỗi hoặc hợp lệ (quá gần)
-  // Trả về như code C thuần
+  // Trả về như code C thuần - chỉ push sample khác 0 vào filter
+  if (distance) { vl53l0x_filter_push(distance); }
   return distance;
 }
 
+// Đọc khoảng cách đã lọc: lấy đủ window sample mới từ continuous mode rồi
+// trả về median - outlier (glint, multipath) bị loại ngay tại firmware
+// Trả về: median khoảng cách (mm), 0 nếu không thu được sample nào
+uint16_t vl53l0x_readRangeFilteredMillimeters(void)
+{
+  uint8_t window = settings.tof_filter_window;
+  uint8_t i, j, n;
+  uint16_t sorted[VL53L0X_FILTER_MAX_SAMPLES];
+
+  if (window < 1) { window = 1; }
+  if (window > VL53L0X_FILTER_MAX_SAMPLES) { window = VL53L0X_FILTER_MAX_SAMPLES; }
+
+  // Thu window sample mới - mỗi lần đọc thành công tự push vào ring.
+  // Timeout giữa chừng không hủy cả phép đo, median lấy trên sample có được.
+  for (i = 0; i < window; i++) {
+    vl53l0x_readRangeContinuousMillimeters();
+  }
+
+  n = vl53l0x_filter_count;
+  if (n == 0) { return 0; } // Không có sample nào - sensor lỗi/timeout
+  if (n > window) { n = window; }
+
+  // Copy n sample mới nhất từ ring ra rồi insertion sort (n <= 9, đủ rẻ)
+  for (i = 0; i < n; i++) {
+    uint8_t idx = (uint8_t)(vl53l0x_filter_head + VL53L0X_FILTER_MAX_SAMPLES - n + i) % VL53L0X_FILTER_MAX_SAMPLES;
+    uint16_t value = vl53l0x_filter_ring[idx];
+    j = i;
+    while (j && (sorted[j-1] > value)) { sorted[j] = sorted[j-1]; j--; }
+    sorted[j] = value;
+  }
+
+  return sorted[n >> 1]; // Median (phần tử giữa)
+}
+
+// Timestamp microsecond của lần đo gần nhất (xem micros.c)
+uint32_t vl53l0x_lastSampleMicros(void)
+{
+  return vl53l0x_last_sample_micros;
+}
+
+// Trường chất lượng của lần đo gần nhất - hợp lệ sau một lần read thành công
+// Range status: 11 = hợp lệ, các mã khác là sigma/signal fail, phantom...
+uint8_t vl53l0x_lastRangeStatus(void)
+{
+  return vl53l0x_last_range_status;
+}
+
+uint16_t vl53l0x_lastSignalRate(void)
+{
+  return vl53l0x_last_signal_rate;
+}
+
+uint16_t vl53l0x_lastAmbientRate(void)
+{
+  return vl53l0x_last_ambient_rate;
+}
+
 // Kiểm tra timeout (giống sensor.timeoutOccurred())
 uint8_t vl53l0x_timeoutOccurred(void)
 {
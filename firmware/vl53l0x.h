@@ -1,7 +1,7 @@
 /*
   vl53l0x.h - Header file cho driver sensor VL53L0X
   Dựa trên code C thuần
-  
+
   Part of Grbl
   Copyright (c) 2024
 */
@@ -18,24 +18,124 @@
 // Địa chỉ các register của VL53L0X
 #define VL53L0X_REG_IDENTIFICATION_MODEL_ID    0xC0
 #define VL53L0X_REG_SYSRANGE_START             0x00
+#define VL53L0X_REG_SYSTEM_SEQUENCE_CONFIG     0x01
+#define VL53L0X_REG_SYSTEM_INTERMEASUREMENT_PERIOD 0x04
+#define VL53L0X_REG_SYSTEM_INTERRUPT_CONFIG_GPIO 0x0A
+#define VL53L0X_REG_SYSTEM_INTERRUPT_CLEAR     0x0B
+#define VL53L0X_REG_GPIO_HV_MUX_ACTIVE_HIGH    0x84
+#define VL53L0X_REG_RESULT_INTERRUPT_STATUS    0x13
 #define VL53L0X_REG_RESULT_RANGE_STATUS        0x14
 #define VL53L0X_REG_RESULT_RANGE_VAL           0x1E
+#define VL53L0X_REG_OSC_CALIBRATE_VAL          0xF8
+
+// Register cấu hình ranging profile (tên theo thư viện Pololu)
+#define VL53L0X_REG_FINAL_RANGE_CONFIG_MIN_COUNT_RATE_RTN_LIMIT 0x44
+#define VL53L0X_REG_FINAL_RANGE_CONFIG_VALID_PHASE_HIGH         0x48
+#define VL53L0X_REG_PRE_RANGE_CONFIG_VCSEL_PERIOD               0x50
+#define VL53L0X_REG_PRE_RANGE_CONFIG_TIMEOUT_MACROP_HI          0x51
+#define VL53L0X_REG_PRE_RANGE_CONFIG_VALID_PHASE_LOW            0x56
+#define VL53L0X_REG_PRE_RANGE_CONFIG_VALID_PHASE_HIGH           0x57
+#define VL53L0X_REG_FINAL_RANGE_CONFIG_VCSEL_PERIOD             0x70
+#define VL53L0X_REG_FINAL_RANGE_CONFIG_TIMEOUT_MACROP_HI        0x71
+#define VL53L0X_REG_GLOBAL_CONFIG_VCSEL_WIDTH                   0x32
+#define VL53L0X_REG_ALGO_PHASECAL_CONFIG_TIMEOUT                0x30
+#define VL53L0X_REG_ALGO_PHASECAL_LIM                           0x30 // Trên page 0xFF=0x01
+
+// Số sample tối đa trong ring buffer filter (window thực tế đặt qua setting $32)
+#define VL53L0X_FILTER_MAX_SAMPLES 9
+
+#ifdef VL53L0X_CAL_LUT
+// Bảng hiệu chuẩn khoảng cách piecewise-linear (xem config.h và vl53l0x.c)
+#define VL53L0X_CAL_POINTS 8
+
+// Một entry của bảng: khoảng cách thô (mm) và offset hiệu chuẩn (mm, có dấu)
+typedef struct {
+  uint16_t raw;
+  int16_t offset;
+} vl53l0x_cal_entry_t;
+
+// Đọc một entry của bảng hiệu chuẩn từ PROGMEM (cho lệnh $T)
+void vl53l0x_cal_entry(uint8_t idx, uint16_t *raw, int16_t *offset);
+
+// Áp dụng hiệu chuẩn nội suy tuyến tính cho một kết quả đo thô (mm)
+uint16_t vl53l0x_cal_apply(uint16_t raw);
+#endif
+
+// Ranging profile - chọn qua setting $31 hoặc lệnh VL53L0X_PROFILE=n
+#define VL53L0X_PROFILE_BALANCED   0 // Mặc định: budget 33ms, rate limit 0.25 MCPS
+#define VL53L0X_PROFILE_HIGH_SPEED 1 // Budget 20ms -> ~50 điểm/giây, độ chính xác thấp hơn
+#define VL53L0X_PROFILE_LONG_RANGE 2 // VCSEL dài + rate limit 0.1 MCPS, đo xa hơn
+
+// Giá trị ghi vào SYSRANGE_START
+#define VL53L0X_SYSRANGE_MODE_SINGLESHOT   0x01 // Đo một lần
+#define VL53L0X_SYSRANGE_MODE_BACKTOBACK   0x02 // Continuous back-to-back (nhanh nhất)
+#define VL53L0X_SYSRANGE_MODE_TIMED        0x04 // Continuous với inter-measurement period
 
 // API giống thư viện Pololu
 // sensor.init() -> trả về 1 nếu thành công, 0 nếu lỗi
 uint8_t vl53l0x_init(void);
 
-// sensor.setTimeout(500) - không cần trong single shot mode
+// sensor.setTimeout(500)
 void vl53l0x_setTimeout(uint16_t timeout);
 
-// sensor.startContinuous(100) - không cần trong single shot mode
+// sensor.startContinuous(period_ms)
+// period_ms = 0: back-to-back mode (sensor đo liên tục, ~33 điểm/giây)
+// period_ms > 0: timed continuous mode với chu kỳ period_ms giữa các lần đo
 void vl53l0x_startContinuous(uint16_t period_ms);
 
+// sensor.stopContinuous() - quay về chế độ single shot
+void vl53l0x_stopContinuous(void);
+
+// Áp dụng ranging profile (VL53L0X_PROFILE_xxx)
+// Ghi timing budget, VCSEL pulse periods và signal-rate limit tương ứng
+// Gọi khi sensor không đo (trước startContinuous hoặc sau stopContinuous)
+void vl53l0x_setProfile(uint8_t profile);
+
+// Đặt measurement timing budget (micro giây, tối thiểu 20000)
+// Budget ngắn hơn = nhiều điểm/giây hơn nhưng kém chính xác
+// Trả về: 1 nếu thành công, 0 nếu budget quá ngắn
+uint8_t vl53l0x_setMeasurementTimingBudget(uint32_t budget_us);
+
 // sensor.readRangeContinuousMillimeters() -> trả về distance (mm)
-// Trong single shot mode, mỗi lần gọi sẽ trigger một lần đo mới
+// Trong continuous mode: chỉ harvest kết quả đã đo xong (không trigger đo mới)
+// Nếu chưa startContinuous: fallback tự động trigger single shot
 uint16_t vl53l0x_readRangeContinuousMillimeters(void);
 
+// Đọc khoảng cách đã lọc - median của settings.tof_filter_window ($32) sample
+// continuous mode mới nhất. Một round trip thay cho 3-5 lần READ_VL53L0X.
+uint16_t vl53l0x_readRangeFilteredMillimeters(void);
+
+// Timestamp microsecond (micros_now) của lần đo gần nhất - chốt lúc data-ready
+// Dùng với lệnh READ_VL53L0X_T để host nội suy góc quay lúc lấy mẫu
+uint32_t vl53l0x_lastSampleMicros(void);
+
+// Trường chất lượng của lần đo gần nhất - lấy sẵn từ 12 byte result block
+// của lần harvest cuối, không tốn thêm giao dịch I2C. Dùng với lệnh
+// READ_VL53L0X_E để host lọc sample xấu mà không phải re-request.
+uint8_t vl53l0x_lastRangeStatus(void);   // Device range status (11 = hợp lệ)
+uint16_t vl53l0x_lastSignalRate(void);   // Return signal rate, MCPS 9.7
+uint16_t vl53l0x_lastAmbientRate(void);  // Ambient rate, MCPS 9.7
+
 // sensor.timeoutOccurred() -> trả về 1 nếu timeout, 0 nếu không
 uint8_t vl53l0x_timeoutOccurred(void);
 
+// Kiểm tra có kết quả đo sẵn sàng không (non-blocking)
+// GPIO1 interrupt bật: đọc flag do ISR set (không tốn bus I2C)
+// GPIO1 interrupt tắt: poll RESULT_INTERRUPT_STATUS qua I2C
+uint8_t vl53l0x_dataReady(void);
+
+// Poll thẳng RESULT_INTERRUPT_STATUS qua I2C, bỏ qua flag ISR - fallback cho
+// chế độ GPIO1 khi một cạnh ngắt có thể đã mất (sample vẫn nằm chờ trong sensor)
+uint8_t vl53l0x_dataReadyPoll(void);
+
+#ifdef VL53L0X_GPIO1_INTERRUPT
+  // Gọi từ pin-change ISR (CONTROL_INT_vect trong system.c) khi GPIO1 thay đổi
+  // Set data-ready flag và latch sys.position tại thời điểm đo xong
+  void vl53l0x_gpio1_isr(void);
+
+  // Copy vị trí step đã latch lúc sample gần nhất hoàn thành (atomic)
+  // Dùng với lệnh READ_VL53L0X_P - sample ghép đúng step count dù motor đang chạy
+  void vl53l0x_getLatchedPosition(int32_t *position);
+#endif
+
 #endif
@@ -1,7 +1,11 @@
 /*
   vl53l1.c - Implementation driver sensor VL53L1
-  Dựa trên cấu trúc VL53L0X với register addresses của VL53L1
-  
+  Dựa trên ST ultra-lite driver, rút gọn cho ranging session liên tục
+
+  Sensor giữ một ranging session chạy nền (SYSTEM_MODE_START=0x40 với
+  inter-measurement period). Firmware chỉ kiểm tra data-ready flag và harvest
+  result block - không còn đọc mù register 0x0096 và nhận giá trị cũ.
+
   Part of Grbl
   Copyright (c) 2024
 */
@@ -14,98 +18,292 @@
 static uint8_t vl53l1_timeout_flag = 0;
 static uint16_t vl53l1_io_timeout = 500; // Timeout 500ms
 
-// Đọc register 16-bit (dựa trên code C thuần)
-// Giống hàm vl53l1x_read16() trong code mẫu
+// Trạng thái ranging session
+static uint8_t vl53l1_session_active = 0;
+
+// Timestamp microsecond của lần đo gần nhất (chốt lúc data-ready)
+static uint32_t vl53l1_last_sample_micros = 0;
+static uint8_t vl53l1_distance_mode = VL53L1_DISTANCE_LONG;
+
+// Địa chỉ I2C hiện tại của sensor - bắt đầu ở địa chỉ mặc định,
+// vl53l1_setAddress() cập nhật khi boot sequence chuyển địa chỉ
+static uint8_t vl53l1_i2c_address = VL53L1_I2C_ADDR_DEFAULT;
+
+// Ring buffer cho filtered read - cùng cấu trúc với vl53l0x.c, dùng chung
+// kích thước VL53L0X_FILTER_MAX_SAMPLES và window từ setting $32
+static uint16_t vl53l1_filter_ring[VL53L0X_FILTER_MAX_SAMPLES];
+static uint8_t vl53l1_filter_head = 0;
+static uint8_t vl53l1_filter_count = 0;
+
+// Push một sample vào ring buffer filter
+static void vl53l1_filter_push(uint16_t distance)
+{
+  vl53l1_filter_ring[vl53l1_filter_head] = distance;
+  vl53l1_filter_head++;
+  if (vl53l1_filter_head >= VL53L0X_FILTER_MAX_SAMPLES) { vl53l1_filter_head = 0; }
+  if (vl53l1_filter_count < VL53L0X_FILTER_MAX_SAMPLES) { vl53l1_filter_count++; }
+}
+
+// ---------------------------------------------------------------------------
+// Truy cập register 16-bit index qua I2C engine (reg_size = 2)
+// ---------------------------------------------------------------------------
+
+// Thực hiện một giao dịch register 16-bit blocking qua engine
+static uint8_t vl53l1_txn(uint16_t reg, uint8_t rw, uint8_t *data, uint8_t length)
+{
+  i2c_txn_t txn;
+  txn.address = vl53l1_i2c_address;
+  txn.reg = reg;
+  txn.reg_size = 2;
+  txn.rw = rw;
+  txn.data = data;
+  txn.length = length;
+  txn.callback = NULL;
+  while (i2c_submit(&txn)); // Chờ engine rảnh rồi submit
+  return i2c_txn_wait(&txn);
+}
+
+// Ghi register 8-bit
+static void vl53l1_write_reg(uint16_t reg, uint8_t value)
+{
+  vl53l1_txn(reg, I2C_TXN_WRITE, &value, 1);
+}
+
+// Ghi register 16-bit (MSB trước)
+static void vl53l1_write_reg16(uint16_t reg, uint16_t value)
+{
+  uint8_t buffer[2];
+  buffer[0] = (value >> 8) & 0xFF;
+  buffer[1] = value & 0xFF;
+  vl53l1_txn(reg, I2C_TXN_WRITE, buffer, 2);
+}
+
+// Ghi register 32-bit (MSB trước)
+static void vl53l1_write_reg32(uint16_t reg, uint32_t value)
+{
+  uint8_t buffer[4];
+  buffer[0] = (value >> 24) & 0xFF;
+  buffer[1] = (value >> 16) & 0xFF;
+  buffer[2] = (value >> 8) & 0xFF;
+  buffer[3] = value & 0xFF;
+  vl53l1_txn(reg, I2C_TXN_WRITE, buffer, 4);
+}
+
+// Đọc register 8-bit
+static uint8_t vl53l1_read_reg(uint16_t reg)
+{
+  uint8_t data;
+  if (vl53l1_txn(reg, I2C_TXN_READ, &data, 1)) { return 0; }
+  return data;
+}
+
+// Đọc register 16-bit (MSB trước)
+// Giống hàm vl53l1x_read16() trong code mẫu, nhưng chạy qua engine
 static uint16_t vl53l1_read16(uint16_t reg)
 {
-  uint16_t val;
-  uint8_t reg_msb = (reg >> 8) & 0xFF;
-  uint8_t reg_lsb = reg & 0xFF;
-  
-  // Write register address (2 bytes)
-  if (i2c_start((VL53L1_I2C_ADDR << 1))) {
-    i2c_stop();
-    return 0;
-  }
-  if (i2c_write(reg_msb)) {
-    i2c_stop();
-    return 0;
-  }
-  if (i2c_write(reg_lsb)) {
-    i2c_stop();
-    return 0;
-  }
-  
-  // Restart và đọc 2 bytes (MSB trước, LSB sau)
-  if (i2c_restart((VL53L1_I2C_ADDR << 1) | 1)) {
-    i2c_stop();
-    return 0;
-  }
-  val = ((uint16_t)i2c_read_ack() << 8);  // MSB
-  val |= i2c_read_nack();                  // LSB
-  i2c_stop();
-  
-  return val;
+  uint8_t buffer[2];
+  if (vl53l1_txn(reg, I2C_TXN_READ, buffer, 2)) { return 0; }
+  return ((uint16_t)buffer[0] << 8) | buffer[1];
 }
 
+// ---------------------------------------------------------------------------
+// Driver API
+// ---------------------------------------------------------------------------
+
 // Set timeout
 void vl53l1_setTimeout(uint16_t timeout)
 {
   vl53l1_io_timeout = timeout;
 }
 
-// Khởi tạo sensor VL53L1 (đơn giản, không cần init sequence phức tạp)
+// Chuyển sensor sang địa chỉ I2C mới (7-bit)
+// Ghi register lúc sensor còn ở địa chỉ cũ, sau đó mọi giao dịch dùng địa chỉ mới
+void vl53l1_setAddress(uint8_t new_address)
+{
+  vl53l1_write_reg(VL53L1_REG_I2C_SLAVE_DEVICE_ADDRESS, new_address & 0x7F);
+  vl53l1_i2c_address = new_address & 0x7F;
+}
+
+// Khởi tạo sensor VL53L1: chờ firmware boot và kiểm tra model ID
+// Cấu hình ranging dựa trên NVM defaults của sensor (load khi power-on),
+// chỉ program distance mode và inter-measurement period khi start session
 // Trả về: 1 nếu thành công, 0 nếu lỗi
 uint8_t vl53l1_init(void)
 {
-  _delay_ms(100);
-  
+  // Poll model ID (0xEACC cho họ VL53L1) thay cho _delay_ms(100) cứng -
+  // sensor đã boot (warm reset) trả lời ngay, cold boot chỉ chờ đủ thời gian
+  // thật sự cần trước khi vòng poll firmware status bên dưới tiếp quản
+  uint16_t id_timeout = 0;
+  while (vl53l1_read16(VL53L1_REG_IDENTIFICATION_MODEL_ID) != 0xEACC) {
+    if (++id_timeout >= 100) { return 0; } // Sensor không tồn tại
+    _delay_ms(1);
+  }
+
+  // Chờ firmware nội bộ của sensor boot xong
+  uint16_t boot_timeout = 0;
+  while ((vl53l1_read_reg(VL53L1_REG_FIRMWARE_SYSTEM_STATUS) & 0x01) == 0) {
+    if (++boot_timeout >= vl53l1_io_timeout) { return 0; }
+    _delay_ms(1);
+  }
+
   // Reset timeout flag
   vl53l1_timeout_flag = 0;
-  
-  // Không cần kiểm tra model ID hoặc init sequence phức tạp
-  // VL53L1 sẽ tự động sẵn sàng sau khi có nguồn
-  // Chỉ cần đọc register 0x0096 là có thể lấy distance
-  
+  vl53l1_session_active = 0;
+
   return 1; // Thành công
 }
 
-// Bắt đầu continuous mode
+// Đặt distance mode - bộ giá trị VCSEL/phase theo ST ultra-lite driver
+void vl53l1_setDistanceMode(uint8_t mode)
+{
+  if (mode == VL53L1_DISTANCE_SHORT) {
+    vl53l1_write_reg(VL53L1_REG_PHASECAL_CONFIG_TIMEOUT_MACROP, 0x14);
+    vl53l1_write_reg(VL53L1_REG_RANGE_CONFIG_VCSEL_PERIOD_A, 0x07);
+    vl53l1_write_reg(VL53L1_REG_RANGE_CONFIG_VCSEL_PERIOD_B, 0x05);
+    vl53l1_write_reg(VL53L1_REG_RANGE_CONFIG_VALID_PHASE_HIGH, 0x38);
+    vl53l1_write_reg16(VL53L1_REG_SD_CONFIG_WOI_SD0, 0x0705);
+    vl53l1_write_reg16(VL53L1_REG_SD_CONFIG_INITIAL_PHASE_SD0, 0x0606);
+  } else { // VL53L1_DISTANCE_LONG
+    vl53l1_write_reg(VL53L1_REG_PHASECAL_CONFIG_TIMEOUT_MACROP, 0x0A);
+    vl53l1_write_reg(VL53L1_REG_RANGE_CONFIG_VCSEL_PERIOD_A, 0x0F);
+    vl53l1_write_reg(VL53L1_REG_RANGE_CONFIG_VCSEL_PERIOD_B, 0x0D);
+    vl53l1_write_reg(VL53L1_REG_RANGE_CONFIG_VALID_PHASE_HIGH, 0xB8);
+    vl53l1_write_reg16(VL53L1_REG_SD_CONFIG_WOI_SD0, 0x0F0D);
+    vl53l1_write_reg16(VL53L1_REG_SD_CONFIG_INITIAL_PHASE_SD0, 0x0E0E);
+  }
+  vl53l1_distance_mode = mode;
+}
+
+// Bắt đầu ranging session liên tục - cấu hình một lần, sensor tự đo nền
 void vl53l1_startContinuous(uint16_t period_ms)
 {
-  // VL53L1 không cần start continuous trong single shot mode
-  // Mỗi lần gọi readRangeContinuousMillimeters sẽ tự động trigger đo mới
+  if (period_ms == 0) { period_ms = 50; } // Mặc định 50ms (~20 điểm/giây)
+
+  vl53l1_setDistanceMode(vl53l1_distance_mode);
+
+  // Inter-measurement period scale theo PLL clock của sensor
+  // (theo ST driver: period_ms * clock_pll * 1.075)
+  uint16_t clock_pll = vl53l1_read16(VL53L1_REG_RESULT_OSC_CALIBRATE_VAL) & 0x3FF;
+  uint32_t period = (uint32_t)period_ms * clock_pll;
+  period += (period * 75) / 1000; // * 1.075
+  vl53l1_write_reg32(VL53L1_REG_SYSTEM_INTERMEASUREMENT_PERIOD, period);
+
+  vl53l1_write_reg(VL53L1_REG_SYSTEM_INTERRUPT_CLEAR, 0x01); // Bỏ kết quả cũ
+  vl53l1_write_reg(VL53L1_REG_SYSTEM_MODE_START, 0x40); // Ranging enabled
+
+  vl53l1_session_active = 1;
+}
+
+// Đảm bảo ranging session đang chạy - start với period mặc định nếu chưa
+// Dùng cho đường lệnh non-blocking (không qua readRangeContinuousMillimeters)
+void vl53l1_ensureContinuous(void)
+{
+  if (!vl53l1_session_active) { vl53l1_startContinuous(0); }
+}
+
+// Dừng ranging session
+void vl53l1_stopContinuous(void)
+{
+  vl53l1_write_reg(VL53L1_REG_SYSTEM_MODE_START, 0x00);
+  vl53l1_session_active = 0;
+}
+
+// Kiểm tra có kết quả đo mới không (non-blocking)
+// Data ready khi bit 0 của GPIO_TIO_HV_STATUS xuống 0 (interrupt active low)
+uint8_t vl53l1_dataReady(void)
+{
+  return ((vl53l1_read_reg(VL53L1_REG_GPIO_TIO_HV_STATUS) & 0x01) == 0);
 }
 
-// Đọc khoảng cách từ sensor (dựa trên code C thuần)
-// Giống hàm vl53l1x_get_distance() trong code mẫu
+// Đọc khoảng cách từ sensor - chỉ trả về kết quả MỚI
 // Trả về: khoảng cách tính bằng mm (20-4000mm), 0 nếu lỗi, 8190 nếu out of range
 uint16_t vl53l1_readRangeContinuousMillimeters(void)
 {
   // Reset timeout flag
   vl53l1_timeout_flag = 0;
-  
-  // Đọc trực tiếp register 0x0096 để lấy distance (giống code mẫu)
-  // VL53L1 tự động cập nhật register này khi có measurement mới
+
+  // Tự động start session nếu chưa chạy (giữ hành vi đọc-là-có của lệnh READ_VL53L1)
+  if (!vl53l1_session_active) {
+    vl53l1_startContinuous(0);
+  }
+
+  // Chờ kết quả đo mới thay vì scrape giá trị cũ trong register
+  uint16_t timeout = 0;
+  while (!vl53l1_dataReady()) {
+    if (++timeout >= vl53l1_io_timeout) {
+      vl53l1_timeout_flag = 1;
+      return 0; // Timeout
+    }
+    // Feed realtime protocol mỗi vòng chờ - không làm cạn segment buffer stepper
+    protocol_execute_realtime();
+    if (sys.abort) { return 0; }
+    _delay_ms(1);
+  }
+
+  // Chốt timestamp ngay khi kết quả sẵn sàng, trước khi harvest qua I2C
+  vl53l1_last_sample_micros = micros_now();
+
   uint16_t distance = vl53l1_read16(VL53L1_REG_RESULT_DISTANCE);
-  
+
+  // Xóa interrupt để sensor báo kết quả tiếp theo
+  vl53l1_write_reg(VL53L1_REG_SYSTEM_INTERRUPT_CLEAR, 0x01);
+
   // Xử lý kết quả:
   // - distance >= 8190: OUT OF RANGE
-  // - distance == 0: ERROR hoặc chưa có data
+  // - distance == 0: ERROR
   // - Còn lại: OK (20-4000mm cho VL53L1)
-  
+
   if (distance >= 8190) {
+    vl53l1_filter_push(8190);
     return 8190; // Out of range
   }
-  
+
   // distance = 0 có thể là lỗi hoặc hợp lệ (quá gần)
-  // Trả về như code mẫu
+  // Trả về như code mẫu - chỉ push sample khác 0 vào filter
+  if (distance) { vl53l1_filter_push(distance); }
   return distance;
 }
 
+// Đọc khoảng cách đã lọc - median của window sample continuous mode mới nhất
+// Cùng thuật toán với vl53l0x_readRangeFilteredMillimeters()
+// Trả về: median khoảng cách (mm), 0 nếu không thu được sample nào
+uint16_t vl53l1_readRangeFilteredMillimeters(void)
+{
+  uint8_t window = settings.tof_filter_window;
+  uint8_t i, j, n;
+  uint16_t sorted[VL53L0X_FILTER_MAX_SAMPLES];
+
+  if (window < 1) { window = 1; }
+  if (window > VL53L0X_FILTER_MAX_SAMPLES) { window = VL53L0X_FILTER_MAX_SAMPLES; }
+
+  for (i = 0; i < window; i++) {
+    vl53l1_readRangeContinuousMillimeters();
+  }
+
+  n = vl53l1_filter_count;
+  if (n == 0) { return 0; } // Không có sample nào - sensor lỗi/timeout
+  if (n > window) { n = window; }
+
+  // Insertion sort n sample mới nhất (n <= 9)
+  for (i = 0; i < n; i++) {
+    uint8_t idx = (uint8_t)(vl53l1_filter_head + VL53L0X_FILTER_MAX_SAMPLES - n + i) % VL53L0X_FILTER_MAX_SAMPLES;
+    uint16_t value = vl53l1_filter_ring[idx];
+    j = i;
+    while (j && (sorted[j-1] > value)) { sorted[j] = sorted[j-1]; j--; }
+    sorted[j] = value;
+  }
+
+  return sorted[n >> 1]; // Median
+}
+
+// Timestamp microsecond của lần đo gần nhất (xem micros.c)
+uint32_t vl53l1_lastSampleMicros(void)
+{
+  return vl53l1_last_sample_micros;
+}
+
 // Kiểm tra timeout
 uint8_t vl53l1_timeoutOccurred(void)
 {
   return vl53l1_timeout_flag;
 }
-
@@ -1,7 +1,7 @@
 /*
   vl53l1.h - Header file cho driver sensor VL53L1
   Dựa trên cấu trúc VL53L0X với register addresses của VL53L1
-  
+
   Part of Grbl
   Copyright (c) 2024
 */
@@ -12,12 +12,38 @@
 #include "grbl.h"
 #include "i2c.h"
 
-// Địa chỉ I2C của VL53L1 (7-bit: 0x29, giống VL53L0X)
-#define VL53L1_I2C_ADDR 0x29
+// Địa chỉ I2C của VL53L1
+// Mặc định 0x29 giống VL53L0X - ở chế độ hai sensor phải chuyển sang 0x30
+// (boot sequence trong main.c dùng XSHUT + vl53l1_setAddress)
+#define VL53L1_I2C_ADDR_DEFAULT 0x29
+#ifdef DUAL_TOF_SENSORS
+  #define VL53L1_I2C_ADDR 0x30
+#else
+  #define VL53L1_I2C_ADDR 0x29
+#endif
+
+// Địa chỉ các register của VL53L1 (16-bit index, tên theo ST ultra-lite driver)
+#define VL53L1_REG_SOFT_RESET                     0x0000
+#define VL53L1_REG_I2C_SLAVE_DEVICE_ADDRESS       0x0001
+#define VL53L1_REG_GPIO_TIO_HV_STATUS             0x0031
+#define VL53L1_REG_PHASECAL_CONFIG_TIMEOUT_MACROP 0x004B
+#define VL53L1_REG_RANGE_CONFIG_VCSEL_PERIOD_A    0x0060
+#define VL53L1_REG_RANGE_CONFIG_VCSEL_PERIOD_B    0x0063
+#define VL53L1_REG_RANGE_CONFIG_VALID_PHASE_HIGH  0x0069
+#define VL53L1_REG_SYSTEM_INTERMEASUREMENT_PERIOD 0x006C
+#define VL53L1_REG_SD_CONFIG_WOI_SD0              0x0078
+#define VL53L1_REG_SD_CONFIG_INITIAL_PHASE_SD0    0x007A
+#define VL53L1_REG_SYSTEM_INTERRUPT_CLEAR         0x0086
+#define VL53L1_REG_SYSTEM_MODE_START              0x0087
+#define VL53L1_REG_RESULT_RANGE_STATUS            0x0089
+#define VL53L1_REG_RESULT_DISTANCE                0x0096  // Register chứa distance (16-bit)
+#define VL53L1_REG_RESULT_OSC_CALIBRATE_VAL       0x00DE
+#define VL53L1_REG_FIRMWARE_SYSTEM_STATUS         0x00E5
+#define VL53L1_REG_IDENTIFICATION_MODEL_ID        0x010F  // 16-bit, đọc được 0xEACC
 
-// Địa chỉ các register của VL53L1
-#define VL53L1_REG_RESULT_RANGE_STATUS        0x0089
-#define VL53L1_REG_RESULT_DISTANCE            0x0096  // Register chứa distance (16-bit)
+// Distance mode
+#define VL53L1_DISTANCE_SHORT 1 // Tới ~1.3m, chịu ánh sáng môi trường tốt hơn
+#define VL53L1_DISTANCE_LONG  2 // Tới ~4m (mặc định)
 
 // API giống VL53L0X để dễ sử dụng
 // sensor.init() -> trả về 1 nếu thành công, 0 nếu lỗi
@@ -26,14 +52,41 @@ uint8_t vl53l1_init(void);
 // sensor.setTimeout(500)
 void vl53l1_setTimeout(uint16_t timeout);
 
-// sensor.startContinuous(100)
+// Chuyển sensor sang địa chỉ I2C mới (ghi lúc sensor còn ở địa chỉ hiện tại)
+// Dùng trong boot sequence hai sensor để tách VL53L1 khỏi địa chỉ 0x29
+void vl53l1_setAddress(uint8_t new_address);
+
+// Đặt distance mode (VL53L1_DISTANCE_SHORT/LONG)
+// Gọi khi sensor không đo (trước startContinuous hoặc sau stopContinuous)
+void vl53l1_setDistanceMode(uint8_t mode);
+
+// sensor.startContinuous(period_ms) - bắt đầu ranging session liên tục
+// period_ms: chu kỳ inter-measurement (0 -> mặc định 50ms)
+// Session giữ chạy cho đến khi stopContinuous - mỗi lần đọc chỉ harvest kết quả
 void vl53l1_startContinuous(uint16_t period_ms);
 
+// Đảm bảo ranging session đang chạy (start với period mặc định nếu chưa)
+void vl53l1_ensureContinuous(void);
+
+// Dừng ranging session
+void vl53l1_stopContinuous(void);
+
+// Kiểm tra có kết quả đo mới không (non-blocking)
+uint8_t vl53l1_dataReady(void);
+
 // sensor.readRangeContinuousMillimeters() -> trả về distance (mm)
+// Chờ kết quả MỚI (data-ready flag) rồi mới đọc - không trả về giá trị cũ
+// Tự động start session nếu chưa chạy
 uint16_t vl53l1_readRangeContinuousMillimeters(void);
 
+// Đọc khoảng cách đã lọc - median của settings.tof_filter_window ($32) sample
+// mới nhất, giống vl53l0x_readRangeFilteredMillimeters()
+uint16_t vl53l1_readRangeFilteredMillimeters(void);
+
+// Timestamp microsecond (micros_now) của lần đo gần nhất - chốt lúc data-ready
+uint32_t vl53l1_lastSampleMicros(void);
+
 // sensor.timeoutOccurred() -> trả về 1 nếu timeout, 0 nếu không
 uint8_t vl53l1_timeoutOccurred(void);
 
 #endif
-
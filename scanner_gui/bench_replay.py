@@ -0,0 +1,243 @@
+"""
+Scan replay benchmark - measure the GUI's serial->point pipeline without
+hardware.
+
+There is no regression guard on host-side throughput: a change to
+process_serial_data() or update_vl53_display() can halve the effective
+point rate and nobody notices until the next long scan. This harness
+replays raw serial traffic (the ASCII "VL53L0X_DISTANCE:" lines, the GRBL
+status reports parse_grbl_status() handles, and the binary telemetry
+frames) through the real ScannerGUI parsing and point-conversion methods
+on a headless stand-in, and reports points/sec plus per-message latency
+(avg/p99) so every change gets a number.
+
+Usage:
+    python3 bench_replay.py                  # all synthetic workloads
+    python3 bench_replay.py -n 50000         # messages per workload
+    python3 bench_replay.py -f capture.bin   # replay a recorded raw byte
+                                             # stream through the frame/line
+                                             # splitter (e.g. dumped with
+                                             # socat or a logging shim)
+
+Output goes to stderr; stdout is redirected to /dev/null during timed
+sections because the pipeline's debug prints would otherwise benchmark
+the terminal emulator instead of the parser.
+"""
+
+import argparse
+import contextlib
+import os
+import struct
+import sys
+import time
+
+import main
+from main import crc8, TELEM_SYNC_BYTE, TELEM_TYPE_VL53L0X, TELEM_TYPE_DELTA
+
+
+class _FakeVar:
+    """Stands in for tk.StringVar - just enough for .get()/.set()."""
+
+    def __init__(self, value=""):
+        self._value = value
+
+    def get(self):
+        return self._value
+
+    def set(self, value):
+        self._value = value
+
+
+class _FakeRoot:
+    """Stands in for tk.Tk. after() drops callbacks: the live renderer is
+    display work, not parsing work, and benchmarking it here would just
+    measure matplotlib."""
+
+    def title(self, *_):
+        pass
+
+    def geometry(self, *_):
+        pass
+
+    def after(self, *_):
+        pass
+
+
+class HeadlessScanner(main.ScannerGUI):
+    """ScannerGUI with widget construction replaced by the few settings
+    variables the parsing/conversion path reads. Every method under test
+    (process_serial_data, parse_grbl_status, _extract_messages,
+    process_telemetry_frame, process_scan_data_point, ...) is inherited
+    unchanged, so the benchmark exercises the shipped code."""
+
+    def __init__(self):
+        main.ScannerGUI.__init__(self, _FakeRoot())
+
+    def create_widgets(self):
+        # Defaults mirror the widget defaults in the real create_widgets()
+        self.center_distance_var = _FakeVar("16.5")
+        self.disk_radius_var = _FakeVar("5.0")
+        self.vl53_offset_var = _FakeVar("0.0")
+        self.points_per_revolution_var = _FakeVar("36")
+        self.vl53_reading_active = False
+        self.resend_count = 0
+
+    # Logging goes to widgets (or print) in the GUI; count instead
+    def log_info(self, message):
+        pass
+
+    def log_serial_receive(self, response):
+        pass
+
+    def log_serial_send(self, command):
+        pass
+
+    def send_serial_command(self, command, log=True):
+        if command.startswith("RESEND="):
+            self.resend_count += 1
+
+
+# ---- Synthetic workloads -------------------------------------------------
+
+def gen_distance_lines(n):
+    """ASCII sensor lines as the firmware prints them in plain mode."""
+    return [f"VL53L0X_DISTANCE:{120 + (i % 80)}" for i in range(n)]
+
+
+def gen_status_lines(n):
+    """GRBL 0.9j status reports across a plausible scan trajectory."""
+    lines = []
+    for i in range(n):
+        x = (i % 720) * 0.005  # rotation sweep
+        y = (i // 720) * 0.2   # height, GRBL units
+        lines.append(f"<Run,MPos:{x:.3f},{y:.3f},0.000,WPos:{x:.3f},{y:.3f},0.000>")
+    return lines
+
+
+def build_frame(seq, frame_type, payload):
+    header = bytes((TELEM_SYNC_BYTE, seq & 0xFF, frame_type, len(payload)))
+    return header + payload + bytes((crc8(header[1:] + payload),))
+
+
+def gen_telemetry_stream(n):
+    """Binary frame stream: alternating single-sample and delta-burst
+    frames, the mix the firmware sends during a scan with $B enabled."""
+    chunks = []
+    seq = 0
+    for i in range(n):
+        if i % 2 == 0:
+            chunks.append(build_frame(seq, TELEM_TYPE_VL53L0X,
+                                      struct.pack('<H', 120 + (i % 80))))
+        else:
+            # Keyframe + 7 small zigzag deltas (all +1 -> varint 0x02)
+            payload = struct.pack('<H', 120 + (i % 80)) + b'\x02' * 7
+            chunks.append(build_frame(seq, TELEM_TYPE_DELTA, payload))
+        seq = (seq + 1) & 0xFF
+    return b''.join(chunks)
+
+
+# ---- Measurement ---------------------------------------------------------
+
+def percentile(latencies, pct):
+    if not latencies:
+        return 0.0
+    ordered = sorted(latencies)
+    idx = min(len(ordered) - 1, int(len(ordered) * pct / 100.0))
+    return ordered[idx]
+
+
+def report(label, n_msgs, elapsed, latencies, points):
+    rate = n_msgs / elapsed if elapsed > 0 else 0.0
+    pps = points / elapsed if elapsed > 0 else 0.0
+    avg_us = (sum(latencies) / len(latencies)) * 1e6 if latencies else 0.0
+    p99_us = percentile(latencies, 99) * 1e6
+    print(f"{label:<22} {n_msgs:>8} msgs  {rate:>9.0f} msg/s  "
+          f"{pps:>9.0f} pts/s  avg {avg_us:>6.1f} us  p99 {p99_us:>7.1f} us",
+          file=sys.stderr)
+
+
+def run_line_workload(gui, label, lines, per_line_hook=None):
+    gui.scan_data.clear()
+    latencies = []
+    devnull = open(os.devnull, 'w')
+    with contextlib.redirect_stdout(devnull):
+        t0 = time.perf_counter()
+        for line in lines:
+            t_msg = time.perf_counter()
+            gui.process_serial_data(line)
+            if per_line_hook is not None:
+                per_line_hook()
+            latencies.append(time.perf_counter() - t_msg)
+        elapsed = time.perf_counter() - t0
+    devnull.close()
+    report(label, len(lines), elapsed, latencies, len(gui.scan_data))
+
+
+def run_byte_workload(gui, label, data, chunk=4096):
+    """Replay a raw byte stream through the frame/line splitter the reader
+    thread uses, in serial-read-sized chunks."""
+    gui.scan_data.clear()
+    gui._telem_last_seq = None
+    buf = bytearray()
+    latencies = []
+    n_chunks = 0
+    devnull = open(os.devnull, 'w')
+    with contextlib.redirect_stdout(devnull):
+        t0 = time.perf_counter()
+        for start in range(0, len(data), chunk):
+            t_msg = time.perf_counter()
+            buf += data[start:start + chunk]
+            gui._extract_messages(buf)
+            latencies.append(time.perf_counter() - t_msg)
+            n_chunks += 1
+        elapsed = time.perf_counter() - t0
+    devnull.close()
+    report(label, n_chunks, elapsed, latencies, len(gui.scan_data))
+
+
+def main_bench():
+    parser = argparse.ArgumentParser(description="Replay serial traffic "
+                                     "through the GUI pipeline and measure it")
+    parser.add_argument('-n', type=int, default=20000,
+                        help="messages per synthetic workload (default 20000)")
+    parser.add_argument('-f', metavar='capture.bin',
+                        help="raw serial capture to replay instead of the "
+                             "synthetic workloads")
+    args = parser.parse_args()
+
+    gui = HeadlessScanner()
+    print(f"bench_replay: {args.n} msgs/workload, "
+          f"ScanPointStore + shipped parse path", file=sys.stderr)
+
+    if args.f:
+        with open(args.f, 'rb') as f:
+            data = f.read()
+        run_byte_workload(gui, os.path.basename(args.f), data)
+        return
+
+    # 1. ASCII distance lines, display-only (test tab reading)
+    run_line_workload(gui, "ascii distance", gen_distance_lines(args.n))
+
+    # 2. ASCII distance lines during a scan: each reading also becomes a
+    #    point via process_scan_data_point, as the per-point scan loop does
+    gui.is_scanning = True
+    run_line_workload(gui, "ascii distance+point", gen_distance_lines(args.n),
+                      per_line_hook=gui.process_scan_data_point)
+    gui.is_scanning = False
+
+    # 3. GRBL status reports through parse_grbl_status
+    run_line_workload(gui, "grbl status", gen_status_lines(args.n))
+
+    # 4. Binary telemetry frames through the splitter + frame decoder,
+    #    bursts converted and stored (scanning active)
+    gui.is_scanning = True
+    run_byte_workload(gui, "binary telemetry",
+                      gen_telemetry_stream(args.n))
+    gui.is_scanning = False
+    if gui.resend_count:
+        print(f"  (unexpected: {gui.resend_count} RESEND requests)",
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main_bench()
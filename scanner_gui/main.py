@@ -27,6 +27,9 @@ from tkinter import ttk, filedialog, messagebox
 import serial
 import serial.tools.list_ports
 import threading
+import multiprocessing
+from multiprocessing import shared_memory
+from collections import deque
 import numpy as np
 from matplotlib.backends.backend_tkagg import FigureCanvasTkAgg, NavigationToolbar2Tk
 from matplotlib.figure import Figure
@@ -34,9 +37,293 @@ from mpl_toolkits.mplot3d import Axes3D
 from mpl_toolkits.mplot3d.art3d import Poly3DCollection
 import time
 import os
+import json
+import struct
 from datetime import datetime  # Added for .k file export
+import scan_file  # Binary .scan persistence (crash-safe raw sample log)
+
+# Binary telemetry framing (firmware report.h, enabled with $B):
+# [0xA5][seq][type][length][payload...][CRC8 of seq+type+length+payload]
+TELEM_SYNC_BYTE = 0xA5
+TELEM_TYPE_VL53L0X = 0x01   # uint16 distance (mm)
+TELEM_TYPE_VL53L1 = 0x02    # uint16 distance (mm)
+TELEM_TYPE_SAMPLE_T = 0x03  # uint16 distance + uint32 micros
+TELEM_TYPE_DUAL = 0x04      # uint16 distance_a + uint16 distance_b
+TELEM_TYPE_FILTERED = 0x05  # uint16 distance (median)
+TELEM_TYPE_SCAN = 0x06      # int32 x_steps + uint16 distance
+TELEM_TYPE_SAMPLE_P = 0x07  # uint16 distance + int32 x_steps + int32 y_steps
+TELEM_TYPE_SCAN_H = 0x08    # int32 x_steps + int32 y_steps + uint16 distance
+TELEM_TYPE_DELTA = 0x09     # uint16 keyframe + zigzag-varint deltas
+TELEM_TYPE_EXT = 0x0A       # uint16 distance + uint8 status + uint16 signal + uint16 ambient
+TELEM_MAX_PAYLOAD = 16
+
+# CRC8 poly 0x07 init 0x00, same as telem_crc8() in the firmware - table
+# driven here so a frame costs a few lookups instead of 8 shifts per byte
+def _crc8_build_table():
+    table = []
+    for byte in range(256):
+        crc = byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+        table.append(crc)
+    return bytes(table)
+
+CRC8_TABLE = _crc8_build_table()
+
+def crc8(data, crc=0):
+    for b in data:
+        crc = CRC8_TABLE[crc ^ b]
+    return crc
+
+class ScanPointStore:
+    """Preallocated, growable NumPy store for scan points.
+
+    Replaces the old Python list of (x, y, z, angle, height) tuples. Points
+    go into a structured array grown by doubling (O(1) amortized append),
+    and the per-layer point counts the scan loop asks for on every layer
+    come from a small dict of 0.1mm height buckets instead of a linear pass
+    over the whole list - with 100k+ tuples that pass visibly stuttered the
+    UI late in big scans.
+
+    Read access keeps the old tuple protocol: len(), iteration and indexing
+    all yield (x, y, z, angle, height) tuples, so the mesh generation and
+    export code works unchanged. points() exposes the underlying columns
+    for vectorized use (e.g. pulling x/y/z for the plot without a Python
+    loop).
+    """
+
+    POINT_DTYPE = np.dtype([
+        ('x', np.float64), ('y', np.float64), ('z', np.float64),
+        ('angle', np.float64), ('height', np.float64),
+    ])
+
+    def __init__(self, capacity=4096):
+        self._data = np.empty(capacity, dtype=self.POINT_DTYPE)
+        self._count = 0
+        self._layer_counts = {}  # round(height, 1) -> number of points
+
+    def __len__(self):
+        return self._count
+
+    def __iter__(self):
+        for rec in self._data[:self._count]:
+            yield tuple(rec)
+
+    def __getitem__(self, idx):
+        if isinstance(idx, slice):
+            return [tuple(rec) for rec in self._data[:self._count][idx]]
+        return tuple(self._data[:self._count][idx])
+
+    def append(self, x, y, z, angle, height):
+        if self._count == len(self._data):
+            grown = np.empty(len(self._data) * 2, dtype=self.POINT_DTYPE)
+            grown[:self._count] = self._data[:self._count]
+            self._data = grown
+        self._data[self._count] = (x, y, z, angle, height)
+        self._count += 1
+        key = round(height, 1)
+        self._layer_counts[key] = self._layer_counts.get(key, 0) + 1
+
+    def extend(self, x, y, z, angle, height):
+        """Append whole arrays of points at once (one shared height).
+
+        Vectorized counterpart of append() for burst conversions: grows the
+        array once, assigns each column with a single slice, and bumps the
+        layer bucket one time instead of per point.
+        """
+        n = len(x)
+        if n == 0:
+            return
+        needed = self._count + n
+        if needed > len(self._data):
+            capacity = len(self._data)
+            while capacity < needed:
+                capacity *= 2
+            grown = np.empty(capacity, dtype=self.POINT_DTYPE)
+            grown[:self._count] = self._data[:self._count]
+            self._data = grown
+        block = self._data[self._count:needed]
+        block['x'] = x
+        block['y'] = y
+        block['z'] = z
+        block['angle'] = angle
+        block['height'] = height
+        self._count = needed
+        key = round(float(height), 1)
+        self._layer_counts[key] = self._layer_counts.get(key, 0) + n
+
+    def clear(self):
+        self._count = 0
+        self._layer_counts = {}
+
+    def points(self):
+        """Structured-array view of the stored points (no copy)."""
+        return self._data[:self._count]
+
+    def layer_count(self, height, tol=0.1):
+        """Points whose height is within tol of the given height.
+
+        Answered from the 0.1mm bucket index (3 dict lookups) instead of
+        scanning every stored point. Points within 0.05mm of a bucket edge
+        may count into the neighbouring bucket - irrelevant for the layer
+        progress display this feeds, which compares heights 2mm apart.
+        """
+        keys = {round(height - tol, 1), round(height, 1), round(height + tol, 1)}
+        return sum(self._layer_counts.get(k, 0) for k in keys)
+
+
+def build_mesh_from_points(points, progress_cb=None):
+    """Generate mesh (vertices and faces) from scan points.
+
+    points is any sequence of (x, y, z, angle, height) records - the live
+    ScanPointStore or a bare structured array. Module-level (no GUI state)
+    so the export worker process can run it; progress_cb, when given, is
+    called with a short status string every few layers.
+    """
+    # Group points by layer (height)
+    layer_groups = {}
+    for idx, point_data in enumerate(points):
+        if len(point_data) >= 5:
+            x, y, z, angle, height = point_data[0], point_data[1], point_data[2], point_data[3], point_data[4]
+            height_key = round(float(height), 1)
+            if height_key not in layer_groups:
+                layer_groups[height_key] = []
+            layer_groups[height_key].append((x, y, z, angle, idx))
+
+    sorted_heights = sorted(layer_groups.keys())
+    vertices = []
+    faces = []
+    vertex_index_map = {}  # Map (x, y, z) -> vertex index
+
+    def get_vertex_index(x, y, z):
+        """Get or create vertex index"""
+        key = (round(x, 3), round(y, 3), round(z, 3))
+        if key not in vertex_index_map:
+            vertex_index_map[key] = len(vertices)
+            vertices.append([x, y, z])
+        return vertex_index_map[key]
+
+    # Create mesh between adjacent layers
+    for layer_idx in range(len(sorted_heights) - 1):
+        if progress_cb and (layer_idx % 8) == 0:
+            progress_cb(f"layer {layer_idx + 1}/{len(sorted_heights) - 1}")
+        height1 = sorted_heights[layer_idx]
+        height2 = sorted_heights[layer_idx + 1]
+
+        layer1_points = sorted(layer_groups[height1], key=lambda p: p[3])
+        layer2_points = sorted(layer_groups[height2], key=lambda p: p[3])
+
+        # Connect points between layers
+        for i in range(len(layer1_points)):
+            x1, y1, z1, angle1, idx1 = layer1_points[i]
+            next_i = (i + 1) % len(layer1_points)
+            x1_next, y1_next, z1_next, angle1_next, idx1_next = layer1_points[next_i]
+
+            # Find closest points in layer2
+            min_angle_diff = 360
+            closest_j = -1
+            for j in range(len(layer2_points)):
+                x2, y2, z2, angle2, idx2 = layer2_points[j]
+                angle_diff = abs(angle2 - angle1)
+                if angle_diff > 180:
+                    angle_diff = 360 - angle_diff
+                if angle_diff < min_angle_diff:
+                    min_angle_diff = angle_diff
+                    closest_j = j
+
+            if closest_j >= 0 and min_angle_diff < 15:
+                x2, y2, z2, angle2, idx2 = layer2_points[closest_j]
+                next_j = (closest_j + 1) % len(layer2_points)
+                x2_next, y2_next, z2_next, angle2_next, idx2_next = layer2_points[next_j]
+
+                # Check distances to prevent connecting distant points
+                dist1 = np.sqrt((x2 - x1)**2 + (y2 - y1)**2 + (z2 - z1)**2)
+                dist2 = np.sqrt((x1_next - x1)**2 + (y1_next - y1)**2 + (z1_next - z1)**2)
+                dist3 = np.sqrt((x2_next - x2)**2 + (y2_next - y2)**2 + (z2_next - z2)**2)
+
+                if dist1 < 50 and dist2 < 50 and dist3 < 50:
+                    # Create quad as two triangles
+                    v1 = get_vertex_index(x1, y1, z1)
+                    v2 = get_vertex_index(x2, y2, z2)
+                    v3 = get_vertex_index(x1_next, y1_next, z1_next)
+                    v4 = get_vertex_index(x2_next, y2_next, z2_next)
+
+                    # Triangle 1: v1, v2, v3
+                    faces.append([v1, v2, v3])
+                    # Triangle 2: v2, v4, v3
+                    faces.append([v2, v4, v3])
+
+    # Add top and bottom caps
+    if len(sorted_heights) >= 1:
+        # Bottom cap
+        bottom_layer = sorted(layer_groups[sorted_heights[0]], key=lambda p: p[3])
+        if len(bottom_layer) >= 3:
+            center_x = np.mean([p[0] for p in bottom_layer])
+            center_y = np.mean([p[1] for p in bottom_layer])
+            center_z = sorted_heights[0]
+            center_idx = get_vertex_index(center_x, center_y, center_z)
+
+            for i in range(len(bottom_layer)):
+                x1, y1, z1, _, _ = bottom_layer[i]
+                next_i = (i + 1) % len(bottom_layer)
+                x2, y2, z2, _, _ = bottom_layer[next_i]
+                v1 = get_vertex_index(x1, y1, z1)
+                v2 = get_vertex_index(x2, y2, z2)
+                faces.append([center_idx, v1, v2])
+
+        # Top cap
+        top_layer = sorted(layer_groups[sorted_heights[-1]], key=lambda p: p[3])
+        if len(top_layer) >= 3:
+            center_x = np.mean([p[0] for p in top_layer])
+            center_y = np.mean([p[1] for p in top_layer])
+            center_z = sorted_heights[-1]
+            center_idx = get_vertex_index(center_x, center_y, center_z)
+
+            for i in range(len(top_layer)):
+                x1, y1, z1, _, _ = top_layer[i]
+                next_i = (i + 1) % len(top_layer)
+                x2, y2, z2, _, _ = top_layer[next_i]
+                v1 = get_vertex_index(x1, y1, z1)
+                v2 = get_vertex_index(x2, y2, z2)
+                faces.append([center_idx, v2, v1])  # Reverse order for top
+
+    return np.array(vertices), np.array(faces)
+
+
+def _mesh_export_worker(shm_name, count, filename, progress_queue):
+    """Worker-process entry point for STL export.
+
+    Attaches to the shared-memory snapshot of the point store, reconstructs
+    the mesh, and writes the STL with the streaming writer - all outside the
+    GUI process, so scanning and the Tk event loop keep running at full rate.
+    Reports back over the queue: ("progress", text) while working, then one
+    final ("done", n_faces) or ("error", message).
+    """
+    shm = shared_memory.SharedMemory(name=shm_name)
+    try:
+        points = np.ndarray((count,), dtype=ScanPointStore.POINT_DTYPE,
+                            buffer=shm.buf)
+        vertices, faces = build_mesh_from_points(
+            points, progress_cb=lambda text: progress_queue.put(("progress", text)))
+        if len(faces) == 0:
+            progress_queue.put(("error", "mesh came out empty (points too sparse?)"))
+            return
+        progress_queue.put(("progress", f"writing {len(faces)} triangles"))
+        from stl_generator import write_stl_binary
+        write_stl_binary(filename, vertices, faces)
+        progress_queue.put(("done", len(faces)))
+    except Exception as e:
+        progress_queue.put(("error", str(e)))
+    finally:
+        shm.close()
+
 
 class ScannerGUI:
+    # Steps-per-mm of the firmware axes (matches $100-$102 defaults in
+    # firmware/defaults/defaults_generic.h). Used to convert the integer
+    # SPos status reports ($10 bit 5) back to mm on the host side.
+    GRBL_STEPS_PER_MM = (55.55555556, 250.0, 250.0)
+
     def __init__(self, root):
         self.root = root
         self.root.title("3D Scanner Control")
@@ -46,7 +333,7 @@ class ScannerGUI:
         self.serial_conn = None
         self.is_connected = False
         self.is_scanning = False
-        self.scan_data = []
+        self.scan_data = ScanPointStore()
         self.current_layer = 0
         self.current_step = 0
         self.current_angle = 0.0  # Current rotation angle in degrees
@@ -66,6 +353,52 @@ class ScannerGUI:
         self.current_z_pos = 0.0  # GRBL Z position in mm (unused)
         self.grbl_state = "Idle"  # GRBL state
 
+        # Incremental (live) renderer state - see request_live_update()
+        self._live_scatter = None     # persistent scatter artist for the live view
+        self._viz_background = None   # cached background for blitting
+        self._viz_bounds = None       # current live axes bounds (grow-only)
+        self._viz_dirty = False       # points arrived since last live refresh
+        self._viz_timer_running = False
+        self._viz_blit_ok = True      # falls back to draw_idle() if blitting fails
+
+        # Binary telemetry RX state - last frame sequence number seen, for
+        # detecting dropped frames (see process_telemetry_frame)
+        self._telem_last_seq = None
+
+        # Per-revolution sin/cos tables, keyed by points_per_rev
+        # (see _rev_trig_tables)
+        self._trig_cache = {}
+
+        # Out-of-process STL export state (see export_stl / _poll_export)
+        self._export_proc = None
+        self._export_shm = None
+        self._export_queue = None
+
+        # Raw sample log (.scan file) - opened for the duration of a scan so
+        # a crash mid-session loses seconds, not the whole cloud
+        self._scan_writer = None
+
+        # Multi-revolution accumulation: (points_per_rev x R) sample matrix
+        # for the layer being accumulated, None when the mode is off
+        # (see store_accumulated_layer)
+        self._accum_bins = None
+
+        # Scan resume: checkpoint dict loaded from a .resume sidecar when the
+        # operator chooses to continue an interrupted scan (see start_scan_up)
+        self._resume_info = None
+
+        # Per-point pipeline timing (see _finish_point_timings): one dict per
+        # scan point with the stage breakdown, exported to CSV at scan end
+        self._point_timings = []
+        self._last_fw_timing_us = None  # (receipt, completion) from TIMING:
+
+        # Character-counting streamer state (see stream_gcode_commands):
+        # byte length of each line awaiting its ok/error, and their sum
+        self._cc_pending = deque()
+        self._cc_inflight = 0
+        self._cc_lock = threading.Lock()
+        self._cc_ack = threading.Event()
+
         # Create GUI
         self.create_widgets()
 
@@ -150,6 +483,43 @@ class ScannerGUI:
         self.scan_layer_height_var = tk.StringVar(value="2.0")
         ttk.Entry(geometry_frame, textvariable=self.scan_layer_height_var, width=8).grid(row=2, column=3, sticky=tk.W, padx=2)
 
+        # Adaptive angular sampling (see scan_rotation_loop): coarsen the
+        # step on flat arcs, back to the base grid near edges
+        self.adaptive_scan_var = tk.BooleanVar(value=False)
+        ttk.Checkbutton(geometry_frame, text="Adaptive sampling",
+                        variable=self.adaptive_scan_var).grid(row=2, column=0, columnspan=2, sticky=tk.W, pady=1)
+
+        ttk.Label(geometry_frame, text="Bước tối đa (x):").grid(row=4, column=0, sticky=tk.W, pady=1)
+        self.adaptive_max_step_var = tk.StringVar(value="4")
+        ttk.Entry(geometry_frame, textvariable=self.adaptive_max_step_var, width=8).grid(row=4, column=1, sticky=tk.W, padx=2)
+
+        ttk.Label(geometry_frame, text="Ngưỡng cạnh (mm/°):").grid(row=4, column=2, sticky=tk.W, padx=(10,0), pady=1)
+        self.adaptive_thresh_var = tk.StringVar(value="1.0")
+        ttk.Entry(geometry_frame, textvariable=self.adaptive_thresh_var, width=8).grid(row=4, column=3, sticky=tk.W, padx=2)
+
+        # Multi-revolution accumulation (see store_accumulated_layer): scan
+        # each layer R times, reduce per angle before storing
+        ttk.Label(geometry_frame, text="Số vòng/lớp (R):").grid(row=5, column=0, sticky=tk.W, pady=1)
+        self.accum_revs_var = tk.StringVar(value="1")
+        ttk.Entry(geometry_frame, textvariable=self.accum_revs_var, width=8).grid(row=5, column=1, sticky=tk.W, padx=2)
+
+        ttk.Label(geometry_frame, text="Reduce:").grid(row=5, column=2, sticky=tk.W, padx=(10,0), pady=1)
+        self.accum_reduce_var = tk.StringVar(value="median")
+        ttk.Combobox(geometry_frame, textvariable=self.accum_reduce_var,
+                     values=("median", "trimmed mean"), width=12,
+                     state="readonly").grid(row=5, column=3, sticky=tk.W, padx=2)
+
+        # Post-move settle delay (see measure_settle_delay): the dominant
+        # per-point cost per ANALYSIS_VL53L0X_SPEED.md; auto mode measures
+        # the minimal value for this session's fixture at scan start
+        ttk.Label(geometry_frame, text="Settle (s):").grid(row=6, column=0, sticky=tk.W, pady=1)
+        self.settle_delay_var = tk.StringVar(value="0.5")
+        ttk.Entry(geometry_frame, textvariable=self.settle_delay_var, width=8).grid(row=6, column=1, sticky=tk.W, padx=2)
+
+        self.settle_auto_var = tk.BooleanVar(value=False)
+        ttk.Checkbutton(geometry_frame, text="Auto settle",
+                        variable=self.settle_auto_var).grid(row=6, column=2, columnspan=2, sticky=tk.W, padx=(10,0), pady=1)
+
         # Scan controls
         scan_frame = ttk.Frame(control_frame)
         scan_frame.grid(row=4, column=0, columnspan=3, pady=5, sticky=(tk.W, tk.E))
@@ -245,6 +615,9 @@ class ScannerGUI:
         self.canvas = FigureCanvasTkAgg(self.fig, canvas_container)
         self.canvas.draw()
         self.canvas.get_tk_widget().pack(side=tk.TOP, fill=tk.BOTH, expand=True)
+        # Recapture the blit background after any full draw (e.g. the user
+        # rotating the view), so the live scatter composites onto fresh axes
+        self.canvas.mpl_connect('draw_event', self._on_canvas_draw)
 
         # Toolbar
         toolbar = NavigationToolbar2Tk(self.canvas, canvas_container)
@@ -523,6 +896,7 @@ class ScannerGUI:
             try:
                 self.serial_conn = serial.Serial(port, 115200, timeout=2, write_timeout=2)  # Increased timeout to 2s
                 time.sleep(2)
+                self._cc_reset()  # fresh session - no bytes in flight
                 self.is_connected = True
                 self.connect_btn.config(text="Disconnect")
                 self.status_label.config(text="Status: Connected", foreground="green")
@@ -571,8 +945,10 @@ class ScannerGUI:
                 self.serial_thread = threading.Thread(target=self.read_serial, daemon=True)
                 self.serial_thread.start()
 
-                # Start status query thread
+                # Start status query thread (fallback only - firmware pushes
+                # status itself once $S is accepted, see status_query_loop)
                 self.status_query_active = True
+                self.last_status_time = time.time()
                 self.status_query_thread = threading.Thread(target=self.status_query_loop, daemon=True)
                 self.status_query_thread.start()
 
@@ -586,6 +962,10 @@ class ScannerGUI:
                     time.sleep(0.5)
                     self.send_serial_command("?\n", log=True)
                     self.send_serial_command("$X\n", log=True)
+                    # Enable firmware auto-push: GRBL sends a status report every
+                    # 200ms by itself, so we stop polling '?' and the serial link
+                    # carries mostly measurement data during scans
+                    self.send_serial_command("$S=200\n", log=True)
                     self.log_info("GRBL initialized - watching for position updates...")
             except Exception as e:
                 messagebox.showerror("Error", f"Failed to connect: {str(e)}")
@@ -649,10 +1029,9 @@ class ScannerGUI:
         """Send command to serial and log it"""
         if self.serial_conn:
             try:
-                # Clear input buffer before sending to prevent timeout
-                if self.serial_conn.in_waiting > 0:
-                    self.serial_conn.reset_input_buffer()
-                
+                # NOTE: no reset_input_buffer() here - the bulk reader in
+                # read_serial() keeps RX drained, and discarding pending bytes
+                # would cut ASCII lines and binary frames in half
                 # Clear output buffer if it's getting full (prevent write timeout)
                 try:
                     if hasattr(self.serial_conn, 'out_waiting') and self.serial_conn.out_waiting > 100:
@@ -699,34 +1078,189 @@ class ScannerGUI:
                 self.log_info(f"Error sending command: {str(e)}")
 
     def status_query_loop(self):
-        """Periodically send status query (?) to GRBL"""
+        """Fallback status query - firmware normally pushes status itself ($S=200)
+
+        Only sends '?' if no status report has arrived for a while, which
+        covers older firmware that rejects the $S command. With auto-push
+        active this loop stays silent and the link is free for scan data.
+        """
         while self.status_query_active and self.is_connected:
             try:
                 if self.serial_conn:
-                    self.send_serial_command("?\n", log=False)
+                    if time.time() - getattr(self, 'last_status_time', 0) > 1.0:
+                        self.send_serial_command("?\n", log=False)
                 time.sleep(0.2)
             except Exception as e:
                 if self.status_query_active:
                     self.log_info(f"Status query error: {str(e)}")
                 break
 
+    RX_CHUNK_MAX = 4096      # largest single read per service pass
+    RX_BUFFER_LIMIT = 65536  # give up and resync if no boundary found by here
+
     def read_serial(self):
-        """Read data from serial port in background thread"""
+        """Service the serial port in bulk chunks (background thread).
+
+        Reads in_waiting-sized chunks into a bytearray and pops complete
+        messages off the front with _extract_messages() - both ASCII lines
+        and 0xA5 binary telemetry frames. One read() per pass instead of a
+        readline() per message: at high sample rates the per-line Python
+        overhead, not the AVR, was the throughput ceiling. This thread never
+        touches Tk; handlers forward UI work via root.after as before.
+        """
+        buf = bytearray()
         while self.is_connected and self.serial_conn:
             try:
-                if self.serial_conn.in_waiting > 0:
-                    line = self.serial_conn.readline().decode('utf-8', errors='ignore').strip()
-                    if line:
-                        # CALLBACK: Log ALL serial data to console
-                        self.on_serial_received(line)
+                n = self.serial_conn.in_waiting
+                if n > 0:
+                    buf += self.serial_conn.read(min(n, self.RX_CHUNK_MAX))
+                    self._extract_messages(buf)
+                    if len(buf) > self.RX_BUFFER_LIMIT:
+                        # No line/frame boundary in 64KB - stream is garbage
+                        # (wrong baud?), drop it and resync
+                        del buf[:]
                 else:
-                    # If no data waiting, clear any stale data in buffer periodically
                     time.sleep(0.01)  # Small delay to prevent CPU spinning
             except Exception as e:
                 if self.is_connected:
                     self.log_info(f"Serial error: {str(e)}")
                 break
 
+    def _extract_messages(self, buf):
+        """Pop every complete message off the front of buf (in place).
+
+        Scans with a memoryview so nothing is copied until a whole message
+        is known to be present; leftover partial bytes stay in buf for the
+        next chunk. Binary frames are CRC-checked here, ASCII lines go to
+        on_serial_received() unchanged.
+        """
+        view = memoryview(buf)
+        pos = 0
+        end = len(buf)
+        try:
+            while pos < end:
+                if buf[pos] == TELEM_SYNC_BYTE:
+                    # [sync][seq][type][length][payload...][crc8]
+                    if end - pos < 5:
+                        break  # header not complete yet
+                    length = buf[pos + 3]
+                    if length > TELEM_MAX_PAYLOAD:
+                        pos += 1  # bogus length: sync byte was line noise
+                        continue
+                    total = 5 + length
+                    if end - pos < total:
+                        break  # payload not complete yet
+                    # CRC covers seq+type+length+payload, not the sync byte
+                    if crc8(view[pos + 1:pos + 4 + length]) == buf[pos + 4 + length]:
+                        self.process_telemetry_frame(
+                            buf[pos + 2], buf[pos + 1],
+                            bytes(view[pos + 4:pos + 4 + length]))
+                        pos += total
+                    else:
+                        # Corrupt frame: ask for it again and rescan from the
+                        # next byte in case the sync byte itself was noise
+                        self._telem_request_resend(buf[pos + 1])
+                        pos += 1
+                    continue
+                nl = buf.find(b'\n', pos)
+                if nl < 0:
+                    break  # partial line - wait for more bytes
+                line = bytes(view[pos:nl]).decode('utf-8', errors='ignore').strip()
+                pos = nl + 1
+                if line:
+                    # CALLBACK: Log ALL serial data to console
+                    self.on_serial_received(line)
+        finally:
+            view.release()
+        if pos:
+            del buf[:pos]
+
+    def _telem_request_resend(self, seq):
+        """Ask the firmware to replay frame seq from its history ring."""
+        try:
+            self.send_serial_command(f"RESEND={seq}\n", log=False)
+        except Exception:
+            pass
+
+    @staticmethod
+    def _decode_zigzag_deltas(payload):
+        """Decode a TELEM_TYPE_DELTA payload into absolute distances.
+
+        First two bytes are an absolute uint16 keyframe; each following
+        sample is a zigzag LEB128 varint delta against the previous one.
+        """
+        if len(payload) < 2:
+            return []
+        value = payload[0] | (payload[1] << 8)
+        samples = [value]
+        shift = 0
+        acc = 0
+        for b in payload[2:]:
+            acc |= (b & 0x7F) << shift
+            if b & 0x80:
+                shift += 7
+                continue
+            delta = (acc >> 1) ^ -(acc & 1)  # un-zigzag
+            value = (value + delta) & 0xFFFF
+            samples.append(value)
+            shift = 0
+            acc = 0
+        return samples
+
+    def process_telemetry_frame(self, frame_type, seq, payload):
+        """Dispatch one CRC-verified binary telemetry frame.
+
+        Tracks the sequence number; a gap means frames were lost (firmware
+        drops telemetry rather than stall motion when its TX buffer fills),
+        so the missing ones are requested from the firmware's history ring.
+        """
+        last = self._telem_last_seq
+        if last is not None:
+            expected = (last + 1) & 0xFF
+            if seq != expected:
+                gap = (seq - expected) & 0xFF
+                # History holds only a few frames - requesting more is futile
+                for missing in range(expected, expected + min(gap, 4)):
+                    self._telem_request_resend(missing & 0xFF)
+        self._telem_last_seq = seq
+
+        try:
+            if frame_type in (TELEM_TYPE_VL53L0X, TELEM_TYPE_VL53L1, TELEM_TYPE_FILTERED):
+                (distance,) = struct.unpack('<H', payload)
+                if frame_type == TELEM_TYPE_VL53L1:
+                    self.vl53_sensor_type = "VL53L1"
+                self.update_vl53_display(distance)
+            elif frame_type == TELEM_TYPE_SAMPLE_T:
+                distance, _micros = struct.unpack('<HI', payload)
+                self.update_vl53_display(distance)
+            elif frame_type == TELEM_TYPE_DUAL:
+                distance_a, _distance_b = struct.unpack('<HH', payload)
+                self.update_vl53_display(distance_a)
+            elif frame_type in (TELEM_TYPE_SCAN, TELEM_TYPE_SCAN_H):
+                if frame_type == TELEM_TYPE_SCAN:
+                    _x_steps, distance = struct.unpack('<iH', payload)
+                else:
+                    _x_steps, _y_steps, distance = struct.unpack('<iiH', payload)
+                self.update_vl53_display(distance)
+            elif frame_type == TELEM_TYPE_SAMPLE_P:
+                distance, _x_steps, _y_steps = struct.unpack('<Hii', payload)
+                self.update_vl53_display(distance)
+            elif frame_type == TELEM_TYPE_DELTA:
+                samples = self._decode_zigzag_deltas(payload)
+                if samples:
+                    if self.is_scanning:
+                        # Whole burst becomes scan points in one vectorized
+                        # pass - see process_scan_burst
+                        self.process_scan_burst(samples)
+                    self.update_vl53_display(samples[-1])
+            elif frame_type == TELEM_TYPE_EXT:
+                distance, status, _signal, _ambient = struct.unpack('<HBHH', payload)
+                if status == 11:  # 11 = valid range (VL53L0X device status)
+                    self.update_vl53_display(distance)
+            # Unknown types: CRC was valid so the stream is in sync - ignore
+        except struct.error:
+            pass  # short payload from a newer/older firmware - ignore
+
     def on_serial_received(self, line):
         """
         CALLBACK 1: Called for EVERY line received from serial port (BEFORE parsing)
@@ -763,17 +1297,10 @@ class ScannerGUI:
 
     def process_serial_data(self, line):
         """Process incoming serial data from GRBL firmware"""
-        # Clear input buffer after processing to prevent overflow
-        if self.serial_conn and self.serial_conn.in_waiting > 100:  # If buffer has more than 100 bytes
-            try:
-                # Read and discard excess data
-                while self.serial_conn.in_waiting > 50:
-                    self.serial_conn.read(self.serial_conn.in_waiting)
-            except:
-                pass
-        
         # Handle GRBL status reports: <Idle|MPos:0.000,0.000,0.000|FS:0,0>
         if line.startswith("<"):
+            # Mark auto-push alive so status_query_loop doesn't fall back to polling
+            self.last_status_time = time.time()
             # ============================================
             # CONSOLE LOG: Confirm we caught GRBL status
             # ============================================
@@ -781,16 +1308,30 @@ class ScannerGUI:
             self.parse_grbl_status(line)
             return
 
-        # Handle GRBL responses
+        # Handle GRBL responses - every ok/error retires one streamed line
+        # from the character-counting byte budget
         if line.startswith("ok"):
+            self._cc_acknowledge()
             return
         elif line.startswith("error:"):
+            self._cc_acknowledge()
             self.log_info(f"GRBL Error: {line}")
             return
         elif line.startswith("ALARM:"):
             self.log_info(f"GRBL Alarm: {line}")
             return
 
+        # Firmware timing line (TIMING=1 mode): command-receipt and
+        # measurement-completion timestamps in firmware micros - paired with
+        # host timestamps by the scan loop (see _finish_point_timings)
+        if line.startswith("TIMING:"):
+            try:
+                req_us, done_us = line[7:].split(",")
+                self._last_fw_timing_us = (int(req_us), int(done_us))
+            except ValueError:
+                pass
+            return
+
         # Handle VL53L0X/VL53L1 distance reading
         # Format: VL53L1_DISTANCE:138 hoặc VL53L0X_DISTANCE:138
         if "VL53L0X" in line.upper() or "VL53L1" in line.upper() or line.startswith("DISTANCE:"):
@@ -855,6 +1396,28 @@ class ScannerGUI:
             clean = status_line.strip("<>")
             print(f"[PARSE] Step 1 result: '{clean}'")
 
+            # Step 2a: Firmware compact integer mode ($10 bit 5) sends raw
+            # step counts as SPos instead of float MPos - the firmware skips
+            # the steps->mm float math so we do it here, then rewrite the
+            # line as MPos so the rest of the parser works unchanged
+            if "SPos:" in clean and "MPos:" not in clean:
+                import re
+                print(f"[PARSE] Step 2a: Found 'SPos:' (integer mode), converting steps to mm...")
+                spos_start = clean.find("SPos:") + 5
+                rest = clean[spos_start:]
+                match = re.search(r",[A-Za-z]", rest)
+                spos_str = rest[:match.start()] if match else rest
+                try:
+                    steps = [int(v) for v in spos_str.split(",")]
+                    mm_values = [s / spm for s, spm in zip(steps, self.GRBL_STEPS_PER_MM)]
+                    mpos_str = ",".join(f"{v:.3f}" for v in mm_values)
+                    clean = clean.replace("SPos:" + spos_str, "MPos:" + mpos_str)
+                    print(f"[PARSE] Step 2a: Converted SPos {steps} -> MPos '{mpos_str}'")
+                except ValueError as e:
+                    print(f"[PARSE] ✗ ERROR converting SPos values '{spos_str}': {e}")
+                    print(f"{'='*70}\n")
+                    return
+
             # Step 2: Find MPos section
             # GRBL 0.9j format: Idle,MPos:X,Y,Z,WPos:X,Y,Z
             print(f"[PARSE] Step 2: Looking for 'MPos:' in string...")
@@ -1162,20 +1725,74 @@ class ScannerGUI:
 
         return commands
 
-    def send_gcode_commands(self, commands, delay=0.1):
-        """Send multiple G-code commands sequentially with delay to prevent buffer overflow"""
+    # Character-counting flow control (the standard grbl streaming protocol):
+    # instead of sleeping a fixed delay per line and letting the firmware's
+    # RX buffer and planner queue run dry, track how many bytes are sitting
+    # unacknowledged in the 128-byte RX ring and only block when the next
+    # line wouldn't fit. Several moves stay in flight, so planner junction
+    # lookahead can blend consecutive segments into continuous motion.
+
+    CC_RX_BUDGET = 127  # firmware RX_BUFFER_SIZE (serial.h) minus the ring's
+                        # one reserved slot
+
+    def _cc_acknowledge(self):
+        """One ok/error arrived: the firmware freed that line's bytes."""
+        with self._cc_lock:
+            if self._cc_pending:
+                self._cc_inflight -= self._cc_pending.popleft()
+        self._cc_ack.set()
+
+    def _cc_reset(self):
+        """Forget all in-flight bytes (connect, soft reset, lost acks)."""
+        with self._cc_lock:
+            self._cc_pending.clear()
+            self._cc_inflight = 0
+        self._cc_ack.set()
+
+    def send_gcode_commands(self, commands, delay=None, timeout=10.0):
+        """Send G-code lines with character-counting flow control.
+
+        delay is accepted for call-site compatibility but no longer sleeps
+        per line - pacing comes from the firmware's own acks. Blocks only
+        while the next line wouldn't fit in the firmware's RX buffer; on ack
+        starvation (soft reset ate the responses) the counter resets after
+        timeout instead of deadlocking the scan thread.
+        """
         if not self.serial_conn:
             return
 
         for cmd in commands:
+            size = len(cmd if isinstance(cmd, bytes) else cmd.encode())
+            deadline = time.time() + timeout
+            while True:
+                with self._cc_lock:
+                    if self._cc_inflight + size <= self.CC_RX_BUDGET:
+                        self._cc_pending.append(size)
+                        self._cc_inflight += size
+                        break
+                    self._cc_ack.clear()
+                self._cc_ack.wait(0.25)
+                if time.time() > deadline:
+                    self.log_info("Streamer: ack timeout, resetting byte counter")
+                    self._cc_reset()
             try:
                 self.send_serial_command(cmd, log=True)
-                time.sleep(delay)  # Increased delay to prevent timeout
             except Exception as e:
                 # Log but continue with remaining commands
                 if "timeout" not in str(e).lower():
                     self.log_info(f"Command error (continuing): {e}")
 
+    def wait_gcode_acknowledged(self, timeout=10.0):
+        """Block until every streamed line has its ok/error (planner fed)."""
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            with self._cc_lock:
+                if not self._cc_pending:
+                    return True
+                self._cc_ack.clear()
+            self._cc_ack.wait(0.25)
+        return False
+
     def on_speed_change(self, value):
         """Update speed label"""
         speed_float = max(1.0, float(value))
@@ -1660,6 +2277,142 @@ class ScannerGUI:
             self.log_info(f"Error calculating point: {e}")
             return None
 
+    def _rev_trig_tables(self, points_per_rev):
+        """Cached cos/sin tables for one revolution's fixed angular grid.
+
+        A revolution always samples the same points_per_rev angles, so the
+        trig is computed once per grid size instead of per point.
+        """
+        tables = self._trig_cache.get(points_per_rev)
+        if tables is None:
+            angles = np.radians(np.arange(points_per_rev) * (360.0 / points_per_rev))
+            tables = (np.cos(angles), np.sin(angles))
+            self._trig_cache[points_per_rev] = tables
+        return tables
+
+    def convert_scan_batch(self, distances_mm, start_index, points_per_rev):
+        """Vectorized calculate_point_from_scan() for a burst of samples.
+
+        distances_mm are consecutive samples on the revolution grid starting
+        at grid index start_index. Applies the same validity filters and the
+        sensor-offset geometry (r = center_distance - distance) using the
+        cached per-revolution sin/cos tables. Returns (x_mm, y_mm, angle_deg)
+        arrays with the invalid samples already dropped, or None if nothing
+        survives the filters.
+        """
+        try:
+            center_cm = float(self.center_distance_var.get())
+            disk_cm = float(self.disk_radius_var.get())
+        except Exception:
+            return None
+        cos_t, sin_t = self._rev_trig_tables(points_per_rev)
+        d_cm = np.asarray(distances_mm, dtype=np.float64) / 10.0
+        idx = (start_index + np.arange(len(d_cm), dtype=np.intp)) % points_per_rev
+        # Same filters as the scalar path: positive reading, within the ring
+        # the turntable geometry allows (center ± disk radius)
+        valid = (d_cm > 0.0) & (d_cm >= center_cm - disk_cm) & (d_cm <= center_cm + disk_cm)
+        if not valid.any():
+            return None
+        radius_mm = (center_cm - d_cm[valid]) * 10.0
+        idx = idx[valid]
+        x_mm = radius_mm * cos_t[idx]
+        y_mm = radius_mm * sin_t[idx]
+        angle_deg = idx * (360.0 / points_per_rev)
+        return x_mm, y_mm, angle_deg
+
+    def process_scan_burst(self, distances_mm):
+        """Store a burst of distance samples as scan points in one shot.
+
+        Fed by the delta-compressed telemetry frames: the whole burst is
+        converted with one vectorized pass and appended with one
+        ScanPointStore.extend(), which is what makes the firmware's
+        burst-read command actually pay off host-side.
+        """
+        try:
+            points_per_rev = max(1, int(self.points_per_revolution_var.get()))
+        except Exception:
+            points_per_rev = 36
+        angle_step = 360.0 / points_per_rev
+        start_index = int(round(self.current_angle / angle_step)) % points_per_rev
+        z_height = self.current_y_pos
+        if self._scan_writer is not None:
+            try:
+                n = len(distances_mm)
+                idx = (start_index + np.arange(n)) % points_per_rev
+                self._scan_writer.append_many(
+                    np.full(n, time.time()), idx * angle_step,
+                    np.full(n, z_height),
+                    np.asarray(distances_mm, dtype=np.float64),
+                    np.zeros(n, dtype=np.uint32))
+            except Exception as e:
+                self.log_info(f"Raw scan file write failed, disabling: {e}")
+                self._scan_writer = None
+        if self._accum_bins is not None and len(self._accum_bins) == points_per_rev:
+            # Accumulation mode: bin the burst by angular index instead of
+            # storing directly; each sample takes its angle's first free
+            # revolution slot and the reduction runs after the last rev
+            bins = self._accum_bins
+            for k, d in enumerate(np.asarray(distances_mm, dtype=np.float64)):
+                row = bins[(start_index + k) % points_per_rev]
+                free = np.where(np.isnan(row))[0]
+                if len(free):
+                    row[free[0]] = d
+            return
+        converted = self.convert_scan_batch(distances_mm, start_index, points_per_rev)
+        if converted is None:
+            return
+        x_mm, y_mm, angle_deg = converted
+        z_mm = np.full(len(x_mm), z_height)
+        self.scan_data.extend(x_mm, y_mm, z_mm, angle_deg, z_height)
+        self.root.after(0, self.request_live_update)
+
+    @staticmethod
+    def reduce_angle_bins(bins, method="median"):
+        """Reduce a (points_per_rev x R) sample matrix to one distance per
+        angle, vectorized across all angles at once.
+
+        Missing samples are NaN. "median" takes the per-angle median of the
+        valid samples; "trimmed mean" drops the top and bottom quarter of
+        each angle's valid samples before averaging, which shrugs off the
+        occasional wild reading better than a plain mean. Angles with no
+        valid sample in any revolution come back NaN.
+        """
+        bins = np.asarray(bins, dtype=np.float64)
+        ordered = np.sort(bins, axis=1)  # NaN sorts to the end of each row
+        counts = np.sum(~np.isnan(bins), axis=1)
+        if method == "trimmed mean":
+            trim = counts // 4
+            j = np.arange(bins.shape[1])
+            keep = (j >= trim[:, None]) & (j < (counts - trim)[:, None])
+            total = np.where(keep, ordered, 0.0).sum(axis=1)
+            kept = keep.sum(axis=1)
+            return np.where(kept > 0, total / np.maximum(kept, 1), np.nan)
+        # Median of the valid prefix of each sorted row (no nanmedian so
+        # all-NaN rows stay silent)
+        safe = np.maximum(counts, 1)
+        lo = np.take_along_axis(ordered, ((safe - 1) // 2)[:, None], axis=1)[:, 0]
+        hi = np.take_along_axis(ordered, (safe // 2)[:, None], axis=1)[:, 0]
+        return np.where(counts > 0, 0.5 * (lo + hi), np.nan)
+
+    def store_accumulated_layer(self, bins, points_per_rev, z_height, method):
+        """Reduce an accumulated layer and store one point per angle.
+
+        Runs the vectorized reduction over the (points_per_rev x R) bins,
+        then pushes the surviving angles through the same batch conversion
+        the burst path uses. Returns the number of points stored.
+        """
+        reduced = self.reduce_angle_bins(bins, method)
+        # NaN -> 0 so the missing angles fail the d > 0 validity filter
+        distances = np.where(np.isnan(reduced), 0.0, reduced)
+        converted = self.convert_scan_batch(distances, 0, points_per_rev)
+        if converted is None:
+            return 0
+        x_mm, y_mm, angle_deg = converted
+        self.scan_data.extend(x_mm, y_mm, np.full(len(x_mm), z_height),
+                              angle_deg, z_height)
+        self.root.after(0, self.request_live_update)
+        return len(x_mm)
+
     def process_scan_data_point(self):
         """Process current position and sensor reading to create scan point"""
         if self.current_vl53_distance is None:
@@ -1668,18 +2421,142 @@ class ScannerGUI:
         # Get current angle and height
         angle = self.current_angle
         z_height = self.current_y_pos  # Height from GRBL Y
-        
+
+        # Log the raw sample before any geometry filtering - the .scan file
+        # keeps everything the sensor said, filters can be rerun offline
+        if self._scan_writer is not None:
+            try:
+                self._scan_writer.append(time.time(), angle, z_height,
+                                         self.current_vl53_distance)
+            except Exception as e:
+                self.log_info(f"Raw scan file write failed, disabling: {e}")
+                self._scan_writer = None
+
         # Calculate 3D point
         point = self.calculate_point_from_scan(angle, self.current_vl53_distance, z_height)
         if point:
             # Store point with angle and height for later connection
             # Format: (x, y, z, angle, height)
-            point_with_meta = point + (angle, z_height)
-            self.scan_data.append(point_with_meta)
-            # Update visualization in main thread (thread-safe)
-            self.root.after(0, self.update_visualization)
+            self.scan_data.append(point[0], point[1], point[2], angle, z_height)
+            # Mark the live view dirty in the main thread (thread-safe); the
+            # actual refresh is throttled - see request_live_update()
+            self.root.after(0, self.request_live_update)
             self.log_info(f"Point added: angle={angle:.1f}°, dist={self.current_vl53_distance:.1f}mm, z={z_height:.1f}mm, point=({point[0]:.1f}, {point[1]:.1f}, {point[2]:.1f})mm")
 
+    # Per-point timing CSV columns (see _finish_point_timings)
+    TIMING_FIELDS = ('layer', 'point', 'angle', 'move_ms', 'settle_ms',
+                     'verify_ms', 'sensor_ms', 'process_ms', 'fw_measure_ms',
+                     'valid')
+
+    @staticmethod
+    def _fmt_timing(value):
+        return f"{value:.2f}" if isinstance(value, float) else str(value)
+
+    def _finish_point_timings(self, scan_path):
+        """Export the per-point stage breakdown and log a flame summary.
+
+        Each scan point carries host-side durations for move / settle /
+        verify / sensor / processing plus the firmware's own
+        receipt-to-measurement time from the TIMING: lines. The CSV lands
+        next to the raw .scan log; the summary shows where the scan's wall
+        time went so an optimization's win (or regression) is a number, not
+        a stopwatch reading.
+        """
+        timings = self._point_timings
+        self._point_timings = []
+        if not timings:
+            return
+        if scan_path:
+            csv_path = scan_path + ".timing.csv"
+        else:
+            scan_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "scans")
+            os.makedirs(scan_dir, exist_ok=True)
+            csv_path = os.path.join(
+                scan_dir, datetime.now().strftime("scan_%Y%m%d_%H%M%S.timing.csv"))
+        try:
+            with open(csv_path, 'w') as f:
+                f.write(",".join(self.TIMING_FIELDS) + "\n")
+                for row in timings:
+                    f.write(",".join(self._fmt_timing(row.get(k, ''))
+                                     for k in self.TIMING_FIELDS) + "\n")
+        except Exception as e:
+            self.log_info(f"Timing CSV write failed: {e}")
+            return
+        stages = ('move_ms', 'settle_ms', 'verify_ms', 'sensor_ms', 'process_ms')
+        totals = {s: sum(row[s] for row in timings) for s in stages}
+        grand = sum(totals.values())
+        n = len(timings)
+        if grand <= 0:
+            return
+        self.log_info(f"Timing: {n} points, {grand / 1000.0:.1f}s in stages -> {csv_path}")
+        for s in stages:
+            t = totals[s]
+            self.log_info(f"  {s[:-3]:<8} {t / 1000.0:7.1f}s  {100.0 * t / grand:5.1f}%  ({t / n:6.1f}ms/point)")
+        fw = [row['fw_measure_ms'] for row in timings
+              if isinstance(row.get('fw_measure_ms'), float)]
+        if fw:
+            self.log_info(f"  fw measure avg {sum(fw) / len(fw):.1f}ms/point ({len(fw)} samples)")
+
+    def _read_sensor_once(self, timeout=0.4):
+        """Trigger one sensor read and wait for the reply.
+
+        Returns the distance in mm, or None on timeout / invalid reading.
+        """
+        self.current_vl53_distance = None
+        current_type = self.vl53_sensor_type_var.get() if hasattr(self, 'vl53_sensor_type_var') else self.vl53_sensor_type
+        if current_type == "VL53L1":
+            self.send_serial_command("READ_VL53L1\n", log=False)
+        else:
+            self.send_serial_command("READ_VL53L0X\n", log=False)
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            d = self.current_vl53_distance
+            if d is not None:
+                return d if 0 < d < 8190 else None
+            time.sleep(0.02)
+        return None
+
+    def measure_settle_delay(self, step_distance_mm, speed, trials=2,
+                             window=3, tol_mm=2.0):
+        """Measure how long readings take to stabilize after motion stops.
+
+        The fixed 0.5s post-move wait is sized for the worst mount; on rigid
+        fixtures the vibration dies down much sooner. For each trial this
+        makes one scan-sized rotation step, waits for GRBL to report Idle
+        (the planner buffer is drained - the closest host-side signal to the
+        firmware's plan_get_block_buffer_count()), then fires consecutive
+        sensor reads until `window` readings in a row agree within tol_mm.
+        Returns the worst stabilization time over the trials clamped to
+        [0.1s, 0.5s], or None if no trial stabilized.
+        """
+        settle_times = []
+        for trial in range(trials):
+            if not self.is_scanning or not self.serial_conn:
+                break
+            move = self.format_gcode_command(x_move=step_distance_mm, feed_rate=speed)
+            self.send_gcode_commands(move, delay=0.05)
+            self.wait_gcode_acknowledged()
+            # Wait for motion to finish: poll until the state goes Idle
+            idle_deadline = time.time() + 3.0
+            while time.time() < idle_deadline and self.grbl_state != "Idle":
+                self.send_serial_command("?\n", log=False)
+                time.sleep(0.05)
+            t_stop = time.time()
+            recent = []
+            read_deadline = t_stop + 1.5
+            while time.time() < read_deadline:
+                d = self._read_sensor_once()
+                if d is not None:
+                    recent.append(d)
+                    if len(recent) > window:
+                        recent.pop(0)
+                    if len(recent) == window and max(recent) - min(recent) <= tol_mm:
+                        settle_times.append(time.time() - t_stop)
+                        break
+        if not settle_times:
+            return None
+        return min(0.5, max(0.1, max(settle_times)))
+
     def scan_rotation_loop(self):
         """Main scan loop: rotate X continuously, read sensor, move Z up after each rotation"""
         if not self.is_connected or not self.serial_conn:
@@ -1720,6 +2597,50 @@ class ScannerGUI:
 
             self.log_info(f"Scan settings: {points_per_rev} points/vòng, {angle_step:.2f}° per point ({step_distance_mm:.3f}mm per step), speed=F{int(speed)}")
 
+            # Adaptive angular sampling: watch the local distance gradient and
+            # coarsen the step on flat arcs (up to adaptive_max x the base
+            # grid), dropping straight back to the base grid when an edge
+            # shows up - flat regions cost a handful of samples instead of a
+            # full-density arc
+            adaptive_on = False
+            adaptive_max = 4
+            adaptive_thresh = 1.0  # mm of distance change per degree = "edge"
+            try:
+                adaptive_on = bool(self.adaptive_scan_var.get())
+                adaptive_max = max(1, int(self.adaptive_max_step_var.get()))
+                adaptive_thresh = float(self.adaptive_thresh_var.get())
+            except Exception:
+                pass
+            if adaptive_on:
+                self.log_info(f"Adaptive sampling: step {angle_step:.1f}°-{angle_step * adaptive_max:.1f}°, edge threshold {adaptive_thresh:.2f}mm/°")
+
+            # Multi-revolution accumulation: scan the same layer R times and
+            # reduce per angle (median / trimmed mean) before a single point
+            # per angle enters scan_data - for noisy surfaces this replaces
+            # rescanning and merging clouds by hand
+            accum_revs = 1
+            accum_method = "median"
+            try:
+                accum_revs = max(1, int(self.accum_revs_var.get()))
+                accum_method = self.accum_reduce_var.get()
+            except Exception:
+                pass
+            if accum_revs > 1 and adaptive_on:
+                # Accumulation bins by fixed angular index - the adaptive
+                # stepper would leave the grid
+                adaptive_on = False
+                self.log_info("Adaptive sampling tắt: accumulation cần lưới góc cố định")
+            if accum_revs > 1:
+                self.log_info(f"Accumulation: {accum_revs} vòng/lớp, reduce = {accum_method}")
+
+            # Post-move settle delay: fixed value from the UI, or measured
+            # once per session when auto settle is on (the measurement runs
+            # below, after any resume Z move)
+            try:
+                settle_delay = max(0.05, float(self.settle_delay_var.get()))
+            except Exception:
+                settle_delay = 0.5
+
             # Track layer number
             layer_number = 0
 
@@ -1732,6 +2653,54 @@ class ScannerGUI:
             
             estimated_total_layers = int(max_height / layer_height_mm) + 1
             start_z_position = self.current_y_pos  # Record starting Z position
+
+            # Resume: the checkpoint sidecar lives next to the raw log
+            scan_path = self._scan_writer.path if self._scan_writer is not None else None
+
+            # When resuming, height accounting stays anchored at the original
+            # scan's start Z and the machine is driven back to just above the
+            # last completed layer before the first rotation
+            resume = self._resume_info
+            self._resume_info = None
+            if resume is not None:
+                start_z_position = float(resume["start_z"])
+                layer_number = int(resume["layer_number"])
+                resume_z = float(resume["last_completed_z"]) + layer_height_mm
+                delta = resume_z - self.current_y_pos
+                if abs(delta) >= 0.01:
+                    self.log_info(f"Resume: driving Z {delta:+.1f}mm back to {resume_z:.1f}mm")
+                    commands = self.format_gcode_command(y_move=delta, feed_rate=speed)
+                    self.send_gcode_commands(commands, delay=0.05)
+                    self.wait_gcode_acknowledged()
+                    # Let the move finish and the status reports confirm it
+                    deadline = time.time() + max(5.0, abs(delta))
+                    while time.time() < deadline and abs(self.current_y_pos - resume_z) > layer_height_mm * 0.5:
+                        self.send_serial_command("?\n", log=False)
+                        time.sleep(0.3)
+                    self.log_info(f"Resume: Z now at {self.current_y_pos:.1f}mm")
+
+            # Auto settle: measure how long this session's fixture takes to
+            # stop vibrating after a scan-sized step (see measure_settle_delay)
+            try:
+                settle_auto = bool(self.settle_auto_var.get())
+            except Exception:
+                settle_auto = False
+            if settle_auto:
+                self.log_info("Auto settle: measuring stabilization time...")
+                measured = self.measure_settle_delay(step_distance_mm, speed)
+                if measured is not None:
+                    settle_delay = measured
+                    self.root.after(0, lambda v=measured: self.settle_delay_var.set(f"{v:.2f}"))
+                    self.log_info(f"Auto settle: using {settle_delay * 1000:.0f}ms per point")
+                else:
+                    self.log_info(f"Auto settle: readings did not stabilize, keeping {settle_delay:.2f}s")
+
+            # Per-point stage timing: fresh record set, and ask the firmware
+            # for its receipt/completion timestamps alongside each reply
+            self._point_timings = []
+            self._last_fw_timing_us = None
+            if self.serial_conn:
+                self.send_serial_command("TIMING=1\n", log=False)
             
             self.log_info(f"Scan sẽ chạy từ Z={start_z_position:.2f}mm đến Z={start_z_position + max_height:.2f}mm ({estimated_total_layers} lớp)")
 
@@ -1744,11 +2713,13 @@ class ScannerGUI:
                 current_z_height = self.current_y_pos - start_z_position
                 if current_z_height >= max_height:
                     self.log_info(f"Đã đạt chiều cao tối đa: {current_z_height:.2f}mm >= {max_height:.2f}mm. Dừng scan.")
+                    # Ran to completion - nothing left to resume
+                    if scan_path is not None:
+                        self._delete_checkpoint(scan_path)
                     break
                 
                 # Count points in current layer (points with same height as start_z)
-                points_in_current_layer = sum(1 for p in self.scan_data 
-                                            if len(p) >= 5 and abs(p[4] - start_z) < 0.1)
+                points_in_current_layer = self.scan_data.layer_count(start_z)
 
                 # Update window title with layer info
                 self.root.title(f"3D Scanner Control - Layer {layer_number}/{estimated_total_layers} at Z={start_z:.2f}mm - Points: {points_in_current_layer}")
@@ -1758,26 +2729,40 @@ class ScannerGUI:
                 # Step-by-step rotation: Move to each angle, STOP, read sensor, then continue
                 points_collected = 0
 
-                for point_num in range(points_per_rev):
+                angle_travelled = 0.0
+                step_mult = 1            # current step in base-grid units
+                prev_edge_distance = None  # last valid reading, for the gradient
+                point_num = 0
+                # Accumulation keeps rotating through R revolutions in one
+                # pass - the motor never stops between revolutions
+                rev_target = 360.0 * accum_revs
+                if accum_revs > 1:
+                    self._accum_bins = np.full((points_per_rev, accum_revs), np.nan)
+                while angle_travelled < rev_target - 0.5 * angle_step:
                     if not self.is_scanning or self.scan_paused:
                         break
 
-                    # Step 1: Send command to rotate one step (e.g., 10° = 0.1mm)
+                    # Step 1: Send command to rotate one step (step_mult base
+                    # grid units at a time when adaptive sampling coarsens)
+                    t_point0 = time.perf_counter()  # stage timing starts here
+                    current_step = angle_step * step_mult
                     current_angle_before = self.current_angle
-                    self.log_info(f"Point {point_num + 1}/{points_per_rev}: Rotating {angle_step:.1f}° from {current_angle_before:.1f}°")
+                    self.log_info(f"Point {point_num + 1} ({angle_travelled:.1f}°/{rev_target:.0f}°): Rotating {current_step:.1f}° from {current_angle_before:.1f}°")
 
                     # Send movement command (x_move for rotation axis)
                     # Note: format_gcode_command maps x_move to GRBL X (rotation)
-                    move_commands = self.format_gcode_command(x_move=step_distance_mm, feed_rate=speed)
+                    move_commands = self.format_gcode_command(x_move=step_distance_mm * step_mult, feed_rate=speed)
                     # Log the actual command being sent
                     cmd_str = " ".join([c.strip() for c in move_commands])
                     self.log_info(f"→ Sending G-code: {cmd_str}")
                     if self.serial_conn:
                         self.send_gcode_commands(move_commands, delay=0.1)
+                    t_move_sent = time.perf_counter()
 
-                    # Step 2: Wait for motor to complete movement and request status report
-                    # Wait at least 0.5s for movement to complete
-                    time.sleep(0.5)
+                    # Step 2: Wait for movement to complete and vibration to
+                    # settle - fixed 0.5s unless auto settle measured less
+                    time.sleep(settle_delay)
+                    t_settled = time.perf_counter()
                     
                     # Request status report to get updated position
                     # GRBL only sends status when requested with "?" or when in certain states
@@ -1804,7 +2789,7 @@ class ScannerGUI:
                             angle_diff = 360 - angle_diff
 
                         # Check if angle changed (at least 20% of expected movement, or any change if small step)
-                        min_change = max(angle_step * 0.2, 1.0)  # At least 1 degree or 20% of step
+                        min_change = max(current_step * 0.2, 1.0)  # At least 1 degree or 20% of step
                         if angle_diff >= min_change:
                             angle_moved = True
                             self.log_info(f"✓ Angle updated: {current_angle_before:.1f}° → {current_angle_after:.1f}° (diff: {angle_diff:.1f}°)")
@@ -1824,21 +2809,15 @@ class ScannerGUI:
                             self.send_serial_command("?\n", log=False)
                             time.sleep(0.3)
                             self.log_info(f"   After retry: angle = {self.current_angle:.1f}°")
+                    t_verified = time.perf_counter()
 
                     # Step 3: Motor is now STOPPED - Read sensor (single attempt, no retry)
                     # Clear old sensor data to ensure we get FRESH reading
+                    # (no reset_input_buffer here - flushing would eat pending
+                    # ok acks and desync the character-counting streamer)
                     self.current_vl53_distance = None
-                    
-                    # Clear serial input buffer before reading sensor
-                    if self.serial_conn:
-                        try:
-                            # Clear all pending data in buffer
-                            if self.serial_conn.in_waiting > 0:
-                                self.serial_conn.reset_input_buffer()
-                            time.sleep(0.05)  # Small delay after clearing
-                        except:
-                            pass
-                    
+                    self._last_fw_timing_us = None
+
                     # Single attempt to read sensor - if invalid, skip this point
                     try:
                         if self.serial_conn:
@@ -1867,26 +2846,37 @@ class ScannerGUI:
                                     break
                             time.sleep(0.05)
                         
-                        # If no data received, clear buffer and continue to next point
+                        # If no data received, drop the stale reading and
+                        # continue to next point (buffer is left alone - see
+                        # character-counting note above)
                         if not sensor_data_received:
-                            # Clear buffer to remove any stale data
-                            if self.serial_conn:
-                                try:
-                                    if self.serial_conn.in_waiting > 0:
-                                        self.serial_conn.reset_input_buffer()
-                                except:
-                                    pass
                             self.current_vl53_distance = None  # Clear sensor data
+                        t_sensor_done = time.perf_counter()
 
                         # Step 4: Process point only if we have valid data
                         if sensor_data_received:
-                            self.process_scan_data_point()
+                            if self._accum_bins is not None:
+                                # Bin by angular index; the reduction to one
+                                # point per angle runs after the last rev
+                                rev_idx = min(int(angle_travelled // 360.0), accum_revs - 1)
+                                grid_idx = int(round(self.current_angle / angle_step)) % points_per_rev
+                                self._accum_bins[grid_idx, rev_idx] = self.current_vl53_distance
+                                # Raw sample still goes to the .scan log
+                                if self._scan_writer is not None:
+                                    try:
+                                        self._scan_writer.append(
+                                            time.time(), grid_idx * angle_step,
+                                            self.current_y_pos, self.current_vl53_distance)
+                                    except Exception as e:
+                                        self.log_info(f"Raw scan file write failed, disabling: {e}")
+                                        self._scan_writer = None
+                            else:
+                                self.process_scan_data_point()
                             points_collected += 1
                             
                             # Count current points in this layer
                             current_z = self.current_y_pos
-                            points_in_layer = sum(1 for p in self.scan_data 
-                                                if len(p) >= 5 and abs(p[4] - current_z) < 0.1)
+                            points_in_layer = self.scan_data.layer_count(current_z)
                             
                             # Update window title with current layer and point count
                             self.root.title(f"3D Scanner Control - Layer {layer_number}/{estimated_total_layers} at Z={current_z:.2f}mm - Points: {points_in_layer}")
@@ -1894,15 +2884,77 @@ class ScannerGUI:
                             self.log_info(f"✓ Point {points_collected}/{points_per_rev} at {self.current_angle:.1f}° - Distance: {self.current_vl53_distance}mm (Layer {layer_number}: {points_in_layer} points)")
                         else:
                             self.log_info(f"⚠ Skipped point at {self.current_angle:.1f}° - No valid sensor data")
+
+                        # Per-point stage breakdown (exported at scan end by
+                        # _finish_point_timings). fw_measure is the firmware's
+                        # own receipt-to-measurement span from its TIMING line
+                        t_done = time.perf_counter()
+                        fw_us = self._last_fw_timing_us
+                        self._point_timings.append({
+                            'layer': layer_number,
+                            'point': point_num + 1,
+                            'angle': round(self.current_angle, 2),
+                            'move_ms': (t_move_sent - t_point0) * 1000.0,
+                            'settle_ms': (t_settled - t_move_sent) * 1000.0,
+                            'verify_ms': (t_verified - t_settled) * 1000.0,
+                            'sensor_ms': (t_sensor_done - t_verified) * 1000.0,
+                            'process_ms': (t_done - t_sensor_done) * 1000.0,
+                            'fw_measure_ms': ((fw_us[1] - fw_us[0]) & 0xFFFFFFFF) / 1000.0 if fw_us else '',
+                            'valid': int(sensor_data_received),
+                        })
                     except Exception as e:
                         self.log_info(f"⚠ Skipped point at {self.current_angle:.1f}° - Error: {e}")
-                
-                self.log_info(f"Rotation complete. Collected {points_collected}/{points_per_rev} points")
+
+                    # Advance the revolution; adapt the next step from the
+                    # local gradient (mm per degree) across the last two reads
+                    angle_travelled += current_step
+                    point_num += 1
+                    if adaptive_on:
+                        if self.current_vl53_distance is not None:
+                            if prev_edge_distance is not None:
+                                gradient = abs(self.current_vl53_distance - prev_edge_distance) / max(current_step, 1e-6)
+                                if gradient >= adaptive_thresh:
+                                    step_mult = 1  # edge: back to full resolution
+                                elif gradient < 0.5 * adaptive_thresh:
+                                    # flat arc: coarsen (hysteresis band between
+                                    # the two thresholds keeps the current step)
+                                    step_mult = min(step_mult * 2, adaptive_max)
+                            prev_edge_distance = self.current_vl53_distance
+                        else:
+                            # Dropout: don't coarsen blind, resample fine
+                            step_mult = 1
+                            prev_edge_distance = None
+                        # Never overshoot the revolution boundary
+                        remaining = rev_target - angle_travelled
+                        while step_mult > 1 and angle_step * step_mult > remaining + 0.5 * angle_step:
+                            step_mult //= 2
+
+                if self._accum_bins is not None:
+                    stored = self.store_accumulated_layer(
+                        self._accum_bins, points_per_rev, self.current_y_pos, accum_method)
+                    self._accum_bins = None
+                    self.log_info(f"Accumulation: {accum_revs} vòng reduced ({accum_method}) -> {stored} points at Z={self.current_y_pos:.2f}mm")
+
+                self.log_info(f"Rotation complete. Collected {points_collected} points ({point_num} steps, grid {points_per_rev}/rev)")
+
+                # Layer completed - checkpoint it so an interrupted scan can
+                # resume here instead of back at Z=0 (partial revolutions are
+                # not recorded: the interrupted layer is rescanned in full)
+                if scan_path is not None and self.is_scanning and not self.scan_paused:
+                    self._write_checkpoint(scan_path, {
+                        "scan_path": scan_path,
+                        "points_per_rev": points_per_rev,
+                        "layer_height_mm": layer_height_mm,
+                        "max_height": max_height,
+                        "start_z": start_z_position,
+                        "last_completed_z": start_z,
+                        "layer_number": layer_number,
+                        "saved_at": time.time(),
+                    })
                 
                 # Update title after rotation complete
                 current_z = self.current_y_pos
-                points_in_layer = sum(1 for p in self.scan_data 
-                                    if len(p) >= 5 and abs(p[4] - current_z) < 0.1)
+                points_in_layer = self.scan_data.layer_count(current_z)
                 self.root.title(f"3D Scanner Control - Layer {layer_number}/{estimated_total_layers} at Z={current_z:.2f}mm - Points: {points_in_layer}")
                 
                 if not self.is_scanning or self.scan_paused:
@@ -1912,6 +2964,9 @@ class ScannerGUI:
                 current_z_height = self.current_y_pos - start_z_position
                 if current_z_height >= max_height:
                     self.log_info(f"Đã đạt chiều cao tối đa: {current_z_height:.2f}mm >= {max_height:.2f}mm. Dừng scan.")
+                    # Ran to completion - nothing left to resume
+                    if scan_path is not None:
+                        self._delete_checkpoint(scan_path)
                     break
                 
                 # Move Z up by layer height (ONLY ONCE per rotation)
@@ -1958,15 +3013,119 @@ class ScannerGUI:
             traceback.print_exc()
         finally:
             self.is_scanning = False
+            self._accum_bins = None
+            # Timing off, then flush the per-stage CSV + summary while the
+            # raw log path is still known
+            try:
+                if self.serial_conn:
+                    self.send_serial_command("TIMING=0\n", log=False)
+            except Exception:
+                pass
+            self._finish_point_timings(
+                self._scan_writer.path if self._scan_writer is not None else None)
+            # Seal the raw sample log (trims the preallocated tail)
+            if self._scan_writer is not None:
+                try:
+                    self.log_info(f"Raw scan file sealed: {len(self._scan_writer)} samples")
+                    self._scan_writer.close()
+                except Exception as e:
+                    self.log_info(f"Raw scan file close error: {e}")
+                self._scan_writer = None
             # Update title when scan stops - show total points
             total_points = len(self.scan_data)
             self.root.after(0, lambda: self.root.title(f"3D Scanner Control - Total Points: {total_points}"))
+            # Full-detail mesh redraw now that points stopped streaming
+            self.root.after(0, self.update_visualization)
             self.root.after(0, lambda: self.scan_up_btn.config(state=tk.NORMAL))
             self.root.after(0, lambda: self.scan_down_btn.config(state=tk.NORMAL))
             self.root.after(0, lambda: self.pause_btn.config(state=tk.DISABLED))
             self.root.after(0, lambda: self.resume_btn.config(state=tk.DISABLED))
             self.log_info("Scan stopped")
 
+    # ============================================
+    # SCAN CHECKPOINT / RESUME
+    # ============================================
+    # A .resume JSON sidecar next to the .scan raw log records the scan
+    # parameters and the last completed layer, rewritten atomically after
+    # every layer. If the GUI crashes or the operator stops, the next
+    # start_scan_up offers to reopen the .scan file for append, rebuild the
+    # in-memory cloud from it, drive Z back to the recorded height, and
+    # continue - instead of an hour of repeated work from Z=0.
+
+    @staticmethod
+    def _checkpoint_path(scan_path):
+        return scan_path + ".resume"
+
+    def _write_checkpoint(self, scan_path, params):
+        """Atomically (re)write the resume sidecar for scan_path."""
+        try:
+            path = self._checkpoint_path(scan_path)
+            tmp = path + ".tmp"
+            with open(tmp, 'w') as f:
+                json.dump(params, f, indent=1)
+            os.replace(tmp, path)
+        except Exception as e:
+            self.log_info(f"Checkpoint write failed: {e}")
+
+    def _delete_checkpoint(self, scan_path):
+        """Remove the sidecar once a scan runs to completion."""
+        try:
+            os.remove(self._checkpoint_path(scan_path))
+        except OSError:
+            pass
+
+    def find_resume_checkpoint(self):
+        """Newest usable checkpoint in the scans directory, or None."""
+        scan_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "scans")
+        try:
+            sidecars = [os.path.join(scan_dir, name)
+                        for name in os.listdir(scan_dir) if name.endswith(".resume")]
+        except OSError:
+            return None
+        for path in sorted(sidecars, key=os.path.getmtime, reverse=True):
+            try:
+                with open(path) as f:
+                    info = json.load(f)
+                if os.path.exists(info["scan_path"]):
+                    return info
+            except Exception:
+                continue
+        return None
+
+    def rebuild_scan_data_from_file(self, scan_path):
+        """Rebuild the in-memory cloud from a .scan raw sample log.
+
+        The log keeps every raw (angle, z, distance) sample; one vectorized
+        pass reapplies the current geometry filters and conversion, then the
+        points are stored layer by layer so the per-layer counts stay right.
+        Returns the number of points restored.
+        """
+        records, _start_time = scan_file.load_scan(scan_path)
+        if len(records) == 0:
+            return 0
+        try:
+            center_cm = float(self.center_distance_var.get())
+            disk_cm = float(self.disk_radius_var.get())
+        except Exception:
+            return 0
+        d_cm = records['distance'] / 10.0
+        valid = (d_cm > 0.0) & (d_cm >= center_cm - disk_cm) & (d_cm <= center_cm + disk_cm)
+        if not valid.any():
+            return 0
+        radius_mm = (center_cm - d_cm[valid]) * 10.0
+        angle_deg = records['angle'][valid]
+        angle_rad = np.radians(angle_deg)
+        x_mm = radius_mm * np.cos(angle_rad)
+        y_mm = radius_mm * np.sin(angle_rad)
+        z_mm = records['z'][valid]
+        restored = 0
+        for height in np.unique(np.round(z_mm, 1)):
+            mask = np.round(z_mm, 1) == height
+            self.scan_data.extend(x_mm[mask], y_mm[mask], z_mm[mask],
+                                  angle_deg[mask], float(height))
+            restored += int(mask.sum())
+        return restored
+
     def start_scan_up(self):
         """Start scanning from bottom to top"""
         if not self.is_connected:
@@ -1975,11 +3134,54 @@ class ScannerGUI:
         
         if self.is_scanning:
             return
-        
+
+        # Offer to continue an interrupted scan (see the checkpoint block)
+        resume = self.find_resume_checkpoint()
+        if resume is not None:
+            if not messagebox.askyesno(
+                    "Resume scan",
+                    f"Tìm thấy scan dở tại Z={resume['last_completed_z']:.1f}mm "
+                    f"(layer {resume['layer_number']}, {os.path.basename(resume['scan_path'])}).\n"
+                    "Tiếp tục scan này?"):
+                self._delete_checkpoint(resume["scan_path"])
+                resume = None
+
         self.is_scanning = True
         self.scan_paused = False
-        self.scan_data = []
-        self.current_layer = 0
+
+        if resume is not None:
+            try:
+                self._scan_writer = scan_file.ScanFileWriter.open_for_append(resume["scan_path"])
+                # Restore the parameters the interrupted scan ran with
+                self.points_per_revolution_var.set(str(resume["points_per_rev"]))
+                self.scan_layer_height_var.set(str(resume["layer_height_mm"]))
+                self.z_travel_var.set(str(resume["max_height"]))
+                self.scan_data.clear()
+                restored = self.rebuild_scan_data_from_file(resume["scan_path"])
+                self.current_layer = int(resume["layer_number"])
+                self._resume_info = resume
+                self.log_info(f"Resuming {resume['scan_path']}: {restored} points restored, "
+                              f"continuing above Z={resume['last_completed_z']:.1f}mm")
+            except Exception as e:
+                self.log_info(f"Resume failed ({e}), starting a fresh scan")
+                self._scan_writer = None
+                self._resume_info = None
+                resume = None
+
+        if resume is None:
+            self.scan_data.clear()
+            self.current_layer = 0
+
+            # Open the crash-safe raw sample log for this session
+            try:
+                scan_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "scans")
+                os.makedirs(scan_dir, exist_ok=True)
+                scan_path = os.path.join(scan_dir, datetime.now().strftime("scan_%Y%m%d_%H%M%S.scan"))
+                self._scan_writer = scan_file.ScanFileWriter(scan_path)
+                self.log_info(f"Recording raw samples to {scan_path}")
+            except Exception as e:
+                self._scan_writer = None
+                self.log_info(f"Raw scan file disabled: {e}")
         
         self.scan_up_btn.config(state=tk.DISABLED)
         self.scan_down_btn.config(state=tk.DISABLED)
@@ -2013,7 +3215,8 @@ class ScannerGUI:
             self.log_info("Scan resumed")
 
     def clear_data(self):
-        self.scan_data = []
+        self.scan_data.clear()
+        self.update_visualization()
         self.log_info("Data cleared")
 
     def move_to_top(self):
@@ -2025,16 +3228,125 @@ class ScannerGUI:
     def send_config(self):
         self.log_info("Send config not implemented")
 
+    # ============================================
+    # LIVE (INCREMENTAL) RENDERING
+    # ============================================
+    # update_visualization() rebuilds the full mesh from every stored point,
+    # so scheduling it per point made redraw cost grow with the cloud - by
+    # layer 30 the GUI spent more time drawing than scanning and the Tk event
+    # backlog delayed the serial thread's callbacks. While points stream in,
+    # only a point-cloud scatter is refreshed: its data arrays are updated in
+    # place and blitted over a cached background, at most every
+    # LIVE_REFRESH_MS, decimated to LIVE_POINT_BUDGET points so render cost
+    # stays flat as the cloud grows. The full mesh redraw still runs when the
+    # scan finishes, on clear, and whenever matplotlib does a full draw
+    # (resize, mouse rotation).
+
+    LIVE_REFRESH_MS = 100      # refresh cap ~10Hz
+    LIVE_POINT_BUDGET = 20000  # max points pushed to the live scatter
+
+    def request_live_update(self):
+        """Mark the live view dirty; start the refresh timer if stopped."""
+        self._viz_dirty = True
+        if not self._viz_timer_running:
+            self._viz_timer_running = True
+            self.root.after(self.LIVE_REFRESH_MS, self._live_update_tick)
+
+    def _live_update_tick(self):
+        if not self._viz_dirty:
+            # No new points for a full period - park the timer instead of
+            # waking the event loop forever
+            self._viz_timer_running = False
+            return
+        self._viz_dirty = False
+        try:
+            self._render_live_points()
+        except Exception as e:
+            self.log_info(f"Live render error: {e}")
+        self.root.after(self.LIVE_REFRESH_MS, self._live_update_tick)
+
+    def _reset_live_view(self):
+        """Invalidate live artists (called before ax.clear() / data clear)."""
+        self._live_scatter = None
+        self._viz_background = None
+        self._viz_bounds = None
+
+    def _on_canvas_draw(self, event):
+        # Full draws skip the animated live scatter, so the result is exactly
+        # the background we need for blitting
+        if self._live_scatter is not None:
+            self._viz_background = self.canvas.copy_from_bbox(self.ax.bbox)
+
+    def _render_live_points(self):
+        n = len(self.scan_data)
+        if n == 0:
+            return
+        pts = self.scan_data.points()
+        # Decimate: draw every step-th point so the artist size is bounded;
+        # full detail comes back with the final mesh redraw
+        step = max(1, -(-n // self.LIVE_POINT_BUDGET))
+        x = pts['x'][::step]
+        y = pts['y'][::step]
+        z = pts['z'][::step]
+
+        if self._live_scatter is None:
+            # First refresh after a full redraw/clear: rebuild the axes once
+            # and create the persistent scatter (animated=True keeps it out
+            # of full draws, so the cached background never contains it)
+            self.ax.clear()
+            self.ax.set_xlabel('X (mm)', fontsize=10)
+            self.ax.set_ylabel('Y (mm)', fontsize=10)
+            self.ax.set_zlabel('Z (mm)', fontsize=10)
+            self.ax.set_title('3D Scan - live view', fontsize=11)
+            self._live_scatter = self.ax.scatter(
+                [], [], [], c='blue', s=8, alpha=0.8, depthshade=False, animated=True)
+            self._viz_bounds = None
+
+        # Grow-only cubic bounds with padding: limits (and the expensive full
+        # draw + background recapture behind them) only change when the cloud
+        # outgrows the current box, not on every refresh
+        lo = min(x.min(), y.min(), z.min())
+        hi = max(x.max(), y.max(), z.max())
+        bounds = self._viz_bounds
+        if bounds is None or lo < bounds[0] or hi > bounds[1]:
+            pad = max((hi - lo) * 0.1, 1.0)
+            self._viz_bounds = (lo - pad, hi + pad)
+            self.ax.set_xlim(*self._viz_bounds)
+            self.ax.set_ylim(*self._viz_bounds)
+            self.ax.set_zlim(*self._viz_bounds)
+            try:
+                self.ax.set_box_aspect([1, 1, 1])
+            except:
+                pass
+            self.canvas.draw()  # triggers _on_canvas_draw -> new background
+
+        self._live_scatter._offsets3d = (x, y, z)
+
+        if self._viz_blit_ok and self._viz_background is not None:
+            try:
+                self.canvas.restore_region(self._viz_background)
+                self.ax.draw_artist(self._live_scatter)
+                self.canvas.blit(self.ax.bbox)
+            except Exception:
+                # Blitting a 3D artist varies between matplotlib versions -
+                # fall back to throttled full draws, still capped at ~10Hz
+                self._viz_blit_ok = False
+                self.canvas.draw_idle()
+        else:
+            self.canvas.draw_idle()
+
     def update_visualization(self):
         """Update 3D visualization with scan data - improved surface mesh + point cloud"""
         try:
+            self._reset_live_view()
             self.ax.clear()
 
             if len(self.scan_data) > 0:
-                # Extract x, y, z coordinates
-                x_coords = np.array([p[0] for p in self.scan_data])
-                y_coords = np.array([p[1] for p in self.scan_data])
-                z_coords = np.array([p[2] for p in self.scan_data])
+                # Extract x, y, z coordinates (column views, no Python loop)
+                pts = self.scan_data.points()
+                x_coords = pts['x']
+                y_coords = pts['y']
+                z_coords = pts['z']
 
                 # ============================================
                 # IMPROVED MESH GENERATION
@@ -2280,31 +3592,118 @@ class ScannerGUI:
             traceback.print_exc()
 
     def export_stl(self):
-        """Export scan data to STL file"""
+        """Export scan data to STL file (reconstruction runs out-of-process).
+
+        Mesh building over a big cloud takes long enough to freeze Tk and
+        back up on_serial_received - so the point store is snapshotted into
+        shared memory and a worker process does the reconstruction and
+        writing while scanning continues at full rate. Progress comes back
+        over a queue polled with root.after (see _poll_export).
+        """
         if len(self.scan_data) < 3:
             messagebox.showerror("Error", "Not enough scan data to export. Please scan first.")
             return
-        
+
+        if self._export_proc is not None and self._export_proc.is_alive():
+            messagebox.showinfo("Export", "An STL export is already running.")
+            return
+
         filename = filedialog.asksaveasfilename(
             defaultextension=".stl",
             filetypes=[("STL files", "*.stl"), ("All files", "*.*")]
         )
-        
+
         if not filename:
             return
-        
+
         try:
-            self.log_info(f"Exporting STL to {filename}...")
-            vertices, faces = self.generate_mesh_from_scan_data()
-            self.write_stl_file(filename, vertices, faces)
-            self.log_info(f"STL export completed: {len(faces)} triangles")
-            messagebox.showinfo("Success", f"STL file exported successfully!\n{len(faces)} triangles")
+            # Snapshot the store: the worker sees a stable copy even while
+            # the scan thread keeps appending (an export mid-scan captures
+            # every complete point up to this instant)
+            pts = self.scan_data.points()
+            count = len(pts)
+            shm = shared_memory.SharedMemory(create=True, size=pts.nbytes)
+            snapshot = np.ndarray((count,), dtype=ScanPointStore.POINT_DTYPE,
+                                  buffer=shm.buf)
+            snapshot[:] = pts
+
+            queue = multiprocessing.Queue()
+            proc = multiprocessing.Process(
+                target=_mesh_export_worker,
+                args=(shm.name, count, filename, queue),
+                daemon=True)
+            proc.start()
+
+            self._export_proc = proc
+            self._export_shm = shm
+            self._export_queue = queue
+            self.log_info(f"Exporting STL to {filename} in background ({count} points)...")
+            self.root.after(200, self._poll_export)
         except Exception as e:
             self.log_info(f"STL export error: {e}")
             import traceback
             traceback.print_exc()
+            self._finish_export()
             messagebox.showerror("Error", f"Failed to export STL: {str(e)}")
 
+    def _poll_export(self):
+        """Drain worker progress from the queue on the Tk thread (~5Hz)."""
+        queue = self._export_queue
+        if queue is None:
+            return
+        done = False
+        while True:
+            try:
+                kind, value = queue.get_nowait()
+            except Exception:
+                break  # queue empty
+            if kind == "progress":
+                self.log_info(f"STL export: {value}")
+            elif kind == "done":
+                self.log_info(f"STL export completed: {value} triangles")
+                messagebox.showinfo("Success", f"STL file exported successfully!\n{value} triangles")
+                done = True
+            else:  # "error"
+                self.log_info(f"STL export error: {value}")
+                messagebox.showerror("Error", f"Failed to export STL: {value}")
+                done = True
+        if done:
+            self._finish_export()
+            return
+        if self._export_proc is not None and not self._export_proc.is_alive():
+            # Worker exited without a final message (killed, MemoryError...)
+            # - give the queue one last chance, then report the failure
+            try:
+                kind, value = queue.get(timeout=0.5)
+                if kind == "done":
+                    self.log_info(f"STL export completed: {value} triangles")
+                    messagebox.showinfo("Success", f"STL file exported successfully!\n{value} triangles")
+                else:
+                    self.log_info(f"STL export error: {value}")
+            except Exception:
+                self.log_info("STL export worker exited unexpectedly")
+                messagebox.showerror("Error", "STL export worker exited unexpectedly")
+            self._finish_export()
+            return
+        self.root.after(200, self._poll_export)
+
+    def _finish_export(self):
+        """Reap the worker and release the shared-memory snapshot."""
+        if self._export_proc is not None:
+            try:
+                self._export_proc.join(timeout=1.0)
+            except Exception:
+                pass
+        if self._export_shm is not None:
+            try:
+                self._export_shm.close()
+                self._export_shm.unlink()
+            except Exception:
+                pass
+        self._export_proc = None
+        self._export_shm = None
+        self._export_queue = None
+
     def export_k(self):
         """Export scan data to LS-DYNA Keyword file (.k) - HyperMesh compatible format"""
         if len(self.scan_data) < 3:
@@ -2361,113 +3760,7 @@ class ScannerGUI:
         """Generate mesh (vertices and faces) from scan data"""
         if len(self.scan_data) < 3:
             raise ValueError("Not enough points to generate mesh")
-        
-        # Group points by layer (height)
-        layer_groups = {}
-        for idx, point_data in enumerate(self.scan_data):
-            if len(point_data) >= 5:
-                x, y, z, angle, height = point_data[:5]
-                height_key = round(height, 1)
-                if height_key not in layer_groups:
-                    layer_groups[height_key] = []
-                layer_groups[height_key].append((x, y, z, angle, idx))
-        
-        sorted_heights = sorted(layer_groups.keys())
-        vertices = []
-        faces = []
-        vertex_index_map = {}  # Map (x, y, z) -> vertex index
-        
-        def get_vertex_index(x, y, z):
-            """Get or create vertex index"""
-            key = (round(x, 3), round(y, 3), round(z, 3))
-            if key not in vertex_index_map:
-                vertex_index_map[key] = len(vertices)
-                vertices.append([x, y, z])
-            return vertex_index_map[key]
-        
-        # Create mesh between adjacent layers
-        for layer_idx in range(len(sorted_heights) - 1):
-            height1 = sorted_heights[layer_idx]
-            height2 = sorted_heights[layer_idx + 1]
-            
-            layer1_points = sorted(layer_groups[height1], key=lambda p: p[3])
-            layer2_points = sorted(layer_groups[height2], key=lambda p: p[3])
-            
-            # Connect points between layers
-            for i in range(len(layer1_points)):
-                x1, y1, z1, angle1, idx1 = layer1_points[i]
-                next_i = (i + 1) % len(layer1_points)
-                x1_next, y1_next, z1_next, angle1_next, idx1_next = layer1_points[next_i]
-                
-                # Find closest points in layer2
-                min_angle_diff = 360
-                closest_j = -1
-                for j in range(len(layer2_points)):
-                    x2, y2, z2, angle2, idx2 = layer2_points[j]
-                    angle_diff = abs(angle2 - angle1)
-                    if angle_diff > 180:
-                        angle_diff = 360 - angle_diff
-                    if angle_diff < min_angle_diff:
-                        min_angle_diff = angle_diff
-                        closest_j = j
-                
-                if closest_j >= 0 and min_angle_diff < 15:
-                    x2, y2, z2, angle2, idx2 = layer2_points[closest_j]
-                    next_j = (closest_j + 1) % len(layer2_points)
-                    x2_next, y2_next, z2_next, angle2_next, idx2_next = layer2_points[next_j]
-                    
-                    # Check distances to prevent connecting distant points
-                    dist1 = np.sqrt((x2 - x1)**2 + (y2 - y1)**2 + (z2 - z1)**2)
-                    dist2 = np.sqrt((x1_next - x1)**2 + (y1_next - y1)**2 + (z1_next - z1)**2)
-                    dist3 = np.sqrt((x2_next - x2)**2 + (y2_next - y2)**2 + (z2_next - z2)**2)
-                    
-                    if dist1 < 50 and dist2 < 50 and dist3 < 50:
-                        # Create quad as two triangles
-                        v1 = get_vertex_index(x1, y1, z1)
-                        v2 = get_vertex_index(x2, y2, z2)
-                        v3 = get_vertex_index(x1_next, y1_next, z1_next)
-                        v4 = get_vertex_index(x2_next, y2_next, z2_next)
-                        
-                        # Triangle 1: v1, v2, v3
-                        faces.append([v1, v2, v3])
-                        # Triangle 2: v2, v4, v3
-                        faces.append([v2, v4, v3])
-        
-        # Add top and bottom caps
-        if len(sorted_heights) >= 1:
-            # Bottom cap
-            bottom_layer = sorted(layer_groups[sorted_heights[0]], key=lambda p: p[3])
-            if len(bottom_layer) >= 3:
-                center_x = np.mean([p[0] for p in bottom_layer])
-                center_y = np.mean([p[1] for p in bottom_layer])
-                center_z = sorted_heights[0]
-                center_idx = get_vertex_index(center_x, center_y, center_z)
-                
-                for i in range(len(bottom_layer)):
-                    x1, y1, z1, _, _ = bottom_layer[i]
-                    next_i = (i + 1) % len(bottom_layer)
-                    x2, y2, z2, _, _ = bottom_layer[next_i]
-                    v1 = get_vertex_index(x1, y1, z1)
-                    v2 = get_vertex_index(x2, y2, z2)
-                    faces.append([center_idx, v1, v2])
-            
-            # Top cap
-            top_layer = sorted(layer_groups[sorted_heights[-1]], key=lambda p: p[3])
-            if len(top_layer) >= 3:
-                center_x = np.mean([p[0] for p in top_layer])
-                center_y = np.mean([p[1] for p in top_layer])
-                center_z = sorted_heights[-1]
-                center_idx = get_vertex_index(center_x, center_y, center_z)
-                
-                for i in range(len(top_layer)):
-                    x1, y1, z1, _, _ = top_layer[i]
-                    next_i = (i + 1) % len(top_layer)
-                    x2, y2, z2, _, _ = top_layer[next_i]
-                    v1 = get_vertex_index(x1, y1, z1)
-                    v2 = get_vertex_index(x2, y2, z2)
-                    faces.append([center_idx, v2, v1])  # Reverse order for top
-        
-        return np.array(vertices), np.array(faces)
+        return build_mesh_from_points(self.scan_data)
     
     def write_stl_file(self, filename, vertices, faces):
         """Write STL file in binary format"""
@@ -0,0 +1,199 @@
+"""
+Binary .scan file format - crash-safe persistence of raw scan samples.
+
+The GUI used to keep scan data only in RAM: a crash lost the whole session,
+and reloading a big scan for re-meshing meant re-parsing text exports. A
+.scan file is a small header followed by fixed-size little-endian records
+(timestamp, angle, z, distance, status), appended through mmap during
+acquisition and loadable zero-copy as a NumPy array by both the GUI and
+offline tools.
+
+Layout:
+
+    offset 0   magic        8 bytes  b'SCAN3D\\x00\\x01'
+    offset 8   version      u16
+    offset 10  record_size  u16      RECORD_DTYPE.itemsize (40)
+    offset 12  reserved     u32
+    offset 16  count        u64      valid records (updated on every append)
+    offset 24  start_time   f8       time.time() when the file was created
+    offset 32  records      count x RECORD_DTYPE
+
+The file on disk is grown in chunks and trimmed to size on close, so the
+region past `count` may contain preallocated garbage - readers must clamp
+to the header count. After a crash the header count reflects the last
+msync'ed state; at most the samples since the last periodic flush are lost.
+"""
+
+import mmap
+import os
+import struct
+import time
+
+import numpy as np
+
+SCAN_MAGIC = b'SCAN3D\x00\x01'
+SCAN_VERSION = 1
+SCAN_HEADER = struct.Struct('<8sHHIQd')  # magic, version, record_size, reserved, count, start_time
+SCAN_HEADER_SIZE = SCAN_HEADER.size  # 32
+_COUNT_OFFSET = 16
+
+# One sample. All little-endian; status is the sensor's device range status
+# (11 = valid on the VL53L0X), 0 when the firmware path doesn't report one.
+# f8 x4 + u4 + u4 pad keeps records 8-byte aligned at 40 bytes.
+RECORD_DTYPE = np.dtype([
+    ('timestamp', '<f8'),  # host time.time() of the sample
+    ('angle', '<f8'),      # turntable angle (degrees)
+    ('z', '<f8'),          # layer height (mm)
+    ('distance', '<f8'),   # raw sensor distance (mm)
+    ('status', '<u4'),     # device range status
+    ('reserved', '<u4'),
+])
+
+GROW_RECORDS = 4096   # initial capacity and growth granularity
+FLUSH_EVERY = 64      # msync once per this many appends
+
+
+class ScanFileWriter:
+    """Append-only mmap writer for .scan files.
+
+    Appends cost a record assignment into the mapped region plus a header
+    count update - no syscall on the hot path. The map is grown by doubling
+    when full and the file is trimmed to the exact record count on close.
+    """
+
+    def __init__(self, path, start_time=None):
+        self.path = path
+        self._count = 0
+        self._capacity = GROW_RECORDS
+        self._file = open(path, 'w+b')
+        self._file.truncate(SCAN_HEADER_SIZE + self._capacity * RECORD_DTYPE.itemsize)
+        self._mm = mmap.mmap(self._file.fileno(),
+                             SCAN_HEADER_SIZE + self._capacity * RECORD_DTYPE.itemsize)
+        self._mm[:SCAN_HEADER_SIZE] = SCAN_HEADER.pack(
+            SCAN_MAGIC, SCAN_VERSION, RECORD_DTYPE.itemsize, 0, 0,
+            time.time() if start_time is None else start_time)
+        self._map_records()
+
+    @classmethod
+    def open_for_append(cls, path):
+        """Reopen an existing .scan file and continue appending.
+
+        Used by scan resume: the header count is clamped to what the file
+        actually holds (as in load_scan), so records past a crash-truncated
+        count are overwritten rather than trusted. start_time and existing
+        records are untouched.
+        """
+        self = cls.__new__(cls)
+        self.path = path
+        self._file = open(path, 'r+b')
+        header = self._file.read(SCAN_HEADER_SIZE)
+        if len(header) < SCAN_HEADER_SIZE:
+            raise ValueError(f"{path}: not a .scan file (short header)")
+        magic, version, record_size, _reserved, count, _start = SCAN_HEADER.unpack(header)
+        if magic != SCAN_MAGIC:
+            raise ValueError(f"{path}: not a .scan file (bad magic)")
+        if record_size != RECORD_DTYPE.itemsize:
+            raise ValueError(
+                f"{path}: record size {record_size} (version {version}) does "
+                f"not match this writer's {RECORD_DTYPE.itemsize}")
+        payload = os.path.getsize(path) - SCAN_HEADER_SIZE
+        self._count = min(count, payload // RECORD_DTYPE.itemsize)
+        self._capacity = GROW_RECORDS
+        while self._capacity < self._count + 1:
+            self._capacity *= 2
+        self._file.truncate(SCAN_HEADER_SIZE + self._capacity * RECORD_DTYPE.itemsize)
+        self._mm = mmap.mmap(self._file.fileno(),
+                             SCAN_HEADER_SIZE + self._capacity * RECORD_DTYPE.itemsize)
+        struct.pack_into('<Q', self._mm, _COUNT_OFFSET, self._count)
+        self._map_records()
+        return self
+
+    def _map_records(self):
+        self._records = np.ndarray(
+            (self._capacity,), dtype=RECORD_DTYPE,
+            buffer=memoryview(self._mm)[SCAN_HEADER_SIZE:])
+
+    def _grow(self, minimum):
+        # Release the exported buffer before resizing the map
+        self._records = None
+        while self._capacity < minimum:
+            self._capacity *= 2
+        self._mm.resize(SCAN_HEADER_SIZE + self._capacity * RECORD_DTYPE.itemsize)
+        self._map_records()
+
+    def append(self, timestamp, angle, z, distance, status=0):
+        """Append one sample; the record is visible to readers immediately."""
+        if self._count == self._capacity:
+            self._grow(self._count + 1)
+        self._records[self._count] = (timestamp, angle, z, distance, status, 0)
+        self._count += 1
+        struct.pack_into('<Q', self._mm, _COUNT_OFFSET, self._count)
+        if (self._count % FLUSH_EVERY) == 0:
+            self._mm.flush()
+
+    def append_many(self, timestamps, angles, zs, distances, statuses):
+        """Append a burst of samples with one slice assignment per column."""
+        n = len(distances)
+        if n == 0:
+            return
+        if self._count + n > self._capacity:
+            self._grow(self._count + n)
+        block = self._records[self._count:self._count + n]
+        block['timestamp'] = timestamps
+        block['angle'] = angles
+        block['z'] = zs
+        block['distance'] = distances
+        block['status'] = statuses
+        block['reserved'] = 0
+        self._count += n
+        struct.pack_into('<Q', self._mm, _COUNT_OFFSET, self._count)
+        self._mm.flush()
+
+    def __len__(self):
+        return self._count
+
+    def close(self):
+        """Flush, trim the preallocated tail, and close the file."""
+        if self._mm is None:
+            return
+        self._records = None
+        self._mm.flush()
+        self._mm.close()
+        self._mm = None
+        self._file.truncate(SCAN_HEADER_SIZE + self._count * RECORD_DTYPE.itemsize)
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        self.close()
+
+
+def load_scan(path):
+    """Load a .scan file zero-copy.
+
+    Returns (records, start_time): records is a read-only np.memmap view of
+    RECORD_DTYPE - a million-point dataset opens in milliseconds because
+    nothing is parsed or copied. The header count is clamped to what the
+    file actually holds, so a file truncated by a crash still loads cleanly.
+    """
+    with open(path, 'rb') as f:
+        header = f.read(SCAN_HEADER_SIZE)
+    if len(header) < SCAN_HEADER_SIZE:
+        raise ValueError(f"{path}: not a .scan file (short header)")
+    magic, version, record_size, _reserved, count, start_time = SCAN_HEADER.unpack(header)
+    if magic != SCAN_MAGIC:
+        raise ValueError(f"{path}: not a .scan file (bad magic)")
+    if record_size != RECORD_DTYPE.itemsize:
+        raise ValueError(
+            f"{path}: record size {record_size} (version {version}) does not "
+            f"match this reader's {RECORD_DTYPE.itemsize}")
+    payload = os.path.getsize(path) - SCAN_HEADER_SIZE
+    available = payload // RECORD_DTYPE.itemsize
+    n = min(count, available)
+    if n == 0:
+        return np.empty(0, dtype=RECORD_DTYPE), start_time
+    records = np.memmap(path, dtype=RECORD_DTYPE, mode='r',
+                        offset=SCAN_HEADER_SIZE, shape=(n,))
+    return records, start_time
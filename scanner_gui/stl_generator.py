@@ -1,51 +1,135 @@
 """
 STL file generator from 3D point cloud
+
+Mesh construction and writing are vectorized: triangle indices come from
+NumPy index arithmetic instead of per-point Python loops, and the binary
+writer streams facets in fixed-size chunks, so export time scales linearly
+with the cloud and memory stays flat regardless of scan size.
 """
 
 import numpy as np
 from scipy.spatial import ConvexHull
 from scipy.interpolate import griddata
 
+# Facets per write chunk. One facet is 50 bytes on disk and ~100 bytes while
+# being assembled, so 8192 facets keeps the working set under a megabyte no
+# matter how many triangles the mesh has.
+STL_CHUNK_FACETS = 8192
+
+# Binary STL facet record: normal + 3 vertices (float32) + attribute count.
+# itemsize is exactly 50 - NumPy packs it unaligned, matching the file format,
+# so a chunk of records can be written with a single tobytes().
+_FACET_DTYPE = np.dtype([
+    ('normal', '<f4', (3,)),
+    ('v1', '<f4', (3,)),
+    ('v2', '<f4', (3,)),
+    ('v3', '<f4', (3,)),
+    ('attr', '<u2'),
+])
+
+
 def generate_stl_from_points(points, filename):
     """
     Generate STL file from point cloud
-    
+
     Args:
         points: numpy array of shape (N, 3) with x, y, z coordinates
         filename: output STL filename
     """
     if len(points) < 3:
         raise ValueError("Not enough points to generate mesh")
-    
-    # Simple approach: create a mesh using Delaunay triangulation
-    # For better results, you might want to use more sophisticated methods
-    
-    # Project points to 2D for triangulation (using theta and z)
-    # Convert back to cartesian for STL
-    
-    # For now, use a simple convex hull approach
+
+    points = np.asarray(points, dtype=np.float64)
+
+    # Simple approach: convex hull when it works, grid interpolation fallback
     try:
         hull = ConvexHull(points)
         write_stl_binary(filename, points, hull.simplices)
-    except:
-        # Fallback: create a simple mesh grid
+    except Exception:
         create_grid_mesh(points, filename)
 
+
+def generate_stl_from_scan(points, points_per_rev, filename, close_caps=True):
+    """
+    Generate STL directly from the scanner's layer structure.
+
+    The scan loop samples a regular angle x height grid: points arrive layer
+    by layer, points_per_rev samples per revolution, so the triangle topology
+    is known without any nearest-neighbour search. points must be an (N, 3)
+    array in scan order (angle varying fastest); incomplete trailing layers
+    are dropped.
+    """
+    points = np.asarray(points, dtype=np.float64)
+    n_layers = len(points) // points_per_rev
+    if n_layers < 2:
+        raise ValueError("Need at least two complete layers to generate mesh")
+
+    grid = points[:n_layers * points_per_rev]
+    faces = layer_grid_faces(n_layers, points_per_rev)
+    if close_caps:
+        grid, cap_faces = _cap_faces(grid, n_layers, points_per_rev)
+        faces = np.vstack((faces, cap_faces))
+    write_stl_binary(filename, grid, faces)
+
+
+def layer_grid_faces(n_layers, points_per_rev):
+    """
+    Triangle index array for a closed angle x height grid.
+
+    Each quad between vertically adjacent samples becomes two triangles; the
+    seam wraps around (last angle connects back to the first). Built entirely
+    from broadcast index arithmetic - no Python loop over points.
+    """
+    i = np.arange(points_per_rev)
+    i_next = (i + 1) % points_per_rev
+    rows = np.arange(n_layers - 1)[:, None] * points_per_rev
+
+    a = rows + i          # (layer, i)
+    b = rows + i_next     # (layer, i+1)
+    c = a + points_per_rev  # (layer+1, i)
+    d = b + points_per_rev  # (layer+1, i+1)
+
+    # Quad (a, b, c, d) -> triangles (a, b, c) and (b, d, c)
+    tri1 = np.stack((a, b, c), axis=-1).reshape(-1, 3)
+    tri2 = np.stack((b, d, c), axis=-1).reshape(-1, 3)
+    return np.vstack((tri1, tri2))
+
+
+def _cap_faces(grid, n_layers, points_per_rev):
+    """Fan-triangulate bottom and top layers around their centroids."""
+    bottom = grid[:points_per_rev]
+    top = grid[(n_layers - 1) * points_per_rev:n_layers * points_per_rev]
+    centers = np.array([bottom.mean(axis=0), top.mean(axis=0)])
+    vertices = np.vstack((grid, centers))
+    c_bottom = len(grid)
+    c_top = len(grid) + 1
+
+    i = np.arange(points_per_rev)
+    i_next = (i + 1) % points_per_rev
+    top_base = (n_layers - 1) * points_per_rev
+    # Bottom cap faces down, top cap faces up (winding order flipped)
+    bottom_faces = np.stack(
+        (np.full(points_per_rev, c_bottom), i_next, i), axis=-1)
+    top_faces = np.stack(
+        (np.full(points_per_rev, c_top), top_base + i, top_base + i_next), axis=-1)
+    return vertices, np.vstack((bottom_faces, top_faces))
+
+
 def create_grid_mesh(points, filename):
     """Create a mesh from points using grid interpolation"""
     # Get bounds
     x_min, x_max = points[:, 0].min(), points[:, 0].max()
     y_min, y_max = points[:, 1].min(), points[:, 1].max()
-    z_min, z_max = points[:, 2].min(), points[:, 2].max()
-    
+    z_min = points[:, 2].min()
+
     # Create grid
     x_res = 50
     y_res = 50
-    
+
     xi = np.linspace(x_min, x_max, x_res)
     yi = np.linspace(y_min, y_max, y_res)
     xi_grid, yi_grid = np.meshgrid(xi, yi)
-    
+
     # Interpolate z values
     zi_grid = griddata(
         (points[:, 0], points[:, 1]),
@@ -54,71 +138,58 @@ def create_grid_mesh(points, filename):
         method='linear',
         fill_value=z_min
     )
-    
-    # Create mesh from grid
-    vertices = []
-    faces = []
-    
-    for i in range(y_res - 1):
-        for j in range(x_res - 1):
-            # Create two triangles for each quad
-            v1 = [xi_grid[i, j], yi_grid[i, j], zi_grid[i, j]]
-            v2 = [xi_grid[i, j+1], yi_grid[i, j+1], zi_grid[i, j+1]]
-            v3 = [xi_grid[i+1, j], yi_grid[i+1, j], zi_grid[i+1, j]]
-            v4 = [xi_grid[i+1, j+1], yi_grid[i+1, j+1], zi_grid[i+1, j+1]]
-            
-            # Triangle 1
-            idx1 = len(vertices)
-            vertices.append(v1)
-            idx2 = len(vertices)
-            vertices.append(v2)
-            idx3 = len(vertices)
-            vertices.append(v3)
-            faces.append([idx1, idx2, idx3])
-            
-            # Triangle 2
-            idx4 = len(vertices)
-            vertices.append(v2)
-            idx5 = len(vertices)
-            vertices.append(v4)
-            idx6 = len(vertices)
-            vertices.append(v3)
-            faces.append([idx4, idx5, idx6])
-    
-    vertices = np.array(vertices)
-    write_stl_binary(filename, vertices, np.array(faces))
-
-def write_stl_binary(filename, vertices, faces):
-    """Write STL file in binary format"""
+
+    # Grid vertices and the two triangles per quad, via index arithmetic
+    vertices = np.column_stack(
+        (xi_grid.ravel(), yi_grid.ravel(), zi_grid.ravel()))
+    j = np.arange(x_res - 1)
+    rows = np.arange(y_res - 1)[:, None] * x_res
+    a = rows + j
+    b = a + 1
+    c = a + x_res
+    d = b + x_res
+    tri1 = np.stack((a, b, c), axis=-1).reshape(-1, 3)
+    tri2 = np.stack((b, d, c), axis=-1).reshape(-1, 3)
+    write_stl_binary(filename, vertices, np.vstack((tri1, tri2)))
+
+
+def write_stl_binary(filename, vertices, faces, chunk_facets=STL_CHUNK_FACETS):
+    """Write STL file in binary format, streaming facets in fixed-size chunks.
+
+    Normals are computed per chunk with vectorized cross products and the
+    whole chunk is written as one packed record array, so neither time per
+    facet nor peak memory depends on the total triangle count.
+    """
+    vertices = np.asarray(vertices, dtype=np.float64)
+    faces = np.asarray(faces, dtype=np.intp)
+    num_facets = len(faces)
+
     with open(filename, 'wb') as f:
         # Write header (80 bytes)
         header = b'3D Scanner STL File' + b'\x00' * 61
         f.write(header)
-        
+
         # Write number of facets
-        num_facets = len(faces)
         f.write(np.uint32(num_facets).tobytes())
-        
-        # Write facets
-        for face in faces:
-            # Get triangle vertices
-            v1 = vertices[face[0]]
-            v2 = vertices[face[1]]
-            v3 = vertices[face[2]]
-            
-            # Calculate normal
-            normal = calculate_normal(v1, v2, v3)
-            
-            # Write normal (3 floats)
-            f.write(np.float32(normal).tobytes())
-            
-            # Write vertices (3 floats each)
-            f.write(np.float32(v1).tobytes())
-            f.write(np.float32(v2).tobytes())
-            f.write(np.float32(v3).tobytes())
-            
-            # Write attribute byte count (usually 0)
-            f.write(np.uint16(0).tobytes())
+
+        for start in range(0, num_facets, chunk_facets):
+            chunk = faces[start:start + chunk_facets]
+            tri = vertices[chunk]  # (n, 3 corners, 3 coords)
+
+            # Vectorized normals; degenerate triangles keep a zero normal
+            normals = np.cross(tri[:, 1] - tri[:, 0], tri[:, 2] - tri[:, 0])
+            lengths = np.linalg.norm(normals, axis=1)
+            nonzero = lengths > 0
+            normals[nonzero] /= lengths[nonzero, None]
+
+            records = np.empty(len(chunk), dtype=_FACET_DTYPE)
+            records['normal'] = normals
+            records['v1'] = tri[:, 0]
+            records['v2'] = tri[:, 1]
+            records['v3'] = tri[:, 2]
+            records['attr'] = 0
+            f.write(records.tobytes())
+
 
 def calculate_normal(v1, v2, v3):
     """Calculate normal vector for triangle"""
@@ -129,4 +200,3 @@ def calculate_normal(v1, v2, v3):
     if norm > 0:
         normal = normal / norm
     return normal
-
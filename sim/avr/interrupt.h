@@ -0,0 +1,22 @@
+/*
+  avr/interrupt.h - ISR giả lập cho bản build simulator trên PC
+
+  ISR(vect) nở thành hàm C thường "void vect(void)" - bench driver và
+  sim_stepper_pump() gọi thẳng thay cho phần cứng. cli/sei là no-op: sim
+  chạy đơn luồng, "ISR" chỉ chạy tại các điểm pump nên không có preemption
+  thật để phải che.
+
+  Part of Grbl simulator build
+*/
+
+#ifndef sim_avr_interrupt_h
+#define sim_avr_interrupt_h
+
+#include "io.h"
+
+#define ISR(vector) void vector(void)
+
+#define cli() ((void)0)
+#define sei() ((void)0)
+
+#endif
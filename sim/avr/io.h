@@ -0,0 +1,109 @@
+/*
+  avr/io.h - Register AVR giả lập cho bản build simulator trên PC
+
+  Thay register memory-mapped của ATmega bằng biến toàn cục thường (định
+  nghĩa trong sim_registers.c). Code firmware ghi/đọc DDRx/PORTx/TCCRx y
+  nguyên - không sửa một dòng nào phía firmware/ - còn bench driver nhìn vào
+  các biến này để biết stepper ISR đã được bật hay chưa (TIMSK1) và chu kỳ
+  tick hiện tại (OCR1A). Số bit dùng đúng giá trị datasheet ATmega328P để
+  các mask trong cpu_map/stepper khớp nhau.
+
+  Part of Grbl simulator build
+*/
+
+#ifndef sim_avr_io_h
+#define sim_avr_io_h
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+// GPIO port B/C/D
+extern volatile uint8_t DDRB, PORTB, PINB;
+extern volatile uint8_t DDRC, PORTC, PINC;
+extern volatile uint8_t DDRD, PORTD, PIND;
+
+// Pin change interrupt
+extern volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+
+// Timer0 (step pulse reset)
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0;
+#define TOIE0  0
+#define OCIE0A 1
+#define OCIE0B 2
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM00 0
+#define WGM01 1
+#define WGM02 3
+
+// Timer1 (stepper ISR) - TCNT1/OCR1A 16-bit như phần cứng
+extern volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+#define TOIE1  0
+#define OCIE1A 1
+#define OCIE1B 2
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM10 0
+#define WGM11 1
+#define WGM12 3
+#define WGM13 4
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+
+// Timer2 (spindle PWM / micros timebase)
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2;
+#define TOIE2  0
+#define OCIE2A 1
+#define OCIE2B 2
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM20 0
+#define WGM21 1
+#define WGM22 3
+#define COM2A1 7
+#define COM2B1 5
+
+// USART0 (serial.c không được compile trong sim, nhưng giữ để đủ bộ)
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0, UBRR0H, UBRR0L;
+#define UDRE0 5
+#define RXEN0 4
+#define TXEN0 3
+#define RXCIE0 7
+#define UDRIE0 5
+#define U2X0 1
+
+// EEPROM (eeprom.c được thay bằng sim_eeprom.c, giữ tên cho đủ bộ)
+extern volatile uint8_t EECR, EEDR;
+extern volatile uint16_t EEAR;
+#define EEPE  1
+#define EEMPE 2
+#define EERE  0
+
+// Watchdog + reset cause
+extern volatile uint8_t WDTCSR, MCUSR;
+#define WDIF 7
+#define WDIE 6
+#define WDP3 5
+#define WDCE 4
+#define WDE  3
+#define WDP2 2
+#define WDP1 1
+#define WDP0 0
+#define WDRF 3
+
+// Status register (chỉ dùng cho save/restore quanh critical section)
+extern volatile uint8_t SREG;
+
+#endif
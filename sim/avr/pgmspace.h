@@ -0,0 +1,35 @@
+/*
+  avr/pgmspace.h - PROGMEM giả lập cho bản build simulator trên PC
+
+  Trên PC không có tách biệt flash/RAM - mọi macro pgm_read_* thoái hóa về
+  deref thường và PSTR về string literal. printPgmString và các bảng PROGMEM
+  (cal LUT, thông báo report) chạy y nguyên.
+
+  Part of Grbl simulator build
+*/
+
+#ifndef sim_avr_pgmspace_h
+#define sim_avr_pgmspace_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char *
+
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+#define pgm_read_ptr(addr)   (*(void *const *)(addr))
+
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+
+#define memcpy_P  memcpy
+#define strcpy_P  strcpy
+#define strncpy_P strncpy
+#define strcmp_P  strcmp
+#define strlen_P  strlen
+
+#endif
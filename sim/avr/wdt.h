@@ -0,0 +1,21 @@
+/*
+  avr/wdt.h - Watchdog giả lập cho bản build simulator trên PC
+
+  Sim không có watchdog phần cứng: pet/disable là no-op, WDTCSR vẫn tồn tại
+  (avr/io.h) để system_wdt_init() ghi cấu hình mà không cần sửa firmware.
+  WDT_vect do system.c định nghĩa thành hàm thường - bench có thể gọi tay
+  nếu muốn diễn tập đường crash-resume.
+
+  Part of Grbl simulator build
+*/
+
+#ifndef sim_avr_wdt_h
+#define sim_avr_wdt_h
+
+#include "io.h"
+
+#define wdt_reset()    ((void)0)
+#define wdt_disable()  ((void)0)
+#define wdt_enable(x)  ((void)0)
+
+#endif
@@ -0,0 +1,175 @@
+/*
+  bench.c - Benchmark driver: replay stream g-code qua protocol_main_loop()
+  thật và báo thông lượng planner/stepper trên PC.
+
+  Trước đây cách duy nhất để biết một thay đổi planner/protocol có lợi hay
+  không là nạp firmware và bấm đồng hồ một lượt quét thật. Bench chạy đúng
+  code đường nóng của firmware (gc_execute_line -> plan_buffer_line ->
+  st_prep_buffer -> TIMER1_COMPA_vect) trên host, nên so được giữa hai
+  commit bằng con số lặp lại được:
+
+    - lines/sec  : thông lượng block qua parser + planner (wall clock host)
+    - prep       : thời gian host cho mỗi lần st_prep_buffer (avg/max)
+    - ISR        : số tick stepper, chi phí host mỗi tick (avg/max) và
+                   tick-rate mô phỏng (từ chuỗi OCR1A, 16MHz prescaler 1)
+
+  Cách dùng:
+    ./grbl_bench                    # stream tổng hợp: 5 vòng x 200 đoạn G1
+    ./grbl_bench -r 20 -p 400       # 20 vòng x 400 đoạn
+    ./grbl_bench -f scan.gcode      # replay stream đã ghi từ GUI
+    ./grbl_bench -v ...             # echo output firmware ra stdout
+
+  Part of Grbl simulator build
+*/
+
+#include "grbl.h"
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Biến toàn cục hệ thống - bình thường do main.c định nghĩa
+system_t sys;
+
+// Đọc cả file g-code vào một buffer (trả NULL nếu không mở được)
+static char *bench_read_file(const char *path, size_t *out_len)
+{
+  FILE *f = fopen(path, "rb");
+  char *buf;
+  long n;
+  if (!f) { return NULL; }
+  fseek(f, 0, SEEK_END);
+  n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  buf = malloc((size_t)n + 2);
+  if (fread(buf, 1, (size_t)n, f) != (size_t)n) { fclose(f); free(buf); return NULL; }
+  fclose(f);
+  buf[n] = '\n'; // Dòng cuối thiếu newline vẫn được thực thi
+  buf[n+1] = 0;
+  *out_len = (size_t)n + 1;
+  return buf;
+}
+
+// Sinh stream quét tổng hợp kiểu GUI per-point: mỗi vòng bàn quay (3.6 đơn
+// vị X) chia thành <points> đoạn G1 ngắn - đúng dạng stream dày mà planner
+// phải nhai trong chế độ quét cũ
+static char *bench_synth_stream(unsigned revs, unsigned points, size_t *out_len)
+{
+  size_t cap = (size_t)revs * points * 32 + 64;
+  char *buf = malloc(cap);
+  size_t len = 0;
+  unsigned r, p;
+  for (r = 0; r < revs; r++) {
+    for (p = 1; p <= points; p++) {
+      double x = (r + (double)p / points) * 3.6;
+      len += (size_t)snprintf(buf + len, cap - len, "G1 X%.4f F720\n", x);
+    }
+  }
+  *out_len = len;
+  return buf;
+}
+
+// Đếm số dòng lệnh trong stream (xấp xỉ số block - dòng trống không đáng kể)
+static unsigned long bench_count_lines(const char *data, size_t len)
+{
+  unsigned long lines = 0;
+  size_t i;
+  for (i = 0; i < len; i++) { if (data[i] == '\n') { lines++; } }
+  return lines;
+}
+
+int main(int argc, char **argv)
+{
+  const char *gcode_path = NULL;
+  unsigned revs = 5, points = 200;
+  char *stream;
+  size_t stream_len;
+  unsigned long lines;
+  uint64_t t0, t1;
+  double wall_s, sim_s;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) { sim_serial_set_echo(1); }
+    else if ((strcmp(argv[i], "-f") == 0) && (i+1 < argc)) { gcode_path = argv[++i]; }
+    else if ((strcmp(argv[i], "-r") == 0) && (i+1 < argc)) { revs = (unsigned)atoi(argv[++i]); }
+    else if ((strcmp(argv[i], "-p") == 0) && (i+1 < argc)) { points = (unsigned)atoi(argv[++i]); }
+    else {
+      fprintf(stderr, "usage: %s [-v] [-r revs] [-p points_per_rev] [-f file.gcode]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (gcode_path) {
+    stream = bench_read_file(gcode_path, &stream_len);
+    if (!stream) { fprintf(stderr, "bench: khong doc duoc %s\n", gcode_path); return 1; }
+  } else {
+    stream = bench_synth_stream(revs, points, &stream_len);
+  }
+  lines = bench_count_lines(stream, stream_len);
+
+  // Khởi tạo theo đúng trình tự main.c (bỏ phần chỉ-có-trên-board: watchdog
+  // restore, XSHUT hold, HOMING_INIT_LOCK)
+  serial_init();
+  settings_init();
+  i2c_init();
+  stepper_init();
+  system_init();
+  micros_init();
+  memset(&sys, 0, sizeof(system_t));
+
+  // Bench chạy từ vị trí 0 không homing - tắt các khóa liên quan (chỉ RAM,
+  // EEPROM mô phỏng không bị ghi đè)
+  settings.flags &= ~(BITFLAG_HOMING_ENABLE | BITFLAG_HARD_LIMIT_ENABLE | BITFLAG_SOFT_LIMIT_ENABLE);
+
+  // Trình tự reset của vòng for(;;) trong main.c
+  settings_flush_sync();
+  serial_reset_read_buffer();
+  gc_init();
+  spindle_init();
+  coolant_init();
+  limits_init();
+  probe_init();
+  plan_reset();
+  st_reset();
+  plan_sync_position();
+  gc_sync_position();
+  sys.abort = false;
+  sys_rt_exec_state = 0;
+  sys_rt_exec_alarm = 0;
+  sys.suspend = false;
+  sys.soft_limit = false;
+
+  sim_serial_feed(stream, stream_len);
+  sim_request_exit_when_idle();
+
+  t0 = sim_host_ns();
+  protocol_main_loop(); // Thoát khi stub serial phát EXEC_RESET lúc idle
+  t1 = sim_host_ns();
+
+  wall_s = (double)(t1 - t0) / 1e9;
+  sim_s = (double)sim_isr_cycles / (double)F_CPU;
+
+  fprintf(stderr, "---- grbl_bench ----\n");
+  fprintf(stderr, "stream       : %lu dong (%zu byte in, %lu byte out)\n",
+          lines, stream_len, sim_serial_tx_bytes());
+  fprintf(stderr, "wall         : %.3f s  (%.0f lines/sec)\n",
+          wall_s, (wall_s > 0.0) ? lines / wall_s : 0.0);
+  fprintf(stderr, "prep         : %llu lan, avg %.0f ns, max %llu ns\n",
+          (unsigned long long)sim_prep_calls,
+          sim_prep_calls ? (double)sim_prep_ns / sim_prep_calls : 0.0,
+          (unsigned long long)sim_prep_ns_max);
+  fprintf(stderr, "ISR          : %llu tick, avg %.0f ns/tick (host), max %llu ns\n",
+          (unsigned long long)sim_isr_ticks,
+          sim_isr_ticks ? (double)sim_isr_ns / sim_isr_ticks : 0.0,
+          (unsigned long long)sim_isr_ns_max);
+  fprintf(stderr, "sim time     : %.3f s  (avg %.0f tick/sec, dinh %.0f tick/sec)\n",
+          sim_s,
+          (sim_s > 0.0) ? sim_isr_ticks / sim_s : 0.0,
+          (sim_isr_ticks > 0) ? (double)F_CPU / ((double)sim_ocr1a_min + 1) : 0.0);
+  fprintf(stderr, "vi tri cuoi  : X=%ld Y=%ld Z=%ld (step)\n",
+          (long)sys.position[X_AXIS], (long)sys.position[Y_AXIS], (long)sys.position[Z_AXIS]);
+
+  free(stream);
+  return 0;
+}
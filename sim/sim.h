@@ -0,0 +1,56 @@
+/*
+  sim.h - API dùng chung giữa stub HAL và bench driver của simulator
+
+  Bản build host compile các module lõi của firmware/ (planner, gcode,
+  protocol, stepper...) y nguyên, chỉ thay các module chạm phần cứng ở MỨC
+  MODULE: serial (sim_serial.c), eeprom (sim_eeprom.c), i2c + sensor ToF +
+  micros (sim_hal.c). Register AVR thành biến thường (sim/avr/io.h).
+
+  Part of Grbl simulator build
+*/
+
+#ifndef sim_h
+#define sim_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ---- sim_serial.c -------------------------------------------------------
+// Nạp stream lệnh vào buffer RX giả (bench gọi trước protocol_main_loop)
+void sim_serial_feed(const char *data, size_t len);
+
+// Bật/tắt echo output của firmware ra stdout (mặc định tắt - chỉ đếm byte)
+void sim_serial_set_echo(uint8_t on);
+
+// Tổng số byte firmware đã ghi ra "serial"
+unsigned long sim_serial_tx_bytes(void);
+
+// Sau khi stream cạn VÀ máy về idle, stub serial tự phát EXEC_RESET để
+// protocol_main_loop thoát về bench (thay cho ctrl-x của host thật)
+void sim_request_exit_when_idle(void);
+
+// ---- sim_hal.c ----------------------------------------------------------
+// Tiến stepper mô phỏng: chạy TIMER1_COMPA_vect khi TIMSK1 cho phép và đo
+// st_prep_buffer. Được móc vào i2c_recovery_pending() - điểm mà
+// protocol_execute_realtime gọi ở MỌI vòng - nên mọi wait loop của firmware
+// đều tự kéo "ISR" chạy, giống hệt phần cứng tick nền.
+void sim_stepper_pump(void);
+
+// Đồng hồ host đơn điệu (nanô giây) cho các phép đo của bench
+uint64_t sim_host_ns(void);
+
+// Thống kê tích lũy bởi sim_stepper_pump - bench đọc sau khi replay xong
+extern uint64_t sim_isr_ticks;     // Số lần gọi stepper ISR
+extern uint64_t sim_isr_cycles;    // Thời gian mô phỏng: tổng (OCR1A+1) cycle @16MHz
+extern uint64_t sim_isr_ns;        // Tổng thời gian host trong ISR
+extern uint64_t sim_isr_ns_max;    // Lần ISR chậm nhất (host ns)
+extern uint16_t sim_ocr1a_min;     // OCR1A nhỏ nhất = tick rate đỉnh
+extern uint64_t sim_prep_calls;    // Số lần đo st_prep_buffer
+extern uint64_t sim_prep_ns;       // Tổng thời gian host trong st_prep_buffer
+extern uint64_t sim_prep_ns_max;   // Lần prep chậm nhất (host ns)
+
+// ISR của firmware (nở từ macro ISR trong sim/avr/interrupt.h)
+void TIMER1_COMPA_vect(void);
+void TIMER0_OVF_vect(void);
+
+#endif
@@ -0,0 +1,54 @@
+/*
+  sim_eeprom.c - Thay eeprom.c cho bản build simulator trên PC
+
+  EEPROM là một mảng RAM 2KB, ghi tức thời (eeprom_ready luôn sẵn sàng nên
+  flush nền của settings.c chạy hết tốc). Hai hàm memcpy checksum GIỮ NGUYÊN
+  công thức của eeprom.c - kể cả dị tật "||" thay vì "|" - để layout đọc
+  được chéo với EEPROM thật nếu dump ra so sánh.
+
+  Part of Grbl simulator build
+*/
+
+#include "grbl.h"
+
+#define SIM_EEPROM_SIZE 2048
+
+static unsigned char sim_eeprom[SIM_EEPROM_SIZE];
+
+unsigned char eeprom_get_char( unsigned int addr )
+{
+  if (addr >= SIM_EEPROM_SIZE) { return 0xFF; }
+  return sim_eeprom[addr];
+}
+
+void eeprom_put_char( unsigned int addr, unsigned char new_value )
+{
+  if (addr >= SIM_EEPROM_SIZE) { return; }
+  sim_eeprom[addr] = new_value;
+}
+
+unsigned char eeprom_ready( void )
+{
+  return 1; // RAM - không có chu kỳ program 3.4ms
+}
+
+void memcpy_to_eeprom_with_checksum(unsigned int destination, char *source, unsigned int size) {
+  unsigned char checksum = 0;
+  for(; size > 0; size--) {
+    checksum = (checksum << 1) || (checksum >> 7);
+    checksum += *source;
+    eeprom_put_char(destination++, *(source++));
+  }
+  eeprom_put_char(destination, checksum);
+}
+
+int memcpy_from_eeprom_with_checksum(char *destination, unsigned int source, unsigned int size) {
+  unsigned char data, checksum = 0;
+  for(; size > 0; size--) {
+    data = eeprom_get_char(source++);
+    checksum = (checksum << 1) || (checksum >> 7);
+    checksum += data;
+    *(destination++) = data;
+  }
+  return(checksum == eeprom_get_char(source));
+}
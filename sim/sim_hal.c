@@ -0,0 +1,172 @@
+/*
+  sim_hal.c - Thay i2c.c, vl53l0x.c, vl53l1.c, micros.c cho bản build
+  simulator trên PC, kèm pump stepper mô phỏng.
+
+  Sensor ToF trả dữ liệu tổng hợp tức thời (luôn data-ready, khoảng cách
+  500mm cộng gợn sóng xác định) - bench đo chi phí protocol/planner/stepper,
+  không mô phỏng quang học hay bus I2C. micros_now() chạy trên đồng hồ host.
+
+  Pump stepper: phần cứng thật tick TIMER1_COMPA nền; trên PC ISR phải được
+  gọi từ dòng chạy chính. Móc vào i2c_recovery_pending() vì đó là call đầu
+  tiên của protocol_execute_realtime ở MỌI lượt - mọi wait loop của firmware
+  (chờ planner trống chỗ, buffer synchronize, scan cycle...) đều feed
+  realtime nên stepper luôn tiến, giống hệt trên board.
+
+  Part of Grbl simulator build
+*/
+
+#include "grbl.h"
+#include "vl53l1.h"
+#include "sim.h"
+#include <time.h>
+
+// ---- Đồng hồ host -------------------------------------------------------
+
+uint64_t sim_host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// ---- Thống kê + pump stepper mô phỏng -----------------------------------
+
+uint64_t sim_isr_ticks = 0;
+uint64_t sim_isr_cycles = 0;
+uint64_t sim_isr_ns = 0;
+uint64_t sim_isr_ns_max = 0;
+uint16_t sim_ocr1a_min = 0xFFFF;
+uint64_t sim_prep_calls = 0;
+uint64_t sim_prep_ns = 0;
+uint64_t sim_prep_ns_max = 0;
+
+void sim_stepper_pump(void)
+{
+  uint64_t t0, dt;
+  uint8_t i;
+
+  // Tối đa 8 tick mỗi lượt pump - đủ để segment buffer không bao giờ là nút
+  // cổ chai của SIM trong khi wait loop vẫn quay đủ nhanh qua realtime
+  for (i = 0; (i < 8) && (TIMSK1 & (1<<OCIE1A)); i++) {
+    t0 = sim_host_ns();
+    TIMER1_COMPA_vect();
+    dt = sim_host_ns() - t0;
+    sim_isr_ticks++;
+    sim_isr_ns += dt;
+    if (dt > sim_isr_ns_max) { sim_isr_ns_max = dt; }
+    // Thời gian mô phỏng: ISR kế đến sau OCR1A+1 cycle (prescaler 1 - AMASS
+    // giữ Timer1 ở 1/1, xem stepper.c)
+    sim_isr_cycles += (uint32_t)OCR1A + 1;
+    if (OCR1A < sim_ocr1a_min) { sim_ocr1a_min = OCR1A; }
+  }
+
+  // Đo st_prep_buffer từ đây (trước lượt gọi của chính realtime): gọi thừa
+  // vô hại - buffer đầy thì hàm trả về ngay và chỉ tính vào min/avg
+  t0 = sim_host_ns();
+  st_prep_buffer();
+  dt = sim_host_ns() - t0;
+  sim_prep_calls++;
+  sim_prep_ns += dt;
+  if (dt > sim_prep_ns_max) { sim_prep_ns_max = dt; }
+}
+
+// ---- micros.c -----------------------------------------------------------
+
+void micros_init(void) { }
+
+uint32_t micros_now(void)
+{
+  return (uint32_t)(sim_host_ns() / 1000ULL);
+}
+
+// ---- i2c.c --------------------------------------------------------------
+
+void i2c_init(void) { }
+
+void i2c_set_speed(uint8_t fast_mode) { (void)fast_mode; }
+
+void i2c_bus_recover(void) { }
+
+uint8_t i2c_get_recovery_count(void) { return 0; }
+
+uint8_t i2c_recovery_pending(void)
+{
+  // Điểm móc của pump - xem doc đầu file
+  sim_stepper_pump();
+  return 0;
+}
+
+// ---- vl53l0x.c ----------------------------------------------------------
+
+static uint32_t vl53l0x_sample_n = 0;
+
+uint8_t vl53l0x_init(void) { return 1; }
+void vl53l0x_setTimeout(uint16_t timeout) { (void)timeout; }
+void vl53l0x_startContinuous(uint16_t period_ms) { (void)period_ms; }
+void vl53l0x_stopContinuous(void) { }
+void vl53l0x_setProfile(uint8_t profile) { (void)profile; }
+uint8_t vl53l0x_setMeasurementTimingBudget(uint32_t budget_us) { (void)budget_us; return 1; }
+uint8_t vl53l0x_timeoutOccurred(void) { return 0; }
+uint8_t vl53l0x_dataReady(void) { return 1; }
+uint8_t vl53l0x_dataReadyPoll(void) { return 1; }
+
+uint16_t vl53l0x_readRangeContinuousMillimeters(void)
+{
+  // 500mm + gợn sóng xác định vài mm - đủ cho đường delta/filter có việc làm
+  vl53l0x_sample_n++;
+  return (uint16_t)(500 + ((vl53l0x_sample_n * 7) % 23));
+}
+
+uint16_t vl53l0x_readRangeFilteredMillimeters(void)
+{
+  return vl53l0x_readRangeContinuousMillimeters();
+}
+
+uint32_t vl53l0x_lastSampleMicros(void) { return micros_now(); }
+uint8_t vl53l0x_lastRangeStatus(void) { return 11; } // 11 = range hợp lệ
+uint16_t vl53l0x_lastSignalRate(void) { return 1500; }
+uint16_t vl53l0x_lastAmbientRate(void) { return 40; }
+
+#ifdef VL53L0X_CAL_LUT
+void vl53l0x_cal_entry(uint8_t idx, uint16_t *raw, int16_t *offset)
+{
+  (void)idx;
+  *raw = 0; *offset = 0;
+}
+
+uint16_t vl53l0x_cal_apply(uint16_t raw) { return raw; }
+#endif
+
+#ifdef VL53L0X_GPIO1_INTERRUPT
+void vl53l0x_gpio1_isr(void) { }
+
+void vl53l0x_getLatchedPosition(int32_t *position)
+{
+  uint8_t idx;
+  for (idx = 0; idx < N_AXIS; idx++) { position[idx] = sys.position[idx]; }
+}
+#endif
+
+// ---- vl53l1.c -----------------------------------------------------------
+
+uint8_t vl53l1_init(void) { return 1; }
+void vl53l1_setTimeout(uint16_t timeout) { (void)timeout; }
+void vl53l1_setAddress(uint8_t new_address) { (void)new_address; }
+void vl53l1_setDistanceMode(uint8_t mode) { (void)mode; }
+void vl53l1_startContinuous(uint16_t period_ms) { (void)period_ms; }
+void vl53l1_ensureContinuous(void) { }
+void vl53l1_stopContinuous(void) { }
+uint8_t vl53l1_dataReady(void) { return 1; }
+uint8_t vl53l1_timeoutOccurred(void) { return 0; }
+
+uint16_t vl53l1_readRangeContinuousMillimeters(void)
+{
+  return vl53l0x_readRangeContinuousMillimeters();
+}
+
+uint16_t vl53l1_readRangeFilteredMillimeters(void)
+{
+  return vl53l0x_readRangeContinuousMillimeters();
+}
+
+uint32_t vl53l1_lastSampleMicros(void) { return micros_now(); }
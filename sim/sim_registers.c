@@ -0,0 +1,29 @@
+/*
+  sim_registers.c - Bộ nhớ cho register AVR giả lập (xem sim/avr/io.h)
+
+  Part of Grbl simulator build
+*/
+
+#include <avr/io.h>
+
+volatile uint8_t DDRB, PORTB, PINB;
+volatile uint8_t DDRC, PORTC, PINC;
+volatile uint8_t DDRD, PORTD, PIND;
+
+volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0;
+
+volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1;
+volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2;
+
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0, UBRR0H, UBRR0L;
+
+volatile uint8_t EECR, EEDR;
+volatile uint16_t EEAR;
+
+volatile uint8_t WDTCSR, MCUSR;
+
+volatile uint8_t SREG;
@@ -0,0 +1,89 @@
+/*
+  sim_serial.c - Thay serial.c cho bản build simulator trên PC
+
+  RX là một buffer lớn được bench nạp sẵn cả stream g-code; TX gom vào bộ
+  đếm (tùy chọn echo ra stdout). Không mô phỏng tốc độ baud hay kích thước
+  ring 128 byte - bench đo thông lượng THUẬT TOÁN của firmware, link được
+  coi là vô hạn. Khi stream cạn và máy đã về idle, stub tự phát EXEC_RESET
+  để protocol_main_loop thoát về bench (vai trò ctrl-x của host thật).
+
+  Part of Grbl simulator build
+*/
+
+#include "grbl.h"
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *rx_data = NULL;
+static size_t rx_len = 0;
+static size_t rx_pos = 0;
+
+static unsigned long tx_bytes = 0;
+static uint8_t tx_echo = 0;
+
+static uint8_t exit_when_idle = 0;
+static uint8_t exit_sent = 0;
+
+void sim_serial_feed(const char *data, size_t len)
+{
+  rx_data = data;
+  rx_len = len;
+  rx_pos = 0;
+}
+
+void sim_serial_set_echo(uint8_t on) { tx_echo = on; }
+
+unsigned long sim_serial_tx_bytes(void) { return tx_bytes; }
+
+void sim_request_exit_when_idle(void)
+{
+  exit_when_idle = 1;
+  exit_sent = 0;
+}
+
+void serial_init()
+{
+  // Không có UART - stream do bench nạp qua sim_serial_feed
+}
+
+void serial_write(uint8_t data)
+{
+  tx_bytes++;
+  if (tx_echo) { fputc(data, stdout); }
+}
+
+uint8_t serial_read()
+{
+  if (rx_pos < rx_len) { return (uint8_t)rx_data[rx_pos++]; }
+  // Stream cạn: chờ máy chạy nốt phần đã plan rồi mới xin thoát - EXEC_RESET
+  // lúc idle đi qua mc_reset như một reset sạch, không giết chuyển động
+  if (exit_when_idle && !exit_sent &&
+      (sys.state == STATE_IDLE) && (plan_get_current_block() == NULL)) {
+    exit_sent = 1;
+    bit_true_atomic(sys_rt_exec_state, EXEC_RESET);
+  }
+  return SERIAL_NO_DATA;
+}
+
+void serial_reset_read_buffer()
+{
+  // Bench nạp stream SAU bước reset của phiên nên không có gì để vứt
+}
+
+serial_idx_t serial_get_rx_buffer_count() { return (serial_idx_t)0; }
+
+serial_idx_t serial_get_tx_buffer_count() { return (serial_idx_t)0; }
+
+serial_idx_t serial_get_tx_buffer_free() { return (serial_idx_t)(TX_BUFFER_SIZE - 1); }
+
+uint16_t serial_get_rx_overflow_count() { return 0; }
+
+serial_idx_t serial_get_rx_peak() { return (serial_idx_t)0; }
+
+serial_idx_t serial_get_tx_peak() { return (serial_idx_t)0; }
+
+#ifdef ENABLE_XONXOFF
+uint16_t serial_get_flow_switch_count() { return 0; }
+#endif
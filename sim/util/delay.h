@@ -0,0 +1,17 @@
+/*
+  util/delay.h - Delay giả lập cho bản build simulator trên PC
+
+  Delay thành no-op: bench đo thời gian THUẬT TOÁN (planner, prep, parse),
+  không mô phỏng thời gian chết của phần cứng. delay_ms của nuts_bolts.c vì
+  vậy quay về một vòng lặp đếm suông - các chỗ chờ sensor/boot kết thúc ngay.
+
+  Part of Grbl simulator build
+*/
+
+#ifndef sim_util_delay_h
+#define sim_util_delay_h
+
+#define _delay_ms(x) ((void)0)
+#define _delay_us(x) ((void)0)
+
+#endif
@@ -0,0 +1,456 @@
+/*
+  scanproc.cpp - Công cụ dòng lệnh xử lý point cloud offline, thay cho
+  processScanDistance.m.
+
+  Pipeline giống hệt bản MATLAB (lọc min/max, offset về tâm bàn xoay, bỏ
+  giá trị quanh 0, điền nearest-neighbor, làm mượt trung bình trượt,
+  polar -> cartesian) nhưng đọc thẳng file .scan nhị phân của GUI
+  (scanner_gui/scan_file.py) và chạy native:
+
+    - layout structure-of-arrays: mỗi cột (angle/z/distance) là một mảng
+      liên tục để vòng lọc và trig chạy kiểu SIMD-friendly
+    - lọc + điền + làm mượt chạy đa luồng theo lớp (mỗi lớp độc lập)
+    - sin/cos tính một lần cho lưới góc của một vòng quay rồi tra bảng
+
+  MATLAB mất ~40s cho một scan lớn (chưa kể license trên xưởng); mục tiêu
+  ở đây là dưới một giây để chỉnh tham số lọc tương tác được.
+
+  Cách dùng:
+    scanproc scan.scan -o out.stl                # mesh lưới kín hai nắp
+    scanproc scan.scan -o cloud.ply              # point cloud PLY nhị phân
+    scanproc scan.scan -o out.stl --center 103 --min 0 --max 200 --window 3
+    scanproc scan.scan -o out.stl --ppr 36       # ép số điểm mỗi vòng
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ---- Định dạng .scan (xem scanner_gui/scan_file.py) ----------------------
+
+static const char SCAN_MAGIC[8] = {'S','C','A','N','3','D','\0','\1'};
+
+#pragma pack(push, 1)
+struct scan_header_t {
+  char magic[8];
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t reserved;
+  uint64_t count;
+  double start_time;
+};
+struct scan_record_t {
+  double timestamp;
+  double angle;    // độ
+  double z;        // mm
+  double distance; // mm
+  uint32_t status;
+  uint32_t reserved;
+};
+#pragma pack(pop)
+
+// ---- Tham số lọc (mặc định khớp processScanDistance.m, đổi cm -> mm) -----
+
+struct params_t {
+  double center_mm = 103.0;   // khoảng cách cảm biến -> tâm bàn xoay
+  double min_dist_mm = 0.0;   // dưới ngưỡng = lỗi đọc
+  double max_dist_mm = 200.0; // trên ngưỡng = chỉ quét "không khí"
+  double mid_thresh_mm = 5.0; // bỏ bán kính quanh 0 (midThresh của .m)
+  int window = 3;             // cửa sổ trung bình trượt theo góc
+  int ppr = 0;                // điểm mỗi vòng; 0 = tự phát hiện
+  unsigned threads = 0;       // 0 = std::thread::hardware_concurrency()
+};
+
+// Structure-of-arrays: cột nào ra mảng nấy, vòng lặp chỉ chạm dữ liệu cần
+struct samples_t {
+  std::vector<double> angle;
+  std::vector<double> z;
+  std::vector<double> distance;
+};
+
+// Lưới sau khi gom lớp: layers x ppr, giá trị là bán kính từ tâm (mm),
+// NAN = mẫu không hợp lệ / thiếu
+struct grid_t {
+  int ppr = 0;
+  std::vector<double> heights;  // z của từng lớp (mm)
+  std::vector<double> r;        // layers * ppr
+  size_t layers() const { return heights.size(); }
+};
+
+static bool load_scan(const char *path, samples_t *out)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f) { fprintf(stderr, "scanproc: khong mo duoc %s\n", path); return false; }
+  scan_header_t hdr;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+      memcmp(hdr.magic, SCAN_MAGIC, sizeof(SCAN_MAGIC)) != 0) {
+    fprintf(stderr, "scanproc: %s khong phai file .scan\n", path);
+    fclose(f);
+    return false;
+  }
+  if (hdr.record_size != sizeof(scan_record_t)) {
+    fprintf(stderr, "scanproc: record %u byte (version %u) khac ban doc nay (%zu)\n",
+            hdr.record_size, hdr.version, sizeof(scan_record_t));
+    fclose(f);
+    return false;
+  }
+  out->angle.reserve(hdr.count);
+  out->z.reserve(hdr.count);
+  out->distance.reserve(hdr.count);
+  // Đọc theo khối rồi tách cột - file ghi AoS, xử lý muốn SoA
+  std::vector<scan_record_t> block(4096);
+  uint64_t remaining = hdr.count;
+  while (remaining > 0) {
+    size_t want = (size_t)std::min<uint64_t>(remaining, block.size());
+    size_t got = fread(block.data(), sizeof(scan_record_t), want, f);
+    if (got == 0) { break; } // file bị cắt (crash) - giữ phần đọc được
+    for (size_t i = 0; i < got; i++) {
+      out->angle.push_back(block[i].angle);
+      out->z.push_back(block[i].z);
+      out->distance.push_back(block[i].distance);
+    }
+    remaining -= got;
+  }
+  fclose(f);
+  return true;
+}
+
+// Tự phát hiện số điểm mỗi vòng: đếm góc phân biệt (làm tròn 0.1 độ)
+static int detect_ppr(const samples_t &s)
+{
+  std::vector<long> keys;
+  keys.reserve(s.angle.size());
+  for (double a : s.angle) {
+    double wrapped = fmod(a, 360.0);
+    if (wrapped < 0) { wrapped += 360.0; }
+    keys.push_back(lround(wrapped * 10.0));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return (int)keys.size();
+}
+
+// Gom mẫu vào lưới lớp x góc. Lớp theo z làm tròn 0.1mm (như GUI); mẫu
+// trùng ô lấy trung bình. Lọc min/max và midThresh áp ngay tại đây.
+static grid_t build_grid(const samples_t &s, const params_t &p)
+{
+  grid_t g;
+  g.ppr = p.ppr;
+  double step = 360.0 / g.ppr;
+
+  std::map<long, size_t> layer_index; // z*10 làm tròn -> hàng
+  std::vector<std::vector<double>> sums;
+  std::vector<std::vector<int>> counts;
+
+  for (size_t i = 0; i < s.angle.size(); i++) {
+    long zkey = lround(s.z[i] * 10.0);
+    auto it = layer_index.find(zkey);
+    size_t row;
+    if (it == layer_index.end()) {
+      row = g.heights.size();
+      layer_index[zkey] = row;
+      g.heights.push_back(zkey / 10.0);
+      sums.emplace_back(g.ppr, 0.0);
+      counts.emplace_back(g.ppr, 0);
+    } else {
+      row = it->second;
+    }
+    double d = s.distance[i];
+    if (d < p.min_dist_mm || d > p.max_dist_mm) { continue; }
+    double r = p.center_mm - d; // offset về tâm bàn xoay (như .m)
+    if (fabs(r) < p.mid_thresh_mm) { continue; }
+    double wrapped = fmod(s.angle[i], 360.0);
+    if (wrapped < 0) { wrapped += 360.0; }
+    int col = (int)lround(wrapped / step) % g.ppr;
+    sums[row][col] += r;
+    counts[row][col]++;
+  }
+
+  // Sắp lớp theo chiều cao tăng dần
+  std::vector<size_t> order(g.heights.size());
+  for (size_t i = 0; i < order.size(); i++) { order[i] = i; }
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return g.heights[a] < g.heights[b]; });
+
+  std::vector<double> heights_sorted;
+  g.r.assign(order.size() * g.ppr, NAN);
+  for (size_t k = 0; k < order.size(); k++) {
+    size_t row = order[k];
+    heights_sorted.push_back(g.heights[row]);
+    for (int c = 0; c < g.ppr; c++) {
+      if (counts[row][c] > 0) {
+        g.r[k * g.ppr + c] = sums[row][c] / counts[row][c];
+      }
+    }
+  }
+  g.heights = heights_sorted;
+  return g;
+}
+
+// Một lớp: điền NAN bằng giá trị hợp lệ gần nhất (vòng tròn) rồi làm mượt
+// trung bình trượt cửa sổ window (bọc qua mối nối 0/360 như padarray
+// symmetric + wrap của .m)
+static void filter_layer(double *r, int ppr, int window)
+{
+  int first_valid = -1;
+  for (int i = 0; i < ppr; i++) {
+    if (!std::isnan(r[i])) { first_valid = i; break; }
+  }
+  if (first_valid < 0) { return; } // lớp rỗng - bỏ ở bước ghi
+
+  // Điền xuôi từ mẫu hợp lệ đầu tiên, vòng hết chu vi
+  double latest = r[first_valid];
+  for (int k = 1; k < ppr; k++) {
+    int i = (first_valid + k) % ppr;
+    if (std::isnan(r[i])) { r[i] = latest; }
+    else { latest = r[i]; }
+  }
+
+  if (window <= 1) { return; }
+  int half = window / 2;
+  std::vector<double> out(ppr);
+  for (int i = 0; i < ppr; i++) {
+    double acc = 0.0;
+    for (int k = -half; k <= half; k++) {
+      acc += r[(i + k + ppr) % ppr];
+    }
+    out[i] = acc / (2 * half + 1);
+  }
+  memcpy(r, out.data(), ppr * sizeof(double));
+}
+
+// Chia lớp cho nhiều luồng - mỗi lớp độc lập nên không cần khóa
+static void filter_grid(grid_t *g, const params_t &p)
+{
+  unsigned n_threads = p.threads ? p.threads : std::thread::hardware_concurrency();
+  if (n_threads == 0) { n_threads = 1; }
+  n_threads = std::min<unsigned>(n_threads, (unsigned)g->layers());
+  if (n_threads <= 1) {
+    for (size_t row = 0; row < g->layers(); row++) {
+      filter_layer(&g->r[row * g->ppr], g->ppr, p.window);
+    }
+    return;
+  }
+  std::vector<std::thread> pool;
+  size_t per = (g->layers() + n_threads - 1) / n_threads;
+  for (unsigned t = 0; t < n_threads; t++) {
+    size_t begin = t * per;
+    size_t end = std::min(g->layers(), begin + per);
+    if (begin >= end) { break; }
+    pool.emplace_back([=]() {
+      for (size_t row = begin; row < end; row++) {
+        filter_layer(&g->r[row * g->ppr], g->ppr, p.window);
+      }
+    });
+  }
+  for (auto &th : pool) { th.join(); }
+}
+
+// Polar -> cartesian cả lưới: bảng sin/cos một vòng dùng chung mọi lớp
+struct cloud_t {
+  int ppr = 0;
+  std::vector<float> x, y, z; // SoA, float đủ cho STL/PLY
+  size_t layers() const { return x.size() / ppr; }
+};
+
+static cloud_t grid_to_cloud(const grid_t &g)
+{
+  cloud_t c;
+  c.ppr = g.ppr;
+  std::vector<double> cos_t(g.ppr), sin_t(g.ppr);
+  for (int i = 0; i < g.ppr; i++) {
+    double theta = (2.0 * M_PI * i) / g.ppr;
+    cos_t[i] = cos(theta);
+    sin_t[i] = sin(theta);
+  }
+  for (size_t row = 0; row < g.layers(); row++) {
+    const double *r = &g.r[row * g.ppr];
+    bool any = false;
+    for (int i = 0; i < g.ppr; i++) {
+      if (!std::isnan(r[i])) { any = true; break; }
+    }
+    if (!any) { continue; } // lớp rỗng hoàn toàn - bỏ (như bản .m cắt đuôi)
+    for (int i = 0; i < g.ppr; i++) {
+      double ri = std::isnan(r[i]) ? 0.0 : r[i];
+      c.x.push_back((float)(ri * cos_t[i]));
+      c.y.push_back((float)(ri * sin_t[i]));
+      c.z.push_back((float)g.heights[row]);
+    }
+  }
+  return c;
+}
+
+// ---- Ghi PLY (point cloud, binary little endian) -------------------------
+
+static bool write_ply(const char *path, const cloud_t &c)
+{
+  FILE *f = fopen(path, "wb");
+  if (!f) { return false; }
+  fprintf(f,
+          "ply\nformat binary_little_endian 1.0\n"
+          "comment scanproc point cloud\n"
+          "element vertex %zu\n"
+          "property float x\nproperty float y\nproperty float z\n"
+          "end_header\n",
+          c.x.size());
+  for (size_t i = 0; i < c.x.size(); i++) {
+    float v[3] = { c.x[i], c.y[i], c.z[i] };
+    fwrite(v, sizeof(v), 1, f);
+  }
+  fclose(f);
+  return true;
+}
+
+// ---- Ghi STL nhị phân (lưới kín: tường + hai nắp quạt tâm) ---------------
+
+static void stl_facet(FILE *f, const float *a, const float *b, const float *cv)
+{
+  float n[3] = {
+    (b[1]-a[1])*(cv[2]-a[2]) - (b[2]-a[2])*(cv[1]-a[1]),
+    (b[2]-a[2])*(cv[0]-a[0]) - (b[0]-a[0])*(cv[2]-a[2]),
+    (b[0]-a[0])*(cv[1]-a[1]) - (b[1]-a[1])*(cv[0]-a[0]),
+  };
+  float len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+  if (len > 0) { n[0] /= len; n[1] /= len; n[2] /= len; }
+  uint16_t attr = 0;
+  fwrite(n, sizeof(n), 1, f);
+  fwrite(a, 3 * sizeof(float), 1, f);
+  fwrite(b, 3 * sizeof(float), 1, f);
+  fwrite(cv, 3 * sizeof(float), 1, f);
+  fwrite(&attr, sizeof(attr), 1, f);
+}
+
+static bool write_stl(const char *path, const cloud_t &c)
+{
+  size_t layers = c.layers();
+  if (layers < 2) {
+    fprintf(stderr, "scanproc: can it nhat 2 lop de tao mesh STL\n");
+    return false;
+  }
+  FILE *f = fopen(path, "wb");
+  if (!f) { return false; }
+  char header[80] = "scanproc mesh";
+  fwrite(header, sizeof(header), 1, f);
+  uint32_t n_facets = (uint32_t)((layers - 1) * c.ppr * 2 + 2 * c.ppr);
+  fwrite(&n_facets, sizeof(n_facets), 1, f);
+
+  auto vtx = [&](size_t row, int col, float *out) {
+    size_t i = row * c.ppr + (col % c.ppr);
+    out[0] = c.x[i]; out[1] = c.y[i]; out[2] = c.z[i];
+  };
+
+  // Tường: mỗi ô lưới hai tam giác, mối nối bọc về cột 0
+  for (size_t row = 0; row + 1 < layers; row++) {
+    for (int col = 0; col < c.ppr; col++) {
+      float a[3], b[3], d[3], e[3];
+      vtx(row, col, a); vtx(row, col + 1, b);
+      vtx(row + 1, col, d); vtx(row + 1, col + 1, e);
+      stl_facet(f, a, b, d);
+      stl_facet(f, b, e, d);
+    }
+  }
+
+  // Hai nắp quạt quanh trọng tâm lớp đáy/đỉnh
+  for (int cap = 0; cap < 2; cap++) {
+    size_t row = cap ? (layers - 1) : 0;
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    for (int col = 0; col < c.ppr; col++) {
+      float v[3]; vtx(row, col, v);
+      center[0] += v[0]; center[1] += v[1]; center[2] += v[2];
+    }
+    center[0] /= c.ppr; center[1] /= c.ppr; center[2] /= c.ppr;
+    for (int col = 0; col < c.ppr; col++) {
+      float a[3], b[3];
+      vtx(row, col, a); vtx(row, col + 1, b);
+      // Đảo chiều quấn để pháp tuyến đáy chỉ xuống, đỉnh chỉ lên
+      if (cap) { stl_facet(f, center, a, b); }
+      else { stl_facet(f, center, b, a); }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// ---- main ----------------------------------------------------------------
+
+static double ms_since(std::chrono::steady_clock::time_point t0)
+{
+  return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = nullptr;
+  const char *output = nullptr;
+  params_t p;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc) { output = argv[++i]; }
+    else if (arg == "--center" && i + 1 < argc) { p.center_mm = atof(argv[++i]); }
+    else if (arg == "--min" && i + 1 < argc) { p.min_dist_mm = atof(argv[++i]); }
+    else if (arg == "--max" && i + 1 < argc) { p.max_dist_mm = atof(argv[++i]); }
+    else if (arg == "--mid" && i + 1 < argc) { p.mid_thresh_mm = atof(argv[++i]); }
+    else if (arg == "--window" && i + 1 < argc) { p.window = atoi(argv[++i]); }
+    else if (arg == "--ppr" && i + 1 < argc) { p.ppr = atoi(argv[++i]); }
+    else if (arg == "--threads" && i + 1 < argc) { p.threads = (unsigned)atoi(argv[++i]); }
+    else if (arg[0] != '-' && !input) { input = argv[i]; }
+    else {
+      fprintf(stderr,
+              "usage: %s input.scan -o out.{stl|ply} [--center mm] [--min mm]\n"
+              "       [--max mm] [--mid mm] [--window n] [--ppr n] [--threads n]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (!input || !output) {
+    fprintf(stderr, "scanproc: can input.scan va -o output\n");
+    return 1;
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  samples_t samples;
+  if (!load_scan(input, &samples)) { return 1; }
+  double t_load = ms_since(t0);
+
+  if (p.ppr <= 0) {
+    p.ppr = detect_ppr(samples);
+    if (p.ppr <= 0) { fprintf(stderr, "scanproc: file rong\n"); return 1; }
+  }
+
+  auto t1 = std::chrono::steady_clock::now();
+  grid_t grid = build_grid(samples, p);
+  filter_grid(&grid, p);
+  cloud_t cloud = grid_to_cloud(grid);
+  double t_proc = ms_since(t1);
+
+  auto t2 = std::chrono::steady_clock::now();
+  std::string out = output;
+  bool ok;
+  if (out.size() > 4 && out.compare(out.size() - 4, 4, ".ply") == 0) {
+    ok = write_ply(output, cloud);
+  } else {
+    ok = write_stl(output, cloud);
+  }
+  double t_write = ms_since(t2);
+  if (!ok) {
+    fprintf(stderr, "scanproc: khong ghi duoc %s\n", output);
+    return 1;
+  }
+
+  fprintf(stderr,
+          "scanproc: %zu mau -> %zu lop x %d diem -> %s\n"
+          "  load %.1f ms, xu ly %.1f ms, ghi %.1f ms\n",
+          samples.angle.size(), cloud.layers(), cloud.ppr, output,
+          t_load, t_proc, t_write);
+  return 0;
+}